@@ -32,6 +32,7 @@
 #include <devhelp/dh-book-manager.h>
 #include <devhelp/dh-book-tree.h>
 #include <devhelp/dh-completion.h>
+#include <devhelp/dh-core.h>
 #include <devhelp/dh-init.h>
 #include <devhelp/dh-keyword-model.h>
 #include <devhelp/dh-link.h>
@@ -24,6 +24,11 @@
 #include <libsoup/soup.h>
 #include "dh-book-list-directory.h"
 #include "dh-book-manager.h"
+#include "dh-catalog.h"
+#include "dh-catalog-cache.h"
+#include "dh-core-client.h"
+#include "dh-json-array-reader.h"
+#include "dh-symbol-index.h"
 #include "dh-util-lib.h"
 
 /**
@@ -56,6 +61,27 @@
  * recreating the #DhBookListDirectory (or restarting the application) may be
  * needed to see all the index files after filesystem changes in
  * #DhBookListDirectory:directory.
+ *
+ * The docsets provided by zealcore are loaded in a worker thread, so the
+ * #DhBookListDirectory is initially empty: the #DhBook's are added with the
+ * #DhBookList::add-book signal as they are loaded, and the #DhBookList::refresh
+ * signal is emitted when the loading is done.
+ *
+ * At startup the catalog of the previous session, kept in the user cache
+ * directory, is shown right away. It is then reconciled with zealcore in the
+ * background, using the ETag of the cached catalog.
+ *
+ * A refresh doesn't clear the list: the loaded docsets are compared by ID with
+ * the current #DhBook's, and only the docsets that have been installed,
+ * removed or modified result in #DhBookList::add-book and
+ * #DhBookList::remove-book signals.
+ *
+ * The parsed catalog is kept as a #DhCatalog snapshot, along with an index of
+ * the #DhBook's by ID, so that the #DhBookTreeModel doesn't need to fetch and
+ * parse the catalog again.
+ *
+ * Once the catalog is up to date, the #DhSymbolIndex of its docsets is built in
+ * the background, for the #DhKeywordModel.
  */
 
 #define NEW_POSSIBLE_BOOK_TIMEOUT_SECS 5
@@ -73,6 +99,27 @@ typedef struct {
         /* List of NewPossibleBookData* */
         gint scale;
         GSList *new_possible_books_data;
+
+        /* While the catalog is being loaded: the DhBook's created by the
+         * worker thread and not yet added.
+         */
+        GCancellable *load_cancellable;
+        GAsyncQueue *loaded_books;
+        guint drain_timeout_id;
+
+        /* While the catalog is being loaded: docset ID -> owned DhBook*, the
+         * books present before the load and not seen again so far. Those
+         * left at the end are removed.
+         */
+        GHashTable *previous_books;
+
+        /* The catalog the current books come from, and its ETag. */
+        DhCatalog *catalog;
+        gchar *catalog_etag;
+
+        /* The symbols of the catalog, NULL until they are all fetched. */
+        DhSymbolIndex *symbol_index;
+        GCancellable *symbol_index_cancellable;
 } DhBookListDirectoryPrivate;
 
 enum {
@@ -177,7 +224,7 @@ create_book_from_index_file (DhBookListDirectory *list_directory,
         /* Check if book with same ID was already loaded (we need to force
          * unique book IDs).
          */
-        if (g_list_find_custom (books, book, (GCompareFunc)dh_book_cmp_by_id) != NULL) {
+        if (dh_book_list_find_by_id (DH_BOOK_LIST (list_directory), dh_book_get_id (book)) != NULL) {
                 g_object_unref (book);
                 return TRUE;
         }
@@ -303,101 +350,107 @@ monitor_books_directory (DhBookListDirectory *list_directory)
         }
 }
 
-static gboolean
-create_book_from_json_object (DhBookListDirectory *book_dir,
-                              JsonObject    *object)
-{
-        DhBookListDirectoryPrivate *priv;
-        DhBook *book;
-
-        priv = dh_book_list_directory_get_instance_private (book_dir);
-
-        book = dh_book_new_from_json (object, priv->scale);
-        if (book == NULL)
-                return FALSE;
-
+/* Time between two insertions of the books loaded so far by the worker
+ * thread, while the catalog is being loaded.
+ */
+#define LOADED_BOOKS_DRAIN_INTERVAL_MS 50
 
-        dh_book_list_add_book (DH_BOOK_LIST (book_dir), book);
+static void
+add_loaded_book (DhBookListDirectory *list_directory,
+                 DhBook              *book)
+{
+        dh_book_list_add_book (DH_BOOK_LIST (list_directory), book);
 
         g_signal_connect_object (book,
                                  "deleted",
                                  G_CALLBACK (book_deleted_cb),
-                                 book_dir,
+                                 list_directory,
                                  0);
 
         g_signal_connect_object (book,
                                  "updated",
                                  G_CALLBACK (book_updated_cb),
-                                 book_dir,
+                                 list_directory,
                                  0);
+}
 
-        return TRUE;
+static gboolean
+same_docset (DhBook *a,
+             DhBook *b)
+{
+        return (g_strcmp0 (dh_book_get_id (a), dh_book_get_id (b)) == 0 &&
+                g_strcmp0 (dh_book_get_title (a), dh_book_get_title (b)) == 0 &&
+                g_strcmp0 (dh_book_get_language (a), dh_book_get_language (b)) == 0 &&
+                g_strcmp0 (dh_book_get_id_for_removing (a), dh_book_get_id_for_removing (b)) == 0 &&
+                g_strcmp0 (dh_book_get_icon_b64 (a), dh_book_get_icon_b64 (b)) == 0);
 }
 
+/* Adds @book, unless the same docset was already in the list before the
+ * current load.
+ */
 static void
-print_doc (JsonArray *array,
-           guint index_,
-           JsonNode *element_node,
-           gpointer user_data)
+merge_loaded_book (DhBookListDirectory *list_directory,
+                   DhBook              *book)
 {
-        JsonObject *object = json_node_get_object(element_node);
+        DhBookListDirectoryPrivate *priv = dh_book_list_directory_get_instance_private (list_directory);
+        DhBook *previous_book = NULL;
+        const gchar *id = dh_book_get_id (book);
 
-        DhBookManager *manager = DH_BOOK_LIST_DIRECTORY (user_data);
+        if (priv->previous_books != NULL && id != NULL)
+                previous_book = g_hash_table_lookup (priv->previous_books, id);
 
-        create_book_from_json_object (manager, object);
-}
+        if (previous_book != NULL) {
+                gboolean unchanged = same_docset (previous_book, book);
 
-static void
-find_books (DhBookListDirectory *list_directory)
-{
-        SoupSession *session;
-        const char *uri;
-        GHashTable *hash;
-        SoupMessage *request;
-        SoupMessageBody *body;
-        SoupBuffer *buffer;
-        const gchar *data;
-        gsize length;
-        JsonParser *parser;
-        JsonNode *root;
-        JsonArray *array;
+                if (!unchanged)
+                        dh_book_list_remove_book (DH_BOOK_LIST (list_directory), previous_book);
 
-        GList* books = dh_book_list_get_books (DH_BOOK_LIST (list_directory));
+                g_hash_table_remove (priv->previous_books, id);
 
-        g_list_free_full (books, g_object_unref);
-        dh_book_list_set_books(DH_BOOK_LIST (list_directory), NULL);
+                if (unchanged)
+                        return;
+        }
 
-        parser = json_parser_new();
-        session = soup_session_new();
-        uri = "http://localhost:12340/item";
-        hash = g_hash_table_new(g_str_hash, g_str_equal);
-        request = soup_form_request_new_from_hash ("GET", uri, hash);
+        add_loaded_book (list_directory, book);
+}
+
+/* Removes the books that were present before the load but not in the new
+ * catalog.
+ */
+static void
+remove_previous_books (DhBookListDirectory *list_directory)
+{
+        DhBookListDirectoryPrivate *priv = dh_book_list_directory_get_instance_private (list_directory);
+        GHashTableIter iter;
+        gpointer id;
+        gpointer book;
 
-        soup_session_send_message (session, request);
-        g_object_get(request, "response-body", &body, NULL);
+        if (priv->previous_books == NULL)
+                return;
 
-        buffer = soup_message_body_flatten(body);
-        soup_buffer_get_data(buffer, (const guint8**)&data, &length);
-        json_parser_load_from_data(parser, data, length, NULL);
-        root = json_parser_get_root(parser);
-        array = json_node_get_array(root);
+        g_hash_table_iter_init (&iter, priv->previous_books);
+        while (g_hash_table_iter_next (&iter, &id, &book)) {
+                if (dh_book_list_find_by_id (DH_BOOK_LIST (list_directory), id) == book)
+                        dh_book_list_remove_book (DH_BOOK_LIST (list_directory), book);
+        }
 
-        json_array_foreach_element(array, print_doc, list_directory);
+        g_hash_table_remove_all (priv->previous_books);
+}
 
-        soup_buffer_free (buffer);
-        g_object_unref(parser);
-        soup_message_body_free (body);
-        g_hash_table_unref (hash);
-        g_object_unref (request);
-        g_object_unref (session);
+static void
+add_stackoverflow_book (DhBookListDirectory *list_directory)
+{
+        DhBookListDirectoryPrivate *priv = dh_book_list_directory_get_instance_private (list_directory);
+        JsonParser *parser;
+        DhBook *book;
+        gchar *rawjson;
 
         /// https://cdn.sstatic.net/Sites/stackoverflow/img/favicon.ico?v=4f32ecc8f43d
-        DhBookManager *manager = list_directory;
         const char *favicons[] = {
                 "iVBORw0KGgoAAAANSUhEUgAAABAAAAAQCAMAAAAoLQ9TAAAABGdBTUEAALGPC/xhBQAAACBjSFJNAAB6JgAAgIQAAPoAAACA6AAAdTAAAOpgAAA6mAAAF3CculE8AAAAb1BMVEUAAADycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAnycAmeo6nycAn////KsYcjAAAAInRSTlMAHcJkJ+gjSWvIAzriibZ+Exg2oHdGUYIPcdbTPaXvL129TyOK4gAAAAFiS0dEJLQG+ZkAAAAHdElNRQfiCRAQLzjsaQZEAAAAbUlEQVQY022OyQ6AIAxEBxVXxH1fUPz/f/QgpIT4Tp2XaVrAwuARhJ6IeOykMAHSLCdRiDKHrJxKLQPW8NakuCuAng/jZMS8rFs67yJyVvbj7BS9cPQJqxcS6iqlOG8btbnT2knj+SDhdTWBH16iswcK9IKYxwAAACV0RVh0ZGF0ZTpjcmVhdGUAMjAxOC0wOS0xNlQxNjo0Nzo1OCswMjowMHenmG0AAAAldEVYdGRhdGU6bW9kaWZ5ADIwMTgtMDktMTZUMTY6NDc6NTYrMDI6MDBWxVuMAAAAAElFTkSuQmCC",
                 "iVBORw0KGgoAAAANSUhEUgAAACAAAAAgCAMAAABEpIrGAAAABGdBTUEAALGPC/xhBQAAACBjSFJNAAB6JgAAgIQAAPoAAACA6AAAdTAAAOpgAAA6mAAAF3CculE8AAABQVBMVEX////0gCSeo6n0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCT0gCSeo6n///8Qpy7TAAAAaHRSTlMAAAA0yCwP79sQU/63AyqCiJb4ZwK0Vh/nogrY9S4YwNMmKPDeFATxVE27WkxQjgV+7txwJM/DHK7zZsLylAif6UYjMkli9+MVfOTZbD1KWylYx3i99MUxo+YNuPnNmmpXibrtHlGBEoEFhGAAAAABYktHRACIBR1IAAAAB3RJTUUH4gkQEC847GkGRAAAARdJREFUOMut0WdTwkAQBmA2SFCPIGCwF2LDSiwoNgRRREWx995f/v8f8ETHYZIlGRnfDzdzN8/s7e15PP8WYlMn8Db4HIHqR2OTY4VmgYBWC2hBubQAoVogHGkl0qMQbTxo7wA6u0jtRk8vX6GvH4gZNDCIoWG+yZGQQHyUxgTGNRuYmNTlOuWHSJjTQMIK1BnMzqlEyXlgIbW4tGwFwRUAq2mD1jJAdj3H9LCRiQAisKnntwop/hXbO7uyTHFv32efQ+ng8GvA5tGxJCfMJE+Bs/N0/sIk7+XVNQNu4qjk9u7+IWn5TUVR5E43Hp+eXyqoZAXl8u9nv769Rwsf9H3CgZ8wAFWpD7he4QLsUaqm5A7Y/AU45BMkqFCzuSQj1gAAACV0RVh0ZGF0ZTpjcmVhdGUAMjAxOC0wOS0xNlQxNjo0Nzo1OCswMjowMHenmG0AAAAldEVYdGRhdGU6bW9kaWZ5ADIwMTgtMDktMTZUMTY6NDc6NTYrMDI6MDBWxVuMAAAAAElFTkSuQmCC",
         };
-        const char *rawjson = g_strdup_printf(
+        rawjson = g_strdup_printf(
                 "{"
                 "\"Title\": \"Stack Overflow\","
                 "\"Id\": \"stackoverflow\","
@@ -407,22 +460,415 @@ find_books (DhBookListDirectory *list_directory)
                 "\"Language\": \"\""
                 "}",
                 favicons[0],
-                favicons[1],
-                NULL
+                favicons[1]
         );
         parser = json_parser_new();
 
         json_parser_load_from_data(parser, rawjson, strlen(rawjson), NULL);
 
-        DhBookListDirectoryPrivate *priv;
-        priv = dh_book_list_directory_get_instance_private (list_directory);
-        DhBook *book = dh_book_new_from_json(json_node_get_object(json_parser_get_root(parser)), priv->scale);
-        dh_book_list_add_book (DH_BOOK_LIST (list_directory), book);
+        book = dh_book_new_from_json(json_node_get_object(json_parser_get_root(parser)), priv->scale);
+        merge_loaded_book (list_directory, book);
 
+        g_object_unref (book);
         g_object_unref(parser);
         g_free(rawjson);
 }
 
+/* Shows the docsets of the previous session right away. */
+static void
+load_cached_books (DhBookListDirectory *list_directory)
+{
+        DhBookListDirectoryPrivate *priv = dh_book_list_directory_get_instance_private (list_directory);
+        GBytes *bytes;
+        gchar *etag = NULL;
+        DhCatalog *catalog;
+        gconstpointer contents;
+        gsize length;
+        guint i;
+
+        bytes = _dh_catalog_cache_load ("item", &etag);
+        if (bytes == NULL)
+                return;
+
+        contents = g_bytes_get_data (bytes, &length);
+        catalog = _dh_catalog_new_from_data (contents, length, NULL);
+        g_bytes_unref (bytes);
+
+        if (catalog == NULL) {
+                g_free (etag);
+                return;
+        }
+
+        /* Set before the books are added, for the "books-changed" handlers. */
+        _dh_catalog_unref (priv->catalog);
+        priv->catalog = catalog;
+
+        g_free (priv->catalog_etag);
+        priv->catalog_etag = etag;
+
+        dh_book_list_freeze_books_changed (DH_BOOK_LIST (list_directory));
+
+        for (i = 0; i < _dh_catalog_get_n_docsets (catalog); i++) {
+                DhBook *book;
+
+                book = dh_book_new_from_json (_dh_catalog_get_docset (catalog, i), priv->scale);
+                if (book != NULL) {
+                        add_loaded_book (list_directory, book);
+                        g_object_unref (book);
+                }
+        }
+
+        add_stackoverflow_book (list_directory);
+
+        dh_book_list_thaw_books_changed (DH_BOOK_LIST (list_directory));
+}
+
+typedef struct {
+        /* Shared with the main thread, which drains it. */
+        GAsyncQueue *loaded_books;
+        gint scale;
+
+        /* The ETag of the catalog the current books come from. */
+        gchar *etag;
+
+        /* Set by the worker thread. */
+        gchar *new_etag;
+        guint not_modified : 1;
+} LoadData;
+
+static LoadData *
+load_data_new (GAsyncQueue *loaded_books,
+               gint         scale,
+               const gchar *etag)
+{
+        LoadData *data;
+
+        data = g_new0 (LoadData, 1);
+        data->loaded_books = g_async_queue_ref (loaded_books);
+        data->scale = scale;
+        data->etag = g_strdup (etag);
+
+        return data;
+}
+
+static void
+load_data_free (gpointer _data)
+{
+        LoadData *data = _data;
+
+        if (data == NULL)
+                return;
+
+        g_async_queue_unref (data->loaded_books);
+        g_free (data->etag);
+        g_free (data->new_etag);
+        g_free (data);
+}
+
+/* Runs in a worker thread: fetches the catalog from zealcore and creates the
+ * DhBook's, pushing them one by one to the queue drained in the main thread.
+ * The response is read as a stream, so the books are created as the data
+ * arrives. Nothing is pushed if the catalog didn't change since the current
+ * books were loaded. The new catalog is saved in the cache, and returned as a
+ * DhCatalog.
+ */
+static void
+load_books_thread (GTask        *task,
+                   gpointer      source_object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
+{
+        LoadData *data = task_data;
+        SoupMessage *msg;
+        GInputStream *stream;
+        DhJsonArrayReader *reader;
+        DhCatalogCacheWriter *cache_writer;
+        DhCatalog *catalog;
+        JsonNode *element;
+        GError *error = NULL;
+
+        msg = _dh_core_client_new_message ("GET", "item");
+
+        if (data->etag != NULL)
+                soup_message_headers_append (msg->request_headers, "If-None-Match", data->etag);
+
+        /* Waits for zealcore, which may still be starting at the first load. */
+        stream = _dh_core_client_send_in_worker (msg, cancellable, &error);
+        if (stream == NULL) {
+                g_task_return_error (task, error);
+                goto out;
+        }
+
+        if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+                data->not_modified = TRUE;
+                g_task_return_pointer (task, NULL, NULL);
+                goto out;
+        }
+
+        if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
+                g_task_return_new_error (task,
+                                         G_IO_ERROR,
+                                         G_IO_ERROR_FAILED,
+                                         "Failed to get the list of docsets: %s",
+                                         msg->reason_phrase);
+                goto out;
+        }
+
+        data->new_etag = g_strdup (soup_message_headers_get_one (msg->response_headers, "ETag"));
+
+        reader = _dh_json_array_reader_new (stream);
+        cache_writer = _dh_catalog_cache_writer_new ("item", data->new_etag);
+        _dh_json_array_reader_set_data_func (reader, _dh_catalog_cache_writer_write, cache_writer);
+
+        catalog = _dh_catalog_new ();
+
+        while ((element = _dh_json_array_reader_next (reader, cancellable, &error)) != NULL) {
+                if (JSON_NODE_HOLDS_OBJECT (element)) {
+                        JsonObject *object = json_node_get_object (element);
+                        DhBook *book;
+
+                        _dh_catalog_add_docset (catalog, object);
+
+                        book = dh_book_new_from_json (object, data->scale);
+                        if (book != NULL)
+                                g_async_queue_push (data->loaded_books, book);
+                }
+
+                json_node_free (element);
+        }
+
+        if (error != NULL) {
+                g_task_return_error (task, error);
+                _dh_catalog_unref (catalog);
+        } else {
+                _dh_catalog_cache_writer_commit (cache_writer);
+                g_task_return_pointer (task, catalog, (GDestroyNotify) _dh_catalog_unref);
+        }
+
+        _dh_catalog_cache_writer_free (cache_writer);
+        _dh_json_array_reader_free (reader);
+
+out:
+        g_clear_object (&stream);
+        g_object_unref (msg);
+}
+
+static void
+drain_loaded_books (DhBookListDirectory *list_directory)
+{
+        DhBookListDirectoryPrivate *priv = dh_book_list_directory_get_instance_private (list_directory);
+        DhBook *book;
+
+        if (priv->loaded_books == NULL)
+                return;
+
+        dh_book_list_freeze_books_changed (DH_BOOK_LIST (list_directory));
+
+        while ((book = g_async_queue_try_pop (priv->loaded_books)) != NULL) {
+                merge_loaded_book (list_directory, book);
+                g_object_unref (book);
+        }
+
+        dh_book_list_thaw_books_changed (DH_BOOK_LIST (list_directory));
+}
+
+static gboolean
+drain_loaded_books_timeout_cb (gpointer user_data)
+{
+        DhBookListDirectory *list_directory = DH_BOOK_LIST_DIRECTORY (user_data);
+
+        drain_loaded_books (list_directory);
+
+        return G_SOURCE_CONTINUE;
+}
+
+static void
+stop_loading (DhBookListDirectory *list_directory)
+{
+        DhBookListDirectoryPrivate *priv = dh_book_list_directory_get_instance_private (list_directory);
+
+        if (priv->load_cancellable != NULL) {
+                g_cancellable_cancel (priv->load_cancellable);
+                g_clear_object (&priv->load_cancellable);
+        }
+
+        if (priv->drain_timeout_id != 0) {
+                g_source_remove (priv->drain_timeout_id);
+                priv->drain_timeout_id = 0;
+        }
+
+        if (priv->loaded_books != NULL) {
+                g_async_queue_unref (priv->loaded_books);
+                priv->loaded_books = NULL;
+        }
+
+        g_clear_pointer (&priv->previous_books, g_hash_table_unref);
+}
+
+static void
+build_symbol_index_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+        DhBookListDirectory *list_directory;
+        DhBookListDirectoryPrivate *priv;
+        DhSymbolIndex *symbol_index;
+        GError *error = NULL;
+
+        symbol_index = _dh_symbol_index_build_finish (result, &error);
+
+        /* Superseded by another build, or the object is disposed. */
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+                g_error_free (error);
+                return;
+        }
+
+        list_directory = DH_BOOK_LIST_DIRECTORY (user_data);
+        priv = dh_book_list_directory_get_instance_private (list_directory);
+        g_clear_object (&priv->symbol_index_cancellable);
+
+        if (error != NULL) {
+                g_warning ("Failed to build the symbol index: %s", error->message);
+                g_error_free (error);
+                return;
+        }
+
+        _dh_symbol_index_unref (priv->symbol_index);
+        priv->symbol_index = symbol_index;
+}
+
+static void
+build_symbol_index (DhBookListDirectory *list_directory)
+{
+        DhBookListDirectoryPrivate *priv = dh_book_list_directory_get_instance_private (list_directory);
+
+        if (!_dh_symbol_index_is_enabled () || priv->catalog == NULL)
+                return;
+
+        if (priv->symbol_index_cancellable != NULL)
+                g_cancellable_cancel (priv->symbol_index_cancellable);
+        g_clear_object (&priv->symbol_index_cancellable);
+
+        /* The callback doesn't take a reference: the build is cancelled when
+         * @list_directory is disposed.
+         */
+        priv->symbol_index_cancellable = g_cancellable_new ();
+        _dh_symbol_index_build_async (priv->catalog,
+                                      priv->symbol_index_cancellable,
+                                      build_symbol_index_cb,
+                                      list_directory);
+}
+
+static void
+load_books_cb (GObject      *source_object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+        DhBookListDirectory *list_directory = DH_BOOK_LIST_DIRECTORY (source_object);
+        DhBookListDirectoryPrivate *priv = dh_book_list_directory_get_instance_private (list_directory);
+        LoadData *data = g_task_get_task_data (G_TASK (result));
+        DhCatalog *catalog;
+        GError *error = NULL;
+        gboolean success;
+
+        catalog = g_task_propagate_pointer (G_TASK (result), &error);
+        success = error == NULL;
+        if (!success) {
+                /* Superseded by another load, or the object is disposed. */
+                if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+                        g_error_free (error);
+                        return;
+                }
+
+                g_warning ("%s", error->message);
+                g_clear_error (&error);
+        }
+
+        dh_book_list_freeze_books_changed (DH_BOOK_LIST (list_directory));
+
+        /* NULL if the catalog didn't change. The books drained while loading
+         * were published with the previous catalog (or none at the first
+         * start), so the "books-changed" handlers need to run again with this
+         * one, even if no book changes below.
+         */
+        if (catalog != NULL) {
+                _dh_catalog_unref (priv->catalog);
+                priv->catalog = catalog;
+                _dh_book_list_books_changed (DH_BOOK_LIST (list_directory));
+        }
+
+        /* The worker thread has finished, so this adds the remaining books. */
+        drain_loaded_books (list_directory);
+        add_stackoverflow_book (list_directory);
+
+        /* Don't empty the list if zealcore couldn't be reached, and keep it
+         * as is if the catalog didn't change.
+         */
+        if (success && !data->not_modified) {
+                remove_previous_books (list_directory);
+
+                g_free (priv->catalog_etag);
+                priv->catalog_etag = g_strdup (data->new_etag);
+        }
+
+        stop_loading (list_directory);
+        dh_book_list_thaw_books_changed (DH_BOOK_LIST (list_directory));
+
+        /* The symbols are fetched once the catalog is known to be current. */
+        if (success && (catalog != NULL || priv->symbol_index == NULL))
+                build_symbol_index (list_directory);
+
+        g_signal_emit_by_name (list_directory, "refresh");
+}
+
+/* Loads the catalog asynchronously. The new and modified books are added with
+ * the #DhBookList::add-book signal as they are created, the books no longer in
+ * the catalog are removed at the end, and then the #DhBookList::refresh signal
+ * is emitted.
+ */
+static void
+find_books (DhBookListDirectory *list_directory)
+{
+        DhBookListDirectoryPrivate *priv = dh_book_list_directory_get_instance_private (list_directory);
+        GList *l;
+        GTask *task;
+
+        stop_loading (list_directory);
+
+        if (dh_book_list_get_books (DH_BOOK_LIST (list_directory)) == NULL)
+                load_cached_books (list_directory);
+
+        priv->previous_books = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                      g_free,
+                                                      g_object_unref);
+
+        for (l = dh_book_list_get_books (DH_BOOK_LIST (list_directory)); l != NULL; l = l->next) {
+                DhBook *book = l->data;
+                const gchar *id = dh_book_get_id (book);
+
+                if (id != NULL)
+                        g_hash_table_replace (priv->previous_books, g_strdup (id), g_object_ref (book));
+        }
+
+        priv->load_cancellable = g_cancellable_new ();
+        priv->loaded_books = g_async_queue_new_full (g_object_unref);
+
+        task = g_task_new (list_directory, priv->load_cancellable, load_books_cb, NULL);
+        g_task_set_source_tag (task, find_books);
+        g_task_set_return_on_cancel (task, FALSE);
+        g_task_set_task_data (task,
+                              load_data_new (priv->loaded_books,
+                                             priv->scale,
+                                             priv->catalog_etag),
+                              load_data_free);
+        g_task_run_in_thread (task, load_books_thread);
+        g_object_unref (task);
+
+        priv->drain_timeout_id = g_timeout_add (LOADED_BOOKS_DRAIN_INTERVAL_MS,
+                                                drain_loaded_books_timeout_cb,
+                                                list_directory);
+}
+
 static void
 set_directory (DhBookListDirectory *list_directory,
                GFile               *directory)
@@ -440,9 +886,8 @@ dh_book_list_directory_refresh (DhBookList * object)
 {
         DhBookListDirectory *list_directory = DH_BOOK_LIST_DIRECTORY (object);
 
+        /* The "refresh" signal is emitted when the loading is done. */
         find_books (list_directory);
-
-        g_signal_emit_by_name (list_directory, "refresh");
 }
 
 
@@ -500,8 +945,18 @@ dh_book_list_directory_dispose (GObject *object)
         DhBookListDirectory *list_directory = DH_BOOK_LIST_DIRECTORY (object);
         DhBookListDirectoryPrivate *priv = dh_book_list_directory_get_instance_private (list_directory);
 
+        stop_loading (list_directory);
+
+        if (priv->symbol_index_cancellable != NULL) {
+                g_cancellable_cancel (priv->symbol_index_cancellable);
+                g_clear_object (&priv->symbol_index_cancellable);
+        }
+
         g_clear_object (&priv->directory);
         g_clear_object (&priv->directory_monitor);
+        g_clear_pointer (&priv->catalog, _dh_catalog_unref);
+        g_clear_pointer (&priv->catalog_etag, g_free);
+        g_clear_pointer (&priv->symbol_index, _dh_symbol_index_unref);
 
         g_slist_free_full (priv->new_possible_books_data, new_possible_book_data_free);
         priv->new_possible_books_data = NULL;
@@ -626,3 +1081,31 @@ dh_book_list_directory_get_directory (DhBookListDirectory *list_directory)
 
         return priv->directory;
 }
+
+/* Returns: (transfer none) (nullable): the catalog the books of
+ * @list_directory come from, or %NULL if it hasn't been loaded yet.
+ */
+DhCatalog *
+_dh_book_list_directory_get_catalog (DhBookListDirectory *list_directory)
+{
+        DhBookListDirectoryPrivate *priv;
+
+        g_return_val_if_fail (DH_IS_BOOK_LIST_DIRECTORY (list_directory), NULL);
+
+        priv = dh_book_list_directory_get_instance_private (list_directory);
+        return priv->catalog;
+}
+
+/* Returns: (transfer none) (nullable): the index of the symbols of the
+ * catalog, or %NULL if it isn't built yet.
+ */
+DhSymbolIndex *
+_dh_book_list_directory_get_symbol_index (DhBookListDirectory *list_directory)
+{
+        DhBookListDirectoryPrivate *priv;
+
+        g_return_val_if_fail (DH_IS_BOOK_LIST_DIRECTORY (list_directory), NULL);
+
+        priv = dh_book_list_directory_get_instance_private (list_directory);
+        return priv->symbol_index;
+}
@@ -113,9 +113,22 @@ generate_list (DhBookListSimple *list_simple)
 
                 for (book_node = books; book_node != NULL; book_node = book_node->next) {
                         DhBook *book = DH_BOOK (book_node->data);
-
-                        /* Ensure to have unique book IDs. */
-                        if (g_list_find_custom (ret, book, (GCompareFunc)dh_book_cmp_by_id) == NULL)
+                        GList *prev_node;
+                        gboolean taken = FALSE;
+
+                        /* Ensure to have unique book IDs: the ID must not be
+                         * in a previous sub-list.
+                         */
+                        for (prev_node = priv->sub_book_lists;
+                             prev_node != book_list_node;
+                             prev_node = prev_node->next) {
+                                if (dh_book_list_find_by_id (prev_node->data, dh_book_get_id (book)) != NULL) {
+                                        taken = TRUE;
+                                        break;
+                                }
+                        }
+
+                        if (!taken)
                                 ret = g_list_prepend (ret, g_object_ref (book));
                 }
         }
@@ -123,6 +136,9 @@ generate_list (DhBookListSimple *list_simple)
         return filter_by_books_disabled (list_simple, ret);
 }
 
+/* Emits ::books-changed only once, after all the add-book and remove-book
+ * signals.
+ */
 static void
 repopulate (DhBookListSimple *list_simple)
 {
@@ -131,42 +147,51 @@ repopulate (DhBookListSimple *list_simple)
         GList *new_list;
         GList *old_node;
         GList *new_node;
+        GHashTable *old_books;
+        GHashTable *new_books;
 
         old_list = dh_book_list_get_books (DH_BOOK_LIST (list_simple));
         old_list_copy = g_list_copy_deep (old_list, book_copy_func, NULL);
 
         new_list = generate_list (list_simple);
 
+        /* Sets of DhBook*, to compare the lists in linear time. */
+        old_books = g_hash_table_new (NULL, NULL);
+        for (old_node = old_list_copy; old_node != NULL; old_node = old_node->next)
+                g_hash_table_add (old_books, old_node->data);
+
+        new_books = g_hash_table_new (NULL, NULL);
+        for (new_node = new_list; new_node != NULL; new_node = new_node->next)
+                g_hash_table_add (new_books, new_node->data);
+
+        dh_book_list_freeze_books_changed (DH_BOOK_LIST (list_simple));
+
         for (old_node = old_list_copy; old_node != NULL; old_node = old_node->next) {
                 DhBook *old_book = DH_BOOK (old_node->data);
 
-                if (g_list_find (new_list, old_book) == NULL)
+                if (!g_hash_table_contains (new_books, old_book))
                         dh_book_list_remove_book (DH_BOOK_LIST (list_simple), old_book);
         }
 
         for (new_node = new_list; new_node != NULL; new_node = new_node->next) {
                 DhBook *new_book = DH_BOOK (new_node->data);
 
-                if (g_list_find (old_list_copy, new_book) == NULL)
+                if (!g_hash_table_contains (old_books, new_book))
                         dh_book_list_add_book (DH_BOOK_LIST (list_simple), new_book);
         }
 
+        dh_book_list_thaw_books_changed (DH_BOOK_LIST (list_simple));
+
+        g_hash_table_unref (old_books);
+        g_hash_table_unref (new_books);
         g_list_free_full (old_list_copy, g_object_unref);
         g_list_free_full (new_list, g_object_unref);
 }
 
+/* Only once per batch of changes in a sub-list, not for each book. */
 static void
-book_list_add_book_cb (DhBookList       *book_list,
-                       DhBook           *book,
-                       DhBookListSimple *list_simple)
-{
-        repopulate (list_simple);
-}
-
-static void
-book_list_remove_book_cb (DhBookList       *book_list,
-                          DhBook           *book,
-                          DhBookListSimple *list_simple)
+book_list_books_changed_cb (DhBookList       *book_list,
+                            DhBookListSimple *list_simple)
 {
         repopulate (list_simple);
 }
@@ -193,16 +218,10 @@ set_sub_book_lists (DhBookListSimple *list_simple,
                                                        g_object_ref (book_list));
 
                 g_signal_connect_object (book_list,
-                                         "add-book",
-                                         G_CALLBACK (book_list_add_book_cb),
+                                         "books-changed",
+                                         G_CALLBACK (book_list_books_changed_cb),
                                          list_simple,
-                                         G_CONNECT_AFTER);
-
-                g_signal_connect_object (book_list,
-                                         "remove-book",
-                                         G_CALLBACK (book_list_remove_book_cb),
-                                         list_simple,
-                                         G_CONNECT_AFTER);
+                                         0);
         }
 
         priv->sub_book_lists = g_list_reverse (priv->sub_book_lists);
@@ -34,6 +34,11 @@
  * and removed with the #DhBookList::add-book and #DhBookList::remove-book
  * signals, and returns that #GList in dh_book_list_get_books().
  *
+ * After one or several #DhBookList::add-book and #DhBookList::remove-book
+ * signals, the #DhBookList::books-changed signal is emitted once. Listeners
+ * that rebuild a whole view should use it instead of the per-book signals. See
+ * dh_book_list_freeze_books_changed().
+ *
  * The #DhBookList base class doesn't listen to the #DhBook #DhBook::deleted and
  * #DhBook::updated signals. It is for example handled by #DhBookListDirectory.
  */
@@ -43,6 +48,7 @@ enum {
     SIGNAL_ADD_BOOK,
     SIGNAL_REMOVE_BOOK,
     SIGNAL_REFRESH,
+    SIGNAL_BOOKS_CHANGED,
     N_SIGNALS
 };
 
@@ -51,6 +57,16 @@ guint signals[N_SIGNALS] = { 0 };
 typedef struct {
         /* The list of DhBook's. */
         GList *books;
+
+        /* Index of @books: book ID -> its GList node in @books, with the same
+         * case-insensitive comparison as dh_book_cmp_by_id(). The keys are
+         * owned by the DhBook's.
+         */
+        GHashTable *nodes_by_id;
+
+        /* See dh_book_list_freeze_books_changed(). */
+        guint books_changed_freeze_count;
+        guint books_changed_pending : 1;
 } DhBookListPrivate;
 
 
@@ -58,14 +74,71 @@ static DhBookList *default_instance = NULL;
 
 G_DEFINE_TYPE_WITH_PRIVATE (DhBookList, dh_book_list, G_TYPE_OBJECT)
 
+static guint
+book_id_hash (gconstpointer key)
+{
+        const gchar *p;
+        guint hash = 5381;
+
+        for (p = key; *p != '\0'; p++)
+                hash = (hash << 5) + hash + g_ascii_tolower (*p);
+
+        return hash;
+}
+
+static gboolean
+book_id_equal (gconstpointer a,
+               gconstpointer b)
+{
+        return g_ascii_strcasecmp (a, b) == 0;
+}
+
+static void
+index_book (DhBookList *book_list,
+            GList      *node)
+{
+        DhBookListPrivate *priv = dh_book_list_get_instance_private (book_list);
+        DhBook *book = node->data;
+        const gchar *id;
+
+        id = dh_book_get_id (book);
+        if (id != NULL)
+                g_hash_table_insert (priv->nodes_by_id, (gpointer) id, node);
+}
+
+static void
+unindex_book (DhBookList *book_list,
+              DhBook     *book)
+{
+        DhBookListPrivate *priv = dh_book_list_get_instance_private (book_list);
+        const gchar *id;
+
+        id = dh_book_get_id (book);
+        if (id != NULL)
+                g_hash_table_remove (priv->nodes_by_id, id);
+}
+
+static void
+reindex_books (DhBookList *book_list)
+{
+        DhBookListPrivate *priv = dh_book_list_get_instance_private (book_list);
+        GList *l;
+
+        g_hash_table_remove_all (priv->nodes_by_id);
+
+        for (l = priv->books; l != NULL; l = l->next)
+                index_book (book_list, l);
+}
+
 static gboolean
 book_id_present_in_list (DhBookList *book_list,
                          DhBook     *book)
 {
         DhBookListPrivate *priv = dh_book_list_get_instance_private (book_list);
-        return g_list_find_custom (priv->books,
-                                   book,
-                                   (GCompareFunc) dh_book_cmp_by_id) != NULL;
+        const gchar *id = dh_book_get_id (book);
+
+        /* Like dh_book_cmp_by_id(), a NULL ID never matches. */
+        return id != NULL && g_hash_table_contains (priv->nodes_by_id, id);
 }
 
 static void
@@ -74,6 +147,7 @@ dh_book_list_dispose (GObject *object)
         DhBookList *book_list = DH_BOOK_LIST (object);
         DhBookListPrivate *priv = dh_book_list_get_instance_private (book_list);
 
+        g_hash_table_remove_all (priv->nodes_by_id);
         g_list_free_full (priv->books, g_object_unref);
         priv->books = NULL;
 
@@ -83,9 +157,14 @@ dh_book_list_dispose (GObject *object)
 static void
 dh_book_list_finalize (GObject *object)
 {
-        if (default_instance == DH_BOOK_LIST (object))
+        DhBookList *book_list = DH_BOOK_LIST (object);
+        DhBookListPrivate *priv = dh_book_list_get_instance_private (book_list);
+
+        if (default_instance == book_list)
                 default_instance = NULL;
 
+        g_hash_table_unref (priv->nodes_by_id);
+
         G_OBJECT_CLASS (dh_book_list_parent_class)->finalize (object);
 }
 
@@ -98,6 +177,7 @@ dh_book_list_add_book_default (DhBookList *book_list,
 
         priv->books = g_list_prepend (priv->books,
                                       g_object_ref (book));
+        index_book (book_list, priv->books);
 }
 
 static void
@@ -105,15 +185,21 @@ dh_book_list_remove_book_default (DhBookList *book_list,
                                   DhBook     *book)
 {
         DhBookListPrivate *priv = dh_book_list_get_instance_private (book_list);
-        GList *node;
+        const gchar *id;
+        GList *node = NULL;
 
-        node = g_list_find (priv->books, book);
-        g_return_if_fail (node != NULL);
+        id = dh_book_get_id (book);
+        if (id != NULL)
+                node = g_hash_table_lookup (priv->nodes_by_id, id);
 
-        priv->books = g_list_delete_link (priv->books, node);
+        /* The books without ID are not indexed. */
+        if (node == NULL)
+                node = g_list_find (priv->books, book);
 
-        if (g_list_find (priv->books, book) != NULL)
-                g_warning ("The same DhBook was inserted several times.");
+        g_return_if_fail (node != NULL && node->data == book);
+
+        unindex_book (book_list, book);
+        priv->books = g_list_delete_link (priv->books, node);
 
         g_object_unref (book);
 }
@@ -133,6 +219,7 @@ dh_book_list_set_books_default (DhBookList *book_list, GList* list)
         DhBookListPrivate *priv = dh_book_list_get_instance_private (book_list);
 
         priv->books = list;
+        reindex_books (book_list);
 }
 
 static void
@@ -189,8 +276,8 @@ dh_book_list_class_init (DhBookListClass *klass)
          * #DhBookList.
          *
          * The default object method handler removes @book from the internal
-         * #GList of @book_list, and verifies that @book was present in the list
-         * and that @book was not inserted several times.
+         * #GList of @book_list, and verifies that @book was present in the
+         * list.
          *
          * Since: 3.30
          */
@@ -203,6 +290,14 @@ dh_book_list_class_init (DhBookListClass *klass)
                               G_TYPE_NONE,
                               1, DH_TYPE_BOOK);
 
+        /**
+         * DhBookList::refresh:
+         * @book_list: the #DhBookList emitting the signal.
+         *
+         * The ::refresh signal is emitted when @book_list has finished
+         * (re)loading its books, after the corresponding
+         * #DhBookList::add-book signals. See dh_book_list_refresh().
+         */
         signals[SIGNAL_REFRESH] =
                 g_signal_new ("refresh",
                           G_TYPE_FROM_CLASS (klass),
@@ -211,11 +306,35 @@ dh_book_list_class_init (DhBookListClass *klass)
                           NULL, NULL, NULL,
                           G_TYPE_NONE,
                           0);
+
+        /**
+         * DhBookList::books-changed:
+         * @book_list: the #DhBookList emitting the signal.
+         *
+         * The ::books-changed signal is emitted after the
+         * #DhBookList::add-book and #DhBookList::remove-book signals. When
+         * several books are added or removed in a row, for example when the
+         * list is refreshed, it is emitted only once at the end.
+         *
+         * Since: 3.32
+         */
+        signals[SIGNAL_BOOKS_CHANGED] =
+                g_signal_new ("books-changed",
+                              G_TYPE_FROM_CLASS (klass),
+                              G_SIGNAL_RUN_LAST,
+                              0,
+                              NULL, NULL, NULL,
+                              G_TYPE_NONE,
+                              0);
 }
 
 static void
 dh_book_list_init (DhBookList *book_list)
 {
+        DhBookListPrivate *priv = dh_book_list_get_instance_private (book_list);
+
+        priv->nodes_by_id = g_hash_table_new (book_id_hash, book_id_equal);
+
         if (default_instance == NULL) {
                 default_instance = book_list;
         }
@@ -297,6 +416,36 @@ dh_book_list_get_books (DhBookList *book_list)
         return DH_BOOK_LIST_GET_CLASS (book_list)->get_books (book_list);
 }
 
+/**
+ * dh_book_list_find_by_id:
+ * @book_list: a #DhBookList.
+ * @book_id: a book ID.
+ *
+ * Finds the #DhBook whose ID is @book_id, compared like dh_book_cmp_by_id().
+ * It is looked for in the internal #GList of @book_list, in constant time.
+ *
+ * Returns: (transfer none) (nullable): the #DhBook with the @book_id ID, or
+ * %NULL.
+ * Since: 3.32
+ */
+DhBook *
+dh_book_list_find_by_id (DhBookList  *book_list,
+                         const gchar *book_id)
+{
+        DhBookListPrivate *priv;
+        GList *node;
+
+        g_return_val_if_fail (DH_IS_BOOK_LIST (book_list), NULL);
+
+        if (book_id == NULL)
+                return NULL;
+
+        priv = dh_book_list_get_instance_private (book_list);
+        node = g_hash_table_lookup (priv->nodes_by_id, book_id);
+
+        return node != NULL ? node->data : NULL;
+}
+
 GList *
 dh_book_list_set_books (DhBookList *book_list, GList *list)
 {
@@ -305,6 +454,20 @@ dh_book_list_set_books (DhBookList *book_list, GList *list)
         return DH_BOOK_LIST_GET_CLASS (book_list)->set_books (book_list, list);
 }
 
+static void
+books_changed (DhBookList *book_list)
+{
+        DhBookListPrivate *priv = dh_book_list_get_instance_private (book_list);
+
+        if (priv->books_changed_freeze_count > 0) {
+                priv->books_changed_pending = TRUE;
+                return;
+        }
+
+        priv->books_changed_pending = FALSE;
+        g_signal_emit (book_list, signals[SIGNAL_BOOKS_CHANGED], 0);
+}
+
 /**
  * dh_book_list_add_book:
  * @book_list: a #DhBookList.
@@ -328,6 +491,8 @@ dh_book_list_add_book (DhBookList *book_list,
                        signals[SIGNAL_ADD_BOOK],
                        0,
                        book);
+
+        books_changed (book_list);
 }
 
 /**
@@ -357,5 +522,69 @@ dh_book_list_remove_book (DhBookList *book_list,
                        0,
                        book);
 
+        books_changed (book_list);
+
         g_object_unref (book);
 }
+
+/**
+ * dh_book_list_freeze_books_changed:
+ * @book_list: a #DhBookList.
+ *
+ * Delays the #DhBookList::books-changed signal until
+ * dh_book_list_thaw_books_changed() is called, so that adding or removing
+ * several books results in only one emission.
+ *
+ * Like g_object_freeze_notify(), there is a freeze count: the signal is emitted
+ * when the last dh_book_list_thaw_books_changed() is called, and only if books
+ * have been added or removed in the meantime.
+ *
+ * Since: 3.32
+ */
+void
+dh_book_list_freeze_books_changed (DhBookList *book_list)
+{
+        DhBookListPrivate *priv;
+
+        g_return_if_fail (DH_IS_BOOK_LIST (book_list));
+
+        priv = dh_book_list_get_instance_private (book_list);
+        priv->books_changed_freeze_count++;
+}
+
+/**
+ * dh_book_list_thaw_books_changed:
+ * @book_list: a #DhBookList.
+ *
+ * Reverts the effect of a previous call to
+ * dh_book_list_freeze_books_changed().
+ *
+ * Since: 3.32
+ */
+void
+dh_book_list_thaw_books_changed (DhBookList *book_list)
+{
+        DhBookListPrivate *priv;
+
+        g_return_if_fail (DH_IS_BOOK_LIST (book_list));
+
+        priv = dh_book_list_get_instance_private (book_list);
+        g_return_if_fail (priv->books_changed_freeze_count > 0);
+
+        priv->books_changed_freeze_count--;
+
+        if (priv->books_changed_freeze_count == 0 && priv->books_changed_pending)
+                books_changed (book_list);
+}
+
+/* Emits #DhBookList::books-changed (or delays it if frozen) when the books
+ * didn't change but what the handlers read about them did, for example the
+ * catalog of a #DhBookListDirectory.
+ */
+void
+_dh_book_list_books_changed (DhBookList *book_list)
+{
+        g_return_if_fail (DH_IS_BOOK_LIST (book_list));
+
+        books_changed (book_list);
+}
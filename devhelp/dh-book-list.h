@@ -62,11 +62,17 @@ void            dh_book_list_refresh            (DhBookList* book_list);
 G_GNUC_INTERNAL
 void        _dh_book_list_unref_default (void);
 GList      *dh_book_list_get_books      (DhBookList *book_list);
+DhBook     *dh_book_list_find_by_id     (DhBookList  *book_list,
+                                         const gchar *book_id);
 GList      *dh_book_list_set_books          (DhBookList *book_list, GList *books);
 void        dh_book_list_add_book       (DhBookList *book_list,
                                          DhBook     *book);
 void        dh_book_list_remove_book    (DhBookList *book_list,
                                          DhBook     *book);
+void        dh_book_list_freeze_books_changed (DhBookList *book_list);
+void        dh_book_list_thaw_books_changed   (DhBookList *book_list);
+G_GNUC_INTERNAL
+void        _dh_book_list_books_changed       (DhBookList *book_list);
 
 G_END_DECLS
 
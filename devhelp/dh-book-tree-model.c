@@ -19,24 +19,53 @@
 
 #include "dh-book-tree-model.h"
 #include <gtk/gtk.h>
+#include <string.h>
+#include <glib/gi18n.h>
 #include <json-glib/json-glib.h>
 #include <libsoup/soup.h>
 #include "dh-book.h"
 #include "dh-book-list.h"
+#include "dh-book-list-directory.h"
+#include "dh-catalog.h"
+#include "dh-core-client.h"
+#include "dh-core-endpoint.h"
+#include "dh-json-array-reader.h"
 
 
-typedef struct {
+typedef enum {
+        LAZY_CHILDREN_NOT_FETCHED,
+        LAZY_CHILDREN_FETCHING,
+        LAZY_CHILDREN_FETCHED
+} LazyChildrenState;
+
+typedef struct _DhBookTreeModelNode DhBookTreeModelNode;
+
+struct _DhBookTreeModelNode {
         gchar *title;
         gchar *symbolchapterpath;
         JsonObject* object;
-        GtkTreePath *path;
-        GList *children;
+
+        /* NULL for the root nodes. The position in the parent's children
+         * (or in the root nodes) is kept up to date, so that getting the
+         * path or the next sibling doesn't need any lookup.
+         */
+        DhBookTreeModelNode *parent;
+        guint index;
+
+        /* Owned DhBookTreeModelNode*, NULL when there are no children. */
+        GPtrArray *children;
+
         gboolean lazy_has_children;
         gchar *lazy_children_url;
+        LazyChildrenState lazy_state;
+        gboolean is_placeholder;
         gchar *symbol_tp;
         DhLink *link;
         DhBook *book;
-} DhBookTreeModelNode;
+
+        /* For the language nodes: the book whose icon is shown. */
+        DhBook *icon_book;
+};
 
 static gint
 compare_strs (gconstpointer a,
@@ -45,6 +74,19 @@ compare_strs (gconstpointer a,
         return g_strcmp0(a, b);
 }
 
+/* The catalog is loaded asynchronously by the default #DhBookList, docsets not
+ * loaded yet are skipped, the tree is rebuilt on its "books-changed" signal.
+ */
+static DhBook *
+find_loaded_book (DhBookListDirectory *list_directory,
+                  JsonObject          *object)
+{
+        return dh_book_list_find_by_id (DH_BOOK_LIST (list_directory),
+                                        json_object_get_string_member (object, "Id"));
+}
+
+static void free_node (DhBookTreeModelNode *node);
+
 static DhBookTreeModelNode* new_empty_node ()
 {
         DhBookTreeModelNode *node = malloc (sizeof(DhBookTreeModelNode));
@@ -52,28 +94,70 @@ static DhBookTreeModelNode* new_empty_node ()
         return node;
 }
 
+static guint
+node_get_n_children (DhBookTreeModelNode *node)
+{
+        return node->children != NULL ? node->children->len : 0;
+}
+
+static DhBookTreeModelNode *
+node_get_nth_child (DhBookTreeModelNode *node,
+                    guint                n)
+{
+        if (n >= node_get_n_children (node))
+                return NULL;
+
+        return g_ptr_array_index (node->children, n);
+}
+
+static void
+node_insert_child (DhBookTreeModelNode *node,
+                   guint                index_,
+                   DhBookTreeModelNode *child)
+{
+        guint i;
+
+        if (node->children == NULL)
+                node->children = g_ptr_array_new_with_free_func ((GDestroyNotify) free_node);
+
+        g_ptr_array_insert (node->children, index_, child);
+        child->parent = node;
+
+        for (i = index_; i < node->children->len; i++) {
+                DhBookTreeModelNode *sibling = g_ptr_array_index (node->children, i);
+                sibling->index = i;
+        }
+}
+
+static void
+node_append_child (DhBookTreeModelNode *node,
+                   DhBookTreeModelNode *child)
+{
+        node_insert_child (node, node_get_n_children (node), child);
+}
+
+static GtkTreePath *
+node_get_path (DhBookTreeModelNode *node)
+{
+        GtkTreePath *path = gtk_tree_path_new ();
+
+        for (; node != NULL; node = node->parent)
+                gtk_tree_path_prepend_index (path, node->index);
+
+        return path;
+}
+
 static DhBookTreeModelNode*
 new_dynamic_symbols_node(JsonObject  *object,
                          const gchar *symbol_type,
                          gint         count,
-                         GtkTreePath *parent,
-                         gint         num,
                          const gchar *title,
                          const gchar *tp,
                          const char  *URL,
-                         const char  *book_title)
+                         DhBook      *book)
 {
         DhBookTreeModelNode *node = new_empty_node();
-        JsonObject *counts;
-        JsonObjectIter iter;
-        GList *symbols;
-        const gchar *member_name;
-        JsonNode *member_node;
         size_t len;
-        GList *books = dh_book_list_get_books (dh_book_list_get_default (
-                -1  // at this point it should be created outside
-        ));
-        DhBook *book;
 
         if (title == NULL) {
                 len = strlen (symbol_type);
@@ -85,29 +169,20 @@ new_dynamic_symbols_node(JsonObject  *object,
                 memcpy(node->title, title, len + 1);
         }
         node->children = NULL;
-        node->path = gtk_tree_path_copy (parent);
-
-        node->book = NULL;
-        while (books) {
-                book = books->data;
-                if (g_str_equal(book_title, dh_book_get_title(book))) {
-                        node->book = book;
-                }
-                books = books->next;
-        }
-        g_assert(node->book != NULL);
+        node->book = book;
 
         node->link = dh_link_new (DH_LINK_TYPE_KEYWORD, NULL, node->title, URL);
-        gtk_tree_path_append_index(node->path, num);
 
         if (title == NULL || g_str_equal(tp, "chapters")) {
                 // only 1st level of symbols
                 // (chapters need querying on all levels because we don't know in advance
                 //  if they have children)
-                node->lazy_children_url = g_strjoin("",
-                                                    "http://localhost:12340/item/",
-                                                    json_object_get_string_member(object, "Id"),
-                                                    "/", tp, "/", symbol_type, NULL);
+                gchar *path = g_strjoin("",
+                                        "item/",
+                                        json_object_get_string_member(object, "Id"),
+                                        "/", tp, "/", symbol_type, NULL);
+                node->lazy_children_url = _dh_core_endpoint_get_uri (path);
+                g_free (path);
         } else {
                 node->lazy_children_url = NULL;
         }
@@ -122,7 +197,7 @@ new_dynamic_symbols_node(JsonObject  *object,
 
 
 static DhBookTreeModelNode*
-new_symbols_node(JsonObject* object, GtkTreePath *parent, gint num, const gchar* title, const gchar* book_title)
+new_symbols_node(JsonObject* object, const gchar* title, DhBook *book)
 {
         DhBookTreeModelNode *node = new_empty_node();
         node->lazy_children_url = NULL;
@@ -132,11 +207,6 @@ new_symbols_node(JsonObject* object, GtkTreePath *parent, gint num, const gchar*
         const gchar *member_name;
         JsonNode *member_node;
         size_t len;
-        GList *books = dh_book_list_get_books (dh_book_list_get_default (
-                -1  // at this point it should be already created outside
-        ));
-        DhBook *book;
-        gint i;
 
         if (title == NULL) {
                 title = "Symbols";
@@ -145,39 +215,22 @@ new_symbols_node(JsonObject* object, GtkTreePath *parent, gint num, const gchar*
         node->title = malloc (len + 1);
         memcpy(node->title, title, len + 1);
         node->children = NULL;
-        if (parent != NULL) {
-                node->path = gtk_tree_path_copy (parent);
-        } else {
-                node->path = gtk_tree_path_new ();
-        }
         node->link = NULL;
-        node->book = NULL;
-        while (books) {
-                book = books->data;
-                if (g_str_equal(book_title, dh_book_get_title(book))) {
-                        node->book = book;
-                }
-                books = books->next;
-        }
-        g_assert(node->book != NULL);
-        gtk_tree_path_append_index(node->path, num);
-
+        node->book = book;
 
         counts = json_object_get_object_member (object, "SymbolCounts");
         json_object_iter_init (&iter, counts);
         symbols = NULL;
         while(json_object_iter_next(&iter, &member_name, &member_node)) {
-                symbols = g_list_append (symbols, member_name);
+                symbols = g_list_prepend (symbols, (gpointer) member_name);
         }
         symbol = symbols = g_list_sort (symbols, compare_strs);
-        i = 0;
         while(symbol) {
-                node->children = g_list_append(node->children,
-                                               new_dynamic_symbols_node (object,
-                                                                         symbol->data,
-                                                                         json_object_get_int_member(counts, symbol->data),
-                                                                         node->path,
-                                                                         i++, NULL, "symbols", NULL, book_title));
+                node_append_child (node,
+                                   new_dynamic_symbols_node (object,
+                                                             symbol->data,
+                                                             json_object_get_int_member(counts, symbol->data),
+                                                             NULL, "symbols", NULL, book));
                 symbol = symbol->next;
         }
         g_list_free(symbols);
@@ -185,63 +238,42 @@ new_symbols_node(JsonObject* object, GtkTreePath *parent, gint num, const gchar*
 }
 
 static DhBookTreeModelNode*
-new_node (JsonObject* object, GtkTreePath *parent, gint num)
+new_node (JsonObject* object, DhBook *book)
 {
-        DhBookTreeModelNode *node = new_empty_node();
-        node->lazy_children_url = NULL;
+        DhBookTreeModelNode *node;
         const gchar* title;
         size_t len;
-        GList *books = dh_book_list_get_books (dh_book_list_get_default (
-                -1  // at this point it should be already created outside
-        ));
-        DhBook *book;
 
         title = json_object_get_string_member(object, "Title");
 
         if (g_str_has_prefix (json_object_get_string_member(object, "SourceId"), "com.kapeli")) {
-                return new_symbols_node (object, parent, num, title, title);
-        } else {
-                len = strlen (title);
-                node->title = malloc (len + 1);
-                memcpy(node->title, title, len + 1);
-                node->children = NULL;
-
-
-                if (parent != NULL) {
-                        node->path = gtk_tree_path_copy (parent);
-                } else {
-                        node->path = gtk_tree_path_new ();
-                }
-
-                node->link = NULL;
-                node->book = NULL;
-                while (books) {
-                        book = books->data;
-                        if (g_str_equal(title, dh_book_get_title(book))) {
-                                node->book = book;
-                        }
-                        books = books->next;
-                }
-                g_assert(node->book != NULL);
-                gtk_tree_path_append_index(node->path, num);
-                node->children = g_list_append(node->children,
-                                               new_dynamic_symbols_node (object,
-                                                                         "",
-                                                                         0,
-                                                                         node->path,
-                                                                         0,
-                                                                         "Chapters",
-                                                                         "chapters",
-                                                                         NULL,
-                                                                         title));
-                g_list_append(node->children, new_symbols_node (object, node->path, 1, NULL, title));
+                return new_symbols_node (object, title, book);
         }
 
+        node = new_empty_node();
+        node->lazy_children_url = NULL;
+        len = strlen (title);
+        node->title = malloc (len + 1);
+        memcpy(node->title, title, len + 1);
+        node->children = NULL;
+        node->link = NULL;
+        node->book = book;
+
+        node_append_child (node,
+                           new_dynamic_symbols_node (object,
+                                                     "",
+                                                     0,
+                                                     "Chapters",
+                                                     "chapters",
+                                                     NULL,
+                                                     book));
+        node_append_child (node, new_symbols_node (object, NULL, book));
+
         return node;
 }
 
 static DhBookTreeModelNode*
-new_lang_node (const gchar* title, GtkTreePath *parent, gint num) {
+new_lang_node (const gchar* title) {
         DhBookTreeModelNode *node = new_empty_node();
         node->lazy_children_url = NULL;
         size_t len;
@@ -249,15 +281,7 @@ new_lang_node (const gchar* title, GtkTreePath *parent, gint num) {
         node->title = malloc (len + 1);
         memcpy(node->title, title, len + 1);
         node->children = NULL;
-        if (parent != NULL) {
-                node->path = gtk_tree_path_copy (parent);
-        } else {
-                node->path = gtk_tree_path_new ();
-        }
-
         node->link = NULL;
-
-        gtk_tree_path_append_index(node->path, num);
         return node;
 }
 
@@ -270,14 +294,25 @@ typedef struct {
          * don't need to check if priv->links == NULL.
          */
         GQueue links;
-        GList *root_nodes;
+
+        /* Owned DhBookTreeModelNode*. */
+        GPtrArray *root_nodes;
+
+        /* Indexes of the nodes that have a link, filled as the lazy children
+         * arrive, so that nothing is fetched to find a URI:
+         * - URI -> the first node with that URI.
+         * - URI without the anchor -> the first node on that page.
+         * The keys are owned, the nodes are owned by the tree.
+         */
+        GHashTable *nodes_by_uri;
+        GHashTable *nodes_by_page;
 
         gboolean group_by_language;
-        gint langcount;
         gint stamp;
-        const gchar *currently_adding_language;
-        JsonArray *array;
         gint scale;
+
+        /* Cancels the fetches of the lazy children. */
+        GCancellable *cancellable;
 } DhBookTreeModelPrivate;
 
 static void dh_book_tree_model_tree_model_init (GtkTreeModelIface *iface);
@@ -295,9 +330,6 @@ free_node(DhBookTreeModelNode *node) {
         if (node->object != NULL) {
                 json_object_unref (node->object);
         }
-        if (node->path != NULL) {
-                gtk_tree_path_free (node->path);
-        }
         if (node->lazy_children_url != NULL) {
                 free(node->lazy_children_url);
         }
@@ -307,132 +339,139 @@ free_node(DhBookTreeModelNode *node) {
         if (node->link != NULL) {
                 dh_link_unref (node->link);
         }
-        g_list_free_full(node->children, (GDestroyNotify)free_node);
+        if (node->children != NULL) {
+                g_ptr_array_unref (node->children);
+        }
         free(node);
 }
 
-
 static void
-dh_book_tree_model_finalize (GObject *object)
+append_root_node (DhBookTreeModelPrivate *priv,
+                  DhBookTreeModelNode    *node)
 {
-        DhBookTreeModel *model = DH_BOOK_TREE_MODEL (object);
-        DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (model);
-        g_list_free_full (priv->root_nodes, (GDestroyNotify)free_node);
-        G_OBJECT_CLASS (dh_book_tree_model_parent_class)->finalize (object);
+        node->parent = NULL;
+        node->index = priv->root_nodes->len;
+        g_ptr_array_add (priv->root_nodes, node);
 }
 
-static void
-dh_book_tree_model_class_init (DhBookTreeModelClass *klass)
+static GPtrArray *
+get_siblings (DhBookTreeModelPrivate *priv,
+              DhBookTreeModelNode    *node)
 {
-        GObjectClass *object_class = G_OBJECT_CLASS (klass);
-
-        object_class->finalize = dh_book_tree_model_finalize;
+        return node->parent != NULL ? node->parent->children : priv->root_nodes;
 }
 
 static void
-print_doc (JsonArray *array,
-           guint index_,
-           JsonNode *element_node,
-           gpointer user_data)
+dh_book_tree_model_dispose (GObject *object)
 {
-        JsonObject *object;
-        DhBookTreeModelPrivate *priv;
-        DhBookTreeModelNode *node;
+        DhBookTreeModel *model = DH_BOOK_TREE_MODEL (object);
+        DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (model);
 
-        priv = dh_book_tree_model_get_instance_private (DH_BOOK_TREE_MODEL (user_data));
+        if (priv->cancellable != NULL) {
+                g_cancellable_cancel (priv->cancellable);
+                g_clear_object (&priv->cancellable);
+        }
 
-        object = json_node_get_object(element_node);
-        node = new_node (object, NULL, index_);
-        priv->root_nodes = g_list_append (priv->root_nodes, node);
+        G_OBJECT_CLASS (dh_book_tree_model_parent_class)->dispose (object);
 }
 
 static void
-extract_language (JsonArray *array,
-                  guint index_,
-                  JsonNode *element_node,
-                  gpointer user_data)
+dh_book_tree_model_finalize (GObject *object)
 {
-        GHashTable *table = user_data;
-        JsonObject *object;
-        object = json_node_get_object(element_node);
-        g_hash_table_add(table, json_object_get_string_member(object, "Language"));
+        DhBookTreeModel *model = DH_BOOK_TREE_MODEL (object);
+        DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (model);
+        g_ptr_array_unref (priv->root_nodes);
+        g_hash_table_unref (priv->nodes_by_uri);
+        g_hash_table_unref (priv->nodes_by_page);
+        G_OBJECT_CLASS (dh_book_tree_model_parent_class)->finalize (object);
 }
 
 static void
-add_language (gpointer data,
-              gpointer user_data)
+dh_book_tree_model_class_init (DhBookTreeModelClass *klass)
 {
-        DhBookTreeModelPrivate *priv;
-        DhBookTreeModelNode *node;
+        GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+        object_class->dispose = dh_book_tree_model_dispose;
+        object_class->finalize = dh_book_tree_model_finalize;
+}
+
+static void
+add_books (DhBookTreeModel     *model,
+           DhBookListDirectory *list_directory,
+           DhCatalog           *catalog)
+{
+        DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (model);
+        guint i;
 
-        priv = dh_book_tree_model_get_instance_private (DH_BOOK_TREE_MODEL (user_data));
+        for (i = 0; i < _dh_catalog_get_n_docsets (catalog); i++) {
+                JsonObject *object = _dh_catalog_get_docset (catalog, i);
+                DhBook *book;
 
-        if (!g_str_equal(data, "")) {
-                node = new_lang_node (data, NULL, priv->langcount++);
-                priv->root_nodes = g_list_append (priv->root_nodes, node);
+                book = find_loaded_book (list_directory, object);
+                if (book != NULL)
+                        append_root_node (priv, new_node (object, book));
         }
 }
 
+/* The language nodes come first, sorted, then the books without a language.
+ * Within a language node the books are in the catalog order.
+ */
 static void
-add_docs_for_cur_lang (JsonArray *array,
-                       guint index_,
-                       JsonNode *element_node,
-                       gpointer user_data)
+add_books_by_language (DhBookTreeModel     *model,
+                       DhBookListDirectory *list_directory,
+                       DhCatalog           *catalog)
 {
-        JsonObject *object;
-        int idx;
-        DhBookTreeModelPrivate *priv;
+        DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (model);
+        GHashTable *lang_nodes;
+        GList *languages;
         GList *l;
-        GtkTreePath *path;
-        DhBookTreeModelNode *node, *newnode;
-        const gchar *title;
-        const gchar *language;
+        guint i;
 
-        priv = dh_book_tree_model_get_instance_private (DH_BOOK_TREE_MODEL (user_data));
+        /* Language -> DhBookTreeModelNode*, owned by the model. */
+        lang_nodes = g_hash_table_new (g_str_hash, g_str_equal);
 
-        object = json_node_get_object(element_node);
-        title = json_object_get_string_member(object, "Title");
-        language = json_object_get_string_member(object, "Language");
-        if (g_strcmp0(language, priv->currently_adding_language) != 0) {
-                return;
-        }
+        for (i = 0; i < _dh_catalog_get_n_docsets (catalog); i++) {
+                JsonObject *object = _dh_catalog_get_docset (catalog, i);
+                const gchar *language = json_object_get_string_member (object, "Language");
+                DhBook *book;
 
-        if (g_str_equal(language, "")) {
-                priv->root_nodes = g_list_append (priv->root_nodes,
-                                                  new_node (object,
-                                                            NULL,
-                                                            g_list_length(priv->root_nodes)));
-        } else {
-                l = priv->root_nodes;
-                idx = 0;
-                while (l) {
-                        node = l->data;
-                        if (node->link == NULL && g_strcmp0(language, node->title) == 0) {
-                                break;
-                        }
-                        if (node->link == NULL) {
-                                idx += 1;
-                        }
-                        l = l->next;
+                if (language == NULL || language[0] == '\0')
+                        continue;
+
+                book = find_loaded_book (list_directory, object);
+                if (book != NULL && !g_hash_table_contains (lang_nodes, language)) {
+                        DhBookTreeModelNode *lang_node = new_lang_node (language);
+
+                        lang_node->icon_book = book;
+                        g_hash_table_insert (lang_nodes, (gpointer) language, lang_node);
                 }
-                path = gtk_tree_path_new_from_indices(idx, -1),
-                newnode = new_node (object, path, priv->langcount++);
-                gtk_tree_path_free(path);
-                node->children = g_list_append (node->children, newnode);
         }
-}
 
-static void
-add_language_docs (gpointer data,
-                   gpointer user_data)
-{
-        DhBookTreeModelPrivate *priv;
+        languages = g_list_sort (g_hash_table_get_keys (lang_nodes), compare_strs);
+        for (l = languages; l != NULL; l = l->next)
+                append_root_node (priv, g_hash_table_lookup (lang_nodes, l->data));
+        g_list_free (languages);
+
+        for (i = 0; i < _dh_catalog_get_n_docsets (catalog); i++) {
+                JsonObject *object = _dh_catalog_get_docset (catalog, i);
+                const gchar *language = json_object_get_string_member (object, "Language");
+                DhBookTreeModelNode *lang_node = NULL;
+                DhBook *book;
+
+                book = find_loaded_book (list_directory, object);
+                if (book == NULL)
+                        continue;
 
-        priv = dh_book_tree_model_get_instance_private (DH_BOOK_TREE_MODEL (user_data));
+                if (language != NULL)
+                        lang_node = g_hash_table_lookup (lang_nodes, language);
 
-        priv->currently_adding_language = data;
-        priv->langcount = 0;
-        json_array_foreach_element(priv->array, add_docs_for_cur_lang, user_data);
+                if (lang_node != NULL)
+                        node_append_child (lang_node, new_node (object, book));
+                else
+                        append_root_node (priv, new_node (object, book));
+        }
+
+        g_hash_table_unref (lang_nodes);
 }
 
 static void
@@ -440,9 +479,11 @@ dh_book_tree_model_init (DhBookTreeModel *model)
 {
         DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (model);
 
-
-
+        priv->root_nodes = g_ptr_array_new_with_free_func ((GDestroyNotify) free_node);
+        priv->nodes_by_uri = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        priv->nodes_by_page = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
         priv->stamp = g_random_int_range (1, G_MAXINT32);
+        priv->cancellable = g_cancellable_new ();
 }
 
 /**
@@ -458,56 +499,25 @@ dh_book_tree_model_new (gboolean group_by_language, gint scale)
         g_assert(scale >= 0);
         priv->scale = scale;
 
-        SoupSession *session;
-        const char *uri;
-        GHashTable *hash;
-        GList *langlist;
-        SoupMessage *request;
-        SoupMessageBody *body;
-        SoupBuffer *buffer;
-        const gchar *data;
-        gsize length;
-        JsonParser *parser;
-        JsonNode *root;
-        JsonArray *array;
-
-        priv->root_nodes = NULL;
+        DhBookListDirectory *list_directory;
+        DhCatalog *catalog;
+
         priv->group_by_language = group_by_language;
 
-        parser = json_parser_new();
-        session = soup_session_new();
-        uri = "http://localhost:12340/item";
-        hash = g_hash_table_new(g_str_hash, g_str_equal);
-        request = soup_form_request_new_from_hash ("GET", uri, hash);
-
-        soup_session_send_message (session, request);
-        g_object_get(request, "response-body", &body, NULL);
-
-        buffer = soup_message_body_flatten(body);
-        soup_buffer_get_data(buffer, (const guint8**)&data, &length);
-        json_parser_load_from_data(parser, data, length, NULL);
-        root = json_parser_get_root(parser);
-        array = json_node_get_array(root);
-
-        if (priv->group_by_language) {
-                json_array_foreach_element(array, extract_language, hash);
-                priv->langcount = 0;
-                langlist = g_hash_table_get_keys(hash);
-                langlist = g_list_sort (langlist, compare_strs);
-                g_list_foreach(langlist, add_language, model);
-                priv->array = array;
-                g_list_foreach(langlist, add_language_docs, model);
-                g_list_free(langlist);
-        } else {
-                json_array_foreach_element(array, print_doc, model);
-        }
+        /* The books and the catalog they come from are those of the default
+         * DhBookList, which keeps the parsed catalog, so it is neither fetched
+         * nor parsed again here.
+         */
+        list_directory = DH_BOOK_LIST_DIRECTORY (dh_book_list_get_default (scale));
+        catalog = _dh_book_list_directory_get_catalog (list_directory);
+        if (catalog == NULL)
+                return model;
+
+        if (priv->group_by_language)
+                add_books_by_language (model, list_directory, catalog);
+        else
+                add_books (model, list_directory, catalog);
 
-        soup_buffer_free (buffer);
-        soup_message_body_free (body);
-        g_object_unref (parser);
-        g_hash_table_unref (hash);
-        g_object_unref (request);
-        g_object_unref (session);
         return model;
 }
 
@@ -518,9 +528,9 @@ dh_book_tree_model_get_iter (GtkTreeModel *tree_model,
 {
         DhBookTreeModelPrivate *priv;
         const gint *indices;
-        DhBookTreeModelNode *node;
+        DhBookTreeModelNode *node = NULL;
+        GPtrArray *children;
         int depth;
-        GList *nodes, *children;
 
         priv = dh_book_tree_model_get_instance_private (DH_BOOK_TREE_MODEL (tree_model));
 
@@ -531,24 +541,20 @@ dh_book_tree_model_get_iter (GtkTreeModel *tree_model,
                 return FALSE;
         }
 
-        nodes = priv->root_nodes;
         children = priv->root_nodes;
         for (int i = 0; i < depth; ++i)  {
-                nodes = g_list_nth (children, indices[i]);
-                if (nodes == NULL) {
-                        break;
+                if (children == NULL ||
+                    indices[i] < 0 ||
+                    (guint) indices[i] >= children->len) {
+                        return FALSE;
                 }
-                node = nodes->data;
+                node = g_ptr_array_index (children, indices[i]);
                 children = node->children;
         }
 
-        if (nodes != NULL) {
-                iter->stamp = priv->stamp;
-                iter->user_data = nodes;
-                return TRUE;
-        }
-
-        return FALSE;
+        iter->stamp = priv->stamp;
+        iter->user_data = node;
+        return TRUE;
 }
 
 static gint
@@ -586,105 +592,394 @@ dh_book_tree_model_get_column_type (GtkTreeModel *tree_model,
         }
 }
 
+typedef struct {
+        DhBookTreeModel *model; /* unowned, the requests are cancelled in dispose */
+        DhBookTreeModelNode *node;
+        SoupMessage *msg;
+        GCancellable *cancellable;
+        DhJsonArrayReader *reader;
+} LazyFetchData;
+
 static void
-lazy_fetch_children(DhBookTreeModelNode *node)
-{
-        SoupSession *session;
-        const char *uri;
-        GHashTable *hash;
-        GList *langlist;
-        SoupMessage *request;
-        SoupMessageBody *body;
-        SoupBuffer *buffer;
-        const gchar *data, *symbol;
-        gsize length;
-        JsonParser *parser;
-        JsonNode *root;
-        JsonArray *array, *subarray;
-
-        parser = json_parser_new();
-        session = soup_session_new();
-        hash = g_hash_table_new(g_str_hash, g_str_equal);
-        request = soup_form_request_new_from_hash ("GET", node->lazy_children_url, hash);
-
-        soup_session_send_message (session, request);
-        g_object_get(request, "response-body", &body, NULL);
-
-        buffer = soup_message_body_flatten(body);
-        soup_buffer_get_data(buffer, (const guint8**)&data, &length);
-        json_parser_load_from_data(parser, data, length, NULL);
-        root = json_parser_get_root(parser);
-        array = json_node_get_array(root);
-
-        for (guint i = 0; i < json_array_get_length(array); ++i) {
-                subarray = json_array_get_array_element(array, i);
-                symbol = json_array_get_string_element(subarray, 0);
-                gchar *path;
-                if (node->symbolchapterpath[0] != 0) {
-                        path = g_strjoin("", node->symbolchapterpath, "/",
-                                         g_uri_escape_string(g_uri_escape_string(symbol, "", FALSE), "", FALSE),
-                                         NULL);
-                } else {
-                        path = g_uri_escape_string(g_uri_escape_string(symbol, "", FALSE), "", FALSE);
-                }
-                node->children = g_list_append(node->children,
-                                               new_dynamic_symbols_node (node->object,
-                                                                         path,
-                                                                         0,
-                                                                         node->path,
-                                                                         i,
-                                                                         symbol, node->symbol_tp,
-                                                                         g_strjoin("/",
-                                                                                   "http://localhost:12340",
-                                                                                   json_array_get_string_element(subarray, 1),
-                                                                                   NULL),
-                                                                         dh_book_get_title(node->book)));
+lazy_fetch_data_free (LazyFetchData *data)
+{
+        g_object_unref (data->msg);
+        g_object_unref (data->cancellable);
+        _dh_json_array_reader_free (data->reader);
+        g_free (data);
+}
+
+static DhBookTreeModelNode *
+new_placeholder_node (DhBookTreeModelNode *parent)
+{
+        DhBookTreeModelNode *node = new_empty_node();
+
+        node->title = g_strdup (_("Loading…"));
+        node->book = parent->book;
+        node->is_placeholder = TRUE;
+
+        return node;
+}
+
+static DhBookTreeModelNode *
+new_lazy_child_node (DhBookTreeModelNode *parent,
+                     JsonNode            *element)
+{
+        JsonArray *subarray;
+        DhBookTreeModelNode *child;
+        const gchar *symbol;
+        gchar *escaped_once;
+        gchar *escaped;
+        gchar *path;
+        gchar *url;
+
+        if (!JSON_NODE_HOLDS_ARRAY (element))
+                return NULL;
+
+        subarray = json_node_get_array (element);
+        symbol = json_array_get_string_element (subarray, 0);
+
+        escaped_once = g_uri_escape_string (symbol, "", FALSE);
+        escaped = g_uri_escape_string (escaped_once, "", FALSE);
+
+        if (parent->symbolchapterpath[0] != 0) {
+                path = g_strjoin ("", parent->symbolchapterpath, "/", escaped, NULL);
+        } else {
+                path = g_strdup (escaped);
+        }
+
+        url = _dh_core_endpoint_get_uri (json_array_get_string_element (subarray, 1));
+
+        child = new_dynamic_symbols_node (parent->object,
+                                          path,
+                                          0,
+                                          symbol,
+                                          parent->symbol_tp,
+                                          url,
+                                          parent->book);
+
+        g_free (escaped_once);
+        g_free (escaped);
+        g_free (path);
+        g_free (url);
+
+        return child;
+}
+
+static DhBookTreeModelNode *
+get_placeholder (DhBookTreeModelNode *node)
+{
+        guint n_children = node_get_n_children (node);
+        DhBookTreeModelNode *last_child;
+
+        if (n_children == 0)
+                return NULL;
+
+        last_child = node_get_nth_child (node, n_children - 1);
+        return last_child->is_placeholder ? last_child : NULL;
+}
+
+/* Returns: (transfer full): @uri without its anchor, if any. */
+static gchar *
+get_page_uri (const gchar *uri)
+{
+        const gchar *anchor = strchr (uri, '#');
+
+        return anchor != NULL ? g_strndup (uri, anchor - uri) : g_strdup (uri);
+}
+
+static void
+index_node (DhBookTreeModel     *model,
+            DhBookTreeModelNode *node)
+{
+        DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (model);
+        gchar *uri;
+        gchar *page_uri;
+
+        if (node->link == NULL)
+                return;
+
+        uri = dh_link_get_uri (node->link);
+        if (uri == NULL)
+                return;
+
+        page_uri = get_page_uri (uri);
+
+        if (!g_hash_table_contains (priv->nodes_by_uri, uri))
+                g_hash_table_insert (priv->nodes_by_uri, uri, node);
+        else
+                g_free (uri);
+
+        if (!g_hash_table_contains (priv->nodes_by_page, page_uri))
+                g_hash_table_insert (priv->nodes_by_page, page_uri, node);
+        else
+                g_free (page_uri);
+}
+
+/* Inserts a batch of fetched children of @node (JsonNode*'s) before the
+ * placeholder, if any, so that an expanded row stays expanded. Called for each
+ * batch as the data arrives.
+ */
+static void
+insert_lazy_children (DhBookTreeModel     *model,
+                      DhBookTreeModelNode *node,
+                      GPtrArray           *elements)
+{
+        DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (model);
+        GtkTreeIter parent_iter;
+        GtkTreePath *parent_path;
+        gboolean had_children;
+        guint position;
+        guint i;
+
+        had_children = node_get_n_children (node) > 0;
+        position = node_get_n_children (node);
+        if (get_placeholder (node) != NULL)
+                position--;
+
+        parent_path = node_get_path (node);
+
+        for (i = 0; i < elements->len; i++) {
+                DhBookTreeModelNode *child;
+                GtkTreeIter iter;
+                GtkTreePath *path;
+
+                child = new_lazy_child_node (node, g_ptr_array_index (elements, i));
+                if (child == NULL)
+                        continue;
+
+                /* Before the placeholder, which stays the last child. */
+                node_insert_child (node, position, child);
+                index_node (model, child);
+
+                iter.stamp = priv->stamp;
+                iter.user_data = child;
+                path = gtk_tree_path_copy (parent_path);
+                gtk_tree_path_append_index (path, position);
+                gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+                gtk_tree_path_free (path);
+
+                position++;
+        }
+
+        if (!had_children && node_get_n_children (node) > 0) {
+                parent_iter.stamp = priv->stamp;
+                parent_iter.user_data = node;
+                gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model),
+                                                      parent_path,
+                                                      &parent_iter);
+        }
+
+        gtk_tree_path_free (parent_path);
+}
+
+/* Removes the placeholder, once all the children have been inserted or the
+ * fetch has failed.
+ */
+static void
+finish_lazy_children (DhBookTreeModel     *model,
+                      DhBookTreeModelNode *node)
+{
+        DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (model);
+        DhBookTreeModelNode *placeholder;
+        GtkTreeIter parent_iter;
+        GtkTreePath *parent_path;
+        GtkTreePath *path;
+        guint position;
+
+        node->lazy_state = LAZY_CHILDREN_FETCHED;
+
+        placeholder = get_placeholder (node);
+        if (placeholder == NULL)
+                return;
+
+        position = placeholder->index;
+        g_ptr_array_remove_index (node->children, position);
+
+        parent_path = node_get_path (node);
+        path = gtk_tree_path_copy (parent_path);
+        gtk_tree_path_append_index (path, position);
+        gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+        gtk_tree_path_free (path);
+
+        if (node->children->len == 0) {
+                g_clear_pointer (&node->children, g_ptr_array_unref);
+
+                parent_iter.stamp = priv->stamp;
+                parent_iter.user_data = node;
+                gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model),
+                                                      parent_path,
+                                                      &parent_iter);
+        }
+
+        gtk_tree_path_free (parent_path);
+}
+
+static void
+lazy_fetch_batch_cb (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+        LazyFetchData *data = user_data;
+        GPtrArray *batch;
+        GError *error = NULL;
+
+        batch = _dh_json_array_reader_next_batch_finish (data->reader, result, &error);
+
+        /* The model is being disposed. */
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+                g_error_free (error);
+                lazy_fetch_data_free (data);
+                return;
+        }
+
+        if (batch == NULL) {
+                g_warning ("Failed to parse the children of “%s”: %s",
+                           data->node->title,
+                           error->message);
+                g_clear_error (&error);
+                finish_lazy_children (data->model, data->node);
+                lazy_fetch_data_free (data);
+                return;
+        }
+
+        if (batch->len == 0) {
+                finish_lazy_children (data->model, data->node);
+                lazy_fetch_data_free (data);
+                g_ptr_array_unref (batch);
+                return;
+        }
+
+        insert_lazy_children (data->model, data->node, batch);
+        g_ptr_array_unref (batch);
+
+        _dh_json_array_reader_next_batch_async (data->reader,
+                                                data->cancellable,
+                                                lazy_fetch_batch_cb,
+                                                data);
+}
+
+static void
+lazy_fetch_send_cb (GObject      *source_object,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+        LazyFetchData *data = user_data;
+        GInputStream *stream;
+        GError *error = NULL;
+
+        stream = _dh_core_client_send_finish (result, &error);
+
+        /* The model is being disposed. */
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+                g_error_free (error);
+                lazy_fetch_data_free (data);
+                return;
+        }
+
+        if (stream == NULL || !SOUP_STATUS_IS_SUCCESSFUL (data->msg->status_code)) {
+                g_warning ("Failed to get the children of “%s”: %s",
+                           data->node->title,
+                           error != NULL ? error->message : data->msg->reason_phrase);
+                g_clear_error (&error);
+                g_clear_object (&stream);
+                finish_lazy_children (data->model, data->node);
+                lazy_fetch_data_free (data);
+                return;
+        }
+
+        data->reader = _dh_json_array_reader_new (stream);
+        g_object_unref (stream);
+
+        _dh_json_array_reader_next_batch_async (data->reader,
+                                                data->cancellable,
+                                                lazy_fetch_batch_cb,
+                                                data);
+}
+
+/* Starts fetching the children of @node, if not already done or in progress.
+ * The response is read as a stream: the rows are inserted batch by batch as
+ * the data arrives.
+ */
+static void
+lazy_fetch_children (DhBookTreeModel     *model,
+                     DhBookTreeModelNode *node)
+{
+        DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (model);
+        LazyFetchData *data;
+
+        if (node->lazy_children_url == NULL ||
+            node->lazy_state != LAZY_CHILDREN_NOT_FETCHED) {
+                return;
         }
 
+        node->lazy_state = LAZY_CHILDREN_FETCHING;
 
-        soup_buffer_free (buffer);
-        soup_message_body_free (body);
-        g_object_unref (parser);
-        g_hash_table_unref (hash);
-        g_object_unref (request);
-        g_object_unref (session);
+        /* When the node is known to have children, show a placeholder in the
+         * meantime. It is inserted silently: the view has not seen any child
+         * of @node yet.
+         */
+        if (node->lazy_has_children && node->children == NULL) {
+                node_append_child (node, new_placeholder_node (node));
+        }
+
+        data = g_new0 (LazyFetchData, 1);
+        data->model = model;
+        data->node = node;
+        data->msg = soup_message_new ("GET", node->lazy_children_url);
+        data->cancellable = g_object_ref (priv->cancellable);
+
+        _dh_core_client_send_async (data->msg,
+                                    priv->cancellable,
+                                    lazy_fetch_send_cb,
+                                    data);
 }
 
 static gboolean
 dh_book_tree_model_iter_has_child (GtkTreeModel *tree_model,
                                    GtkTreeIter *iter)
 {
-        GList *list;
         DhBookTreeModelNode *node;
-        list = iter->user_data;
-        if (list == NULL) {
+        node = iter->user_data;
+        if (node == NULL) {
                 return FALSE;
         }
-        node = list->data;
-        if (node->lazy_children_url && !node->lazy_has_children && !node->children) {
-                lazy_fetch_children(node);
+        if (node->lazy_children_url && node->lazy_state == LAZY_CHILDREN_NOT_FETCHED) {
+                if (node->lazy_has_children) {
+                        return TRUE;
+                }
+
+                /* Unknown, e.g. for chapters: don't show an expander until the
+                 * children have been fetched in the background.
+                 */
+                lazy_fetch_children (DH_BOOK_TREE_MODEL (tree_model), node);
         }
-        return g_list_length (node->children) > 0 || (node->lazy_children_url && node->lazy_has_children);
+        return node->children != NULL;
 }
 
 static gboolean
 dh_book_tree_model_iter_next (GtkTreeModel *tree_model,
                               GtkTreeIter *iter)
 {
-        GList *node;
+        DhBookTreeModelNode *node;
         DhBookTreeModelPrivate *priv;
+        GPtrArray *siblings;
         priv = dh_book_tree_model_get_instance_private (DH_BOOK_TREE_MODEL (tree_model));
         node = iter->user_data;
-        if (node == NULL && g_list_length(priv->root_nodes) > 0) {
+        if (node == NULL && priv->root_nodes->len > 0) {
                 iter->stamp = priv->stamp;
-                iter->user_data = priv->root_nodes;
+                iter->user_data = g_ptr_array_index (priv->root_nodes, 0);
                 return TRUE;
         }
-        if (node == NULL || node->next == NULL) {
+        if (node == NULL) {
+                return FALSE;
+        }
+        siblings = get_siblings (priv, node);
+        if (node->index + 1 >= siblings->len) {
                 return FALSE;
         }
         iter->stamp = priv->stamp;
-        iter->user_data = node->next;
+        iter->user_data = g_ptr_array_index (siblings, node->index + 1);
         return TRUE;
 }
 
@@ -692,13 +987,11 @@ static GtkTreePath *
 dh_book_tree_model_get_path (GtkTreeModel *tree_model,
                              GtkTreeIter *iter)
 {
-        GList *list;
         DhBookTreeModelNode *node;
 
-        list = iter->user_data;
-        if (list != NULL) {
-                node = list->data;
-                return gtk_tree_path_copy (node->path);
+        node = iter->user_data;
+        if (node != NULL) {
+                return node_get_path (node);
         }
         return NULL;
 
@@ -710,14 +1003,9 @@ dh_book_tree_model_get_value (GtkTreeModel *tree_model,
                               gint column,
                               GValue *value)
 {
-        DhBookTreeModelPrivate* priv = dh_book_tree_model_get_instance_private(tree_model);
-
-        GList *list;
-        GList *books = dh_book_list_get_books (dh_book_list_get_default (priv->scale));
         DhBook *book;
         DhBookTreeModelNode *node;
-        list = iter->user_data;
-        node = list->data;
+        node = iter->user_data;
 
         switch (column) {
         case DH_BOOK_TREE_MODEL_COL_TITLE:
@@ -751,32 +1039,17 @@ dh_book_tree_model_get_value (GtkTreeModel *tree_model,
                 return;
 
         case DH_BOOK_TREE_MODEL_COL_ICON:
-                while (books) {
-                        book = books->data;
-                        if (node->book == NULL) {
-                                if (!g_str_equal(dh_book_get_language(book), "")) {
-                                        g_value_init(value, CAIRO_GOBJECT_TYPE_SURFACE);
-                                        g_value_set_boxed(value, dh_book_get_icon_surface(book));
-                                        return;
-                                }
-                        } else if (g_str_equal(dh_book_get_title(node->book), dh_book_get_title(book))) {
-                                g_value_init(value, CAIRO_GOBJECT_TYPE_SURFACE);
-                                g_value_set_boxed(value, dh_book_get_icon_surface(book));
-                                return;
-                        }
-                        books = books->next;
+                book = node->book != NULL ? node->book : node->icon_book;
+                if (book != NULL) {
+                        g_value_init(value, CAIRO_GOBJECT_TYPE_SURFACE);
+                        g_value_set_boxed(value, dh_book_get_icon_surface(book));
                 }
                 return;
 
         case DH_BOOK_TREE_MODEL_COL_ICON_B64:
-                while (books) {
-                        book = books->data;
-                        if (g_str_equal(dh_book_get_title(node->book), dh_book_get_title(book))) {
-                                g_value_init(value, G_TYPE_STRING);
-                                g_value_set_string(value, dh_book_get_icon_b64(book));
-                                return;
-                        }
-                        books = books->next;
+                if (node->book != NULL) {
+                        g_value_init(value, G_TYPE_STRING);
+                        g_value_set_string(value, dh_book_get_icon_b64(node->book));
                 }
                 return;
 
@@ -791,30 +1064,32 @@ dh_book_tree_model_iter_nth_child (GtkTreeModel *tree_model,
                                    GtkTreeIter *parent,
                                    gint n)
 {
-        GList *list;
         DhBookTreeModelNode *node;
         DhBookTreeModelPrivate *priv;
 
         priv = dh_book_tree_model_get_instance_private (DH_BOOK_TREE_MODEL (tree_model));
-        if (parent == NULL) {
-                return dh_book_tree_model_get_iter (tree_model,
-                                                    iter,
-                                                    gtk_tree_path_new_from_indices(n, -1));
-        }
-        list = parent->user_data;
 
-        node = list->data;
-        if (node->lazy_children_url && !node->children) {
-                lazy_fetch_children(node);
-        }
-        list = g_list_nth (node->children, n);
-        if (list == NULL) {
+        if (n < 0) {
                 return FALSE;
         }
-        iter->user_data = list;
+
+        if (parent == NULL) {
+                if ((guint) n >= priv->root_nodes->len) {
+                        return FALSE;
+                }
+                node = g_ptr_array_index (priv->root_nodes, n);
+        } else {
+                node = parent->user_data;
+                lazy_fetch_children (DH_BOOK_TREE_MODEL (tree_model), node);
+                node = node_get_nth_child (node, n);
+                if (node == NULL) {
+                        return FALSE;
+                }
+        }
+
+        iter->user_data = node;
         iter->stamp = priv->stamp;
         return TRUE;
-
 }
 
 static gboolean
@@ -825,24 +1100,18 @@ dh_book_tree_model_iter_children (GtkTreeModel *tree_model,
         return dh_book_tree_model_iter_nth_child (tree_model, iter, parent, 0);
 }
 
-static gboolean
+static gint
 dh_book_tree_model_iter_n_children (GtkTreeModel *tree_model,
                                     GtkTreeIter *iter)
 {
-        GList *list;
         DhBookTreeModelNode *node;
         DhBookTreeModelPrivate *priv = dh_book_tree_model_get_instance_private (DH_BOOK_TREE_MODEL (tree_model));
         if (iter == NULL) {
-                list = priv->root_nodes;
-        } else {
-                list = iter->user_data;
-                node = list->data;
-                if (node->lazy_children_url && !node->children) {
-                        lazy_fetch_children(node);
-                }
-                list = node->children;
+                return priv->root_nodes->len;
         }
-        return g_list_length(list);
+        node = iter->user_data;
+        lazy_fetch_children (DH_BOOK_TREE_MODEL (tree_model), node);
+        return node_get_n_children (node);
 }
 
 static gboolean
@@ -851,30 +1120,18 @@ dh_book_tree_model_iter_parent (GtkTreeModel *tree_model,
                                 GtkTreeIter *child)
 {
         DhBookTreeModelPrivate *priv;
-        GList *list;
         DhBookTreeModelNode *node;
-        gint *indices, depth;
 
         priv = dh_book_tree_model_get_instance_private (DH_BOOK_TREE_MODEL (tree_model));
-        list = child->user_data;
+        node = child->user_data;
 
-        if (list != NULL) {
-                node = list->data;
-                indices = gtk_tree_path_get_indices_with_depth (node->path, &depth);
-                if (depth < 2) {
-                        return FALSE;
-                }
-                list = priv->root_nodes;
-                for (int i = 0; i < depth - 1; ++i) {
-                        list = iter->user_data = g_list_nth(list, indices[i]);
-                        node = list->data;
-                        list = node->children;
-                }
-                iter->stamp = priv->stamp;
-                return TRUE;
-        } else {
+        if (node == NULL || node->parent == NULL) {
                 return FALSE;
         }
+
+        iter->user_data = node->parent;
+        iter->stamp = priv->stamp;
+        return TRUE;
 }
 
 static void
@@ -892,3 +1149,78 @@ dh_book_tree_model_tree_model_init (GtkTreeModelIface *iface)
         iface->get_path = dh_book_tree_model_get_path;
         iface->get_value = dh_book_tree_model_get_value;
 }
+
+/* For the unit tests: a model with a single root node titled @title, whose
+ * children are built from @symbols, an array of [name, url] pairs like the
+ * lazy children answered by zealcore. No book is associated with the nodes.
+ */
+DhBookTreeModel *
+_dh_book_tree_model_new_from_symbols (const gchar *title,
+                                      JsonArray   *symbols)
+{
+        DhBookTreeModel *model;
+        DhBookTreeModelPrivate *priv;
+        DhBookTreeModelNode *node;
+        GPtrArray *elements;
+        guint i;
+
+        g_return_val_if_fail (title != NULL, NULL);
+        g_return_val_if_fail (symbols != NULL, NULL);
+
+        model = DH_BOOK_TREE_MODEL (g_object_new (DH_TYPE_BOOK_TREE_MODEL, NULL));
+        priv = dh_book_tree_model_get_instance_private (model);
+
+        node = new_empty_node ();
+        node->title = g_strdup (title);
+        node->symbolchapterpath = g_strdup ("");
+        node->symbol_tp = g_strdup ("symbols");
+        node->object = json_object_new ();
+        node->lazy_state = LAZY_CHILDREN_FETCHED;
+        append_root_node (priv, node);
+
+        elements = g_ptr_array_sized_new (json_array_get_length (symbols));
+        for (i = 0; i < json_array_get_length (symbols); i++)
+                g_ptr_array_add (elements, json_array_get_element (symbols, i));
+
+        insert_lazy_children (model, node, elements);
+        g_ptr_array_unref (elements);
+
+        return model;
+}
+
+/* Finds the row whose link is at @uri, or else the first row on the same page
+ * as @uri. Only the rows already loaded are considered, no lazy children are
+ * fetched.
+ *
+ * Returns: whether a row has been found. @iter is then set to it.
+ */
+gboolean
+_dh_book_tree_model_find_uri (DhBookTreeModel *model,
+                              const gchar     *uri,
+                              GtkTreeIter     *iter)
+{
+        DhBookTreeModelPrivate *priv;
+        DhBookTreeModelNode *node;
+
+        g_return_val_if_fail (DH_IS_BOOK_TREE_MODEL (model), FALSE);
+        g_return_val_if_fail (uri != NULL, FALSE);
+        g_return_val_if_fail (iter != NULL, FALSE);
+
+        priv = dh_book_tree_model_get_instance_private (model);
+
+        node = g_hash_table_lookup (priv->nodes_by_uri, uri);
+
+        if (node == NULL) {
+                gchar *page_uri = get_page_uri (uri);
+
+                node = g_hash_table_lookup (priv->nodes_by_page, page_uri);
+                g_free (page_uri);
+        }
+
+        if (node == NULL)
+                return FALSE;
+
+        iter->stamp = priv->stamp;
+        iter->user_data = node;
+        return TRUE;
+}
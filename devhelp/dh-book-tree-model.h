@@ -20,6 +20,8 @@
 #define DH_BOOK_TREE_MODEL_H
 
 #include <glib-object.h>
+#include <gtk/gtk.h>
+#include <json-glib/json-glib.h>
 #include <devhelp/dh-link.h>
 
 G_BEGIN_DECLS
@@ -61,6 +63,15 @@ GType           dh_book_tree_model_get_type  (void);
 
 DhBookTreeModel *dh_book_tree_model_new       (gboolean group_by_language, gint scale);
 
+G_GNUC_INTERNAL
+DhBookTreeModel *_dh_book_tree_model_new_from_symbols (const gchar *title,
+                                                       JsonArray   *symbols);
+
+G_GNUC_INTERNAL
+gboolean         _dh_book_tree_model_find_uri         (DhBookTreeModel *model,
+                                                       const gchar     *uri,
+                                                       GtkTreeIter     *iter);
+
 G_END_DECLS
 
 #endif /* DH_BOOK_TREE_MODEL_H */
@@ -56,13 +56,6 @@ typedef struct {
         GtkMenu *context_menu;
 } DhBookTreePrivate;
 
-typedef struct {
-        const gchar *uri;
-        GtkTreeIter iter;
-        GtkTreePath *path;
-        guint found : 1;
-} FindURIData;
-
 enum {
         LINK_SELECTED,
         N_SIGNALS
@@ -819,8 +812,8 @@ dh_book_tree_set_property (GObject      *object,
 }
 
 static void
-refresh_tree (GObject    *object,
-              DhBookTree *tree)
+books_changed_cb (DhBookList *book_list,
+                  DhBookTree *tree)
 {
     book_tree_populate_tree (tree);
 }
@@ -865,8 +858,8 @@ dh_book_tree_constructed (GObject *object)
                                  0);
 
         g_signal_connect_object (dh_book_list_get_default(gtk_widget_get_scale_factor(GTK_WIDGET (tree))),
-                                 "refresh",
-                                 G_CALLBACK (refresh_tree),
+                                 "books-changed",
+                                 G_CALLBACK (books_changed_cb),
                                  tree,
                                  0);
 
@@ -1117,15 +1110,6 @@ dh_book_tree_get_selected_link (DhBookTree *tree)
         return link;
 }
 
-static gboolean
-book_tree_find_uri_foreach_func (GtkTreeModel *model,
-                                 GtkTreePath  *path,
-                                 GtkTreeIter  *iter,
-                                 gpointer      _data)
-{
-        return FALSE;
-}
-
 /**
  * dh_book_tree_select_uri:
  * @tree: a #DhBookTree.
@@ -1134,11 +1118,63 @@ book_tree_find_uri_foreach_func (GtkTreeModel *model,
  * Selects the row corresponding to @uri. It searches in the tree a #DhLink
  * being at @uri (if it's an exact match), or containing @uri (if @uri contains
  * an anchor).
+ *
+ * Only the rows already loaded are searched, the lazily loaded symbols of a
+ * book are not fetched for it.
  */
 void
 dh_book_tree_select_uri (DhBookTree  *tree,
                          const gchar *uri)
 {
+        DhBookTreePrivate *priv;
+        GtkTreeModel *view_model;
+        GtkTreeSelection *selection;
+        GtkTreeIter store_iter;
+        GtkTreeIter iter;
+        GtkTreePath *path;
+
+        g_return_if_fail (DH_IS_BOOK_TREE (tree));
+        g_return_if_fail (uri != NULL);
+
+        priv = dh_book_tree_get_instance_private (tree);
+
+        if (!_dh_book_tree_model_find_uri (DH_BOOK_TREE_MODEL (priv->store), uri, &store_iter))
+                return;
+
+        view_model = gtk_tree_view_get_model (GTK_TREE_VIEW (tree));
+
+        if (view_model == priv->filter_store) {
+                /* The row may be filtered out. */
+                if (!gtk_tree_model_filter_convert_child_iter_to_iter (GTK_TREE_MODEL_FILTER (priv->filter_store),
+                                                                       &iter,
+                                                                       &store_iter))
+                        return;
+        } else {
+                iter = store_iter;
+        }
+
+        /* Same as in book_tree_init_selection(), don't emit ::link-selected
+         * for a URI that is already displayed.
+         */
+        selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (tree));
+        g_signal_handlers_block_by_func (selection,
+                                         book_tree_selection_changed_cb,
+                                         tree);
+
+        path = gtk_tree_model_get_path (view_model, &iter);
+        gtk_tree_view_expand_to_path (GTK_TREE_VIEW (tree), path);
+        gtk_tree_selection_select_iter (selection, &iter);
+        gtk_tree_view_set_cursor (GTK_TREE_VIEW (tree), path, NULL, FALSE);
+        gtk_tree_path_free (path);
+
+        g_clear_pointer (&priv->selected_link, dh_link_unref);
+        gtk_tree_model_get (view_model, &iter,
+                            COL_LINK, &priv->selected_link,
+                            -1);
+
+        g_signal_handlers_unblock_by_func (selection,
+                                           book_tree_selection_changed_cb,
+                                           tree);
 }
 
 static gboolean
@@ -24,8 +24,8 @@
 
 #include "config.h"
 #include "dh-book.h"
-#include <gdk/gdk.h>
 #include <glib/gi18n-lib.h>
+#include "dh-icon-cache.h"
 #include "dh-link.h"
 #include "dh-parser.h"
 #include "dh-util-lib.h"
@@ -71,8 +71,15 @@ typedef struct {
         gchar *id_for_removing;
         gchar *title;
         gchar *language;
+        gchar *icon_b64;
+        gint scale;
+
+        /* Rasterized on the first dh_book_get_icon_surface() call. Stays
+         * %NULL if the icon couldn't be decoded, @icon_surface_loaded avoids
+         * trying again on each call.
+         */
         cairo_surface_t* icon_surface;
-        const gchar* icon_b64;
+        guint icon_surface_loaded : 1;
 
         /* The book tree of DhLink*. */
         GNode *tree;
@@ -101,7 +108,8 @@ dh_book_dispose (GObject *object)
         g_clear_object (&priv->completion);
         g_clear_object (&priv->index_file_monitor);
 
-        cairo_surface_destroy(priv->icon_surface);
+        g_clear_pointer (&priv->icon_surface, cairo_surface_destroy);
+        priv->icon_surface_loaded = FALSE;
 
         if (priv->monitor_event_timeout_id != 0) {
                 g_source_remove (priv->monitor_event_timeout_id);
@@ -122,6 +130,7 @@ dh_book_finalize (GObject *object)
         g_free (priv->id);
         g_free (priv->title);
         g_free (priv->language);
+        g_free (priv->icon_b64);
         _dh_util_free_book_tree (priv->tree);
         g_list_free_full (priv->links, (GDestroyNotify)dh_link_unref);
 
@@ -363,10 +372,7 @@ dh_book_new_from_json (JsonObject *object, gint scale)
 {
         DhBookPrivate *priv;
         DhBook *book;
-        GInputStream *istream;
-        GdkPixbuf *pixbuf;
         gchar *language;
-        size_t len;
 
         book = g_object_new (DH_TYPE_BOOK, NULL);
         priv = dh_book_get_instance_private (book);
@@ -388,23 +394,15 @@ dh_book_new_from_json (JsonObject *object, gint scale)
                           g_strdup_printf (_("Language: %s"), language) :
                           g_strdup (""));
 
-        guchar* data;
-        GError* err;
+        /* The icon is only decoded when it is needed, see
+         * dh_book_get_icon_surface().
+         */
+        priv->scale = scale;
         if (scale == 1) {
                 priv->icon_b64 = g_strdup(json_object_get_string_member(object, "Icon"));
         } else {
                 priv->icon_b64 = g_strdup(json_object_get_string_member(object, "Icon2x"));
         }
-        data = g_base64_decode(priv->icon_b64, &len);
-        err = NULL;
-        istream = g_memory_input_stream_new_from_data(data, len, NULL);
-        pixbuf = gdk_pixbuf_new_from_stream_at_scale(istream, 16*scale, 16*scale, TRUE, NULL, &err);
-        priv->icon_surface = gdk_cairo_surface_create_from_pixbuf(
-                pixbuf, _dh_util_surface_scale(scale), NULL
-        );
-        g_object_unref(pixbuf);
-        g_object_unref(istream);
-        g_free(data);
         g_free(language);
 
         return book;
@@ -485,6 +483,16 @@ dh_book_get_title (DhBook *book)
         return priv->title;
 }
 
+/**
+ * dh_book_get_icon_surface:
+ * @book: a #DhBook.
+ *
+ * The icon is rasterized on the first call, or taken from a process-wide
+ * cache if a #DhBook with the same ID and icon data already did it. If the
+ * icon can't be decoded, later calls return %NULL without trying again.
+ *
+ * Returns: (transfer none) (nullable): the icon of @book.
+ */
 cairo_surface_t*
 dh_book_get_icon_surface (DhBook *book)
 {
@@ -494,6 +502,18 @@ dh_book_get_icon_surface (DhBook *book)
 
         priv = dh_book_get_instance_private (book);
 
+        if (!priv->icon_surface_loaded && priv->id != NULL) {
+                cairo_surface_t *surface;
+
+                priv->icon_surface_loaded = TRUE;
+
+                surface = _dh_icon_cache_get_surface (priv->id,
+                                                      priv->icon_b64,
+                                                      priv->scale);
+                if (surface != NULL)
+                        priv->icon_surface = cairo_surface_reference (surface);
+        }
+
         return priv->icon_surface;
 }
 
@@ -0,0 +1,330 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-catalog-cache.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+/* On-disk cache of the zealcore responses needed to show the UI: the docsets
+ * catalog ("item", which includes the base64 icons) and the groups ("group").
+ * They are shown right away at startup, and then reconciled with zealcore in
+ * the background.
+ *
+ * Each response is stored in its own file, in the user cache directory:
+ *
+ *   zevdocs-catalog-cache <version>\n
+ *   <ETag, or empty line>\n
+ *   <the response body, as received>
+ *
+ * The file is memory-mapped when read, the returned #GBytes points directly to
+ * the body. A file with another version is ignored.
+ *
+ * A response can also be written as it is received, with a
+ * #DhCatalogCacheWriter: it goes to a temporary file, which replaces the
+ * cache file only once the whole response has been written.
+ */
+
+#define CACHE_MAGIC "zevdocs-catalog-cache"
+#define CACHE_VERSION 1
+
+static gchar *
+get_cache_filename (const gchar *name)
+{
+        gchar *basename;
+        gchar *filename;
+
+        basename = g_strdup_printf ("%s.cache", name);
+        filename = g_build_filename (g_get_user_cache_dir (),
+                                     "zevdocs",
+                                     "catalog",
+                                     basename,
+                                     NULL);
+        g_free (basename);
+
+        return filename;
+}
+
+static gboolean
+create_cache_directory (const gchar *filename)
+{
+        gchar *dirname;
+        gboolean ok = TRUE;
+
+        dirname = g_path_get_dirname (filename);
+
+        if (g_mkdir_with_parents (dirname, 0755) != 0) {
+                g_warning ("Failed to create the directory “%s”: %s",
+                           dirname,
+                           g_strerror (errno));
+                ok = FALSE;
+        }
+
+        g_free (dirname);
+        return ok;
+}
+
+static gchar *
+get_header (const gchar *etag)
+{
+        return g_strdup_printf ("%s %d\n%s\n",
+                                CACHE_MAGIC,
+                                CACHE_VERSION,
+                                etag != NULL ? etag : "");
+}
+
+/*
+ * _dh_catalog_cache_load:
+ * @name: the cached response, e.g. "item".
+ * @etag: (out) (optional) (nullable): location for the ETag of the response,
+ *   or %NULL if there was none. Free with g_free().
+ *
+ * Can be called from any thread.
+ *
+ * Returns: (transfer full) (nullable): the cached response body, or %NULL if
+ * there is none.
+ */
+GBytes *
+_dh_catalog_cache_load (const gchar  *name,
+                        gchar       **etag)
+{
+        gchar *filename;
+        GMappedFile *mapped_file;
+        GBytes *file_bytes;
+        GBytes *body = NULL;
+        const gchar *contents;
+        gsize length;
+        gchar *magic;
+        const gchar *etag_start;
+        const gchar *etag_end;
+
+        g_return_val_if_fail (name != NULL, NULL);
+
+        if (etag != NULL)
+                *etag = NULL;
+
+        filename = get_cache_filename (name);
+        mapped_file = g_mapped_file_new (filename, FALSE, NULL);
+        g_free (filename);
+
+        if (mapped_file == NULL)
+                return NULL;
+
+        file_bytes = g_mapped_file_get_bytes (mapped_file);
+        g_mapped_file_unref (mapped_file);
+
+        contents = g_bytes_get_data (file_bytes, &length);
+        magic = g_strdup_printf ("%s %d\n", CACHE_MAGIC, CACHE_VERSION);
+
+        if (contents == NULL ||
+            length < strlen (magic) ||
+            strncmp (contents, magic, strlen (magic)) != 0) {
+                goto out;
+        }
+
+        etag_start = contents + strlen (magic);
+        etag_end = memchr (etag_start, '\n', length - (etag_start - contents));
+        if (etag_end == NULL)
+                goto out;
+
+        if (etag != NULL && etag_end > etag_start)
+                *etag = g_strndup (etag_start, etag_end - etag_start);
+
+        body = g_bytes_new_from_bytes (file_bytes,
+                                       etag_end + 1 - contents,
+                                       length - (etag_end + 1 - contents));
+
+out:
+        g_free (magic);
+        g_bytes_unref (file_bytes);
+        return body;
+}
+
+/*
+ * _dh_catalog_cache_save:
+ * @name: the cached response, e.g. "item".
+ * @etag: (nullable): the ETag of the response.
+ * @data: the response body.
+ *
+ * Replaces the cached response atomically. Errors are only logged, the cache
+ * is not essential. Can be called from any thread.
+ */
+void
+_dh_catalog_cache_save (const gchar *name,
+                        const gchar *etag,
+                        GBytes      *data)
+{
+        gchar *filename;
+        gchar *header;
+        gconstpointer body;
+        gsize header_length;
+        gsize body_length;
+        gchar *contents;
+        GError *error = NULL;
+
+        g_return_if_fail (name != NULL);
+        g_return_if_fail (data != NULL);
+
+        filename = get_cache_filename (name);
+
+        if (!create_cache_directory (filename))
+                goto out;
+
+        header = get_header (etag);
+        header_length = strlen (header);
+        body = g_bytes_get_data (data, &body_length);
+
+        contents = g_malloc (header_length + body_length);
+        memcpy (contents, header, header_length);
+        if (body_length > 0)
+                memcpy (contents + header_length, body, body_length);
+
+        if (!g_file_set_contents (filename, contents, header_length + body_length, &error)) {
+                g_warning ("Failed to write the cache file “%s”: %s",
+                           filename,
+                           error->message);
+                g_clear_error (&error);
+        }
+
+        g_free (contents);
+        g_free (header);
+
+out:
+        g_free (filename);
+}
+
+struct _DhCatalogCacheWriter {
+        gchar *filename;
+        gchar *tmp_filename;
+        FILE *file;
+        guint failed : 1;
+};
+
+/*
+ * _dh_catalog_cache_writer_new:
+ * @name: the cached response, e.g. "item".
+ * @etag: (nullable): the ETag of the response.
+ *
+ * Starts writing a response. The cache file is only replaced by
+ * _dh_catalog_cache_writer_commit(), if all the writes have succeeded. Can be
+ * used from any thread, by one thread at a time.
+ *
+ * Returns: (transfer full): a new #DhCatalogCacheWriter, free it with
+ * _dh_catalog_cache_writer_free().
+ */
+DhCatalogCacheWriter *
+_dh_catalog_cache_writer_new (const gchar *name,
+                              const gchar *etag)
+{
+        DhCatalogCacheWriter *writer;
+        gchar *header;
+        gint fd;
+
+        g_return_val_if_fail (name != NULL, NULL);
+
+        writer = g_new0 (DhCatalogCacheWriter, 1);
+        writer->filename = get_cache_filename (name);
+
+        if (!create_cache_directory (writer->filename)) {
+                writer->failed = TRUE;
+                return writer;
+        }
+
+        writer->tmp_filename = g_strdup_printf ("%s.XXXXXX", writer->filename);
+        fd = g_mkstemp (writer->tmp_filename);
+        if (fd == -1 || (writer->file = fdopen (fd, "wb")) == NULL) {
+                g_warning ("Failed to create the cache file “%s”: %s",
+                           writer->tmp_filename,
+                           g_strerror (errno));
+                if (fd != -1)
+                        g_close (fd, NULL);
+                g_clear_pointer (&writer->tmp_filename, g_free);
+                writer->failed = TRUE;
+                return writer;
+        }
+
+        header = get_header (etag);
+        _dh_catalog_cache_writer_write (header, strlen (header), writer);
+        g_free (header);
+
+        return writer;
+}
+
+/* The signature is compatible with DhJsonArrayReaderDataFunc. */
+void
+_dh_catalog_cache_writer_write (const gchar *data,
+                                gsize        length,
+                                gpointer     _writer)
+{
+        DhCatalogCacheWriter *writer = _writer;
+
+        g_return_if_fail (writer != NULL);
+
+        if (writer->failed || length == 0)
+                return;
+
+        if (fwrite (data, 1, length, writer->file) != length)
+                writer->failed = TRUE;
+}
+
+/* Replaces the cache file with what has been written. */
+void
+_dh_catalog_cache_writer_commit (DhCatalogCacheWriter *writer)
+{
+        g_return_if_fail (writer != NULL);
+
+        if (writer->file == NULL)
+                return;
+
+        if (fclose (writer->file) != 0)
+                writer->failed = TRUE;
+        writer->file = NULL;
+
+        if (writer->failed) {
+                g_warning ("Failed to write the cache file “%s”", writer->tmp_filename);
+                return;
+        }
+
+        if (g_rename (writer->tmp_filename, writer->filename) != 0) {
+                g_warning ("Failed to write the cache file “%s”: %s",
+                           writer->filename,
+                           g_strerror (errno));
+                return;
+        }
+
+        g_clear_pointer (&writer->tmp_filename, g_free);
+}
+
+/* Discards what has been written, if not committed. */
+void
+_dh_catalog_cache_writer_free (DhCatalogCacheWriter *writer)
+{
+        if (writer == NULL)
+                return;
+
+        if (writer->file != NULL)
+                fclose (writer->file);
+
+        if (writer->tmp_filename != NULL)
+                g_unlink (writer->tmp_filename);
+
+        g_free (writer->tmp_filename);
+        g_free (writer->filename);
+        g_free (writer);
+}
@@ -0,0 +1,52 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL
+GBytes *        _dh_catalog_cache_load          (const gchar  *name,
+                                                 gchar       **etag);
+
+G_GNUC_INTERNAL
+void            _dh_catalog_cache_save          (const gchar  *name,
+                                                 const gchar  *etag,
+                                                 GBytes       *data);
+
+/* For saving a response as it is received. */
+typedef struct _DhCatalogCacheWriter DhCatalogCacheWriter;
+
+G_GNUC_INTERNAL
+DhCatalogCacheWriter *  _dh_catalog_cache_writer_new    (const gchar            *name,
+                                                         const gchar            *etag);
+
+G_GNUC_INTERNAL
+void                    _dh_catalog_cache_writer_write  (const gchar            *data,
+                                                         gsize                   length,
+                                                         gpointer                writer);
+
+G_GNUC_INTERNAL
+void                    _dh_catalog_cache_writer_commit (DhCatalogCacheWriter   *writer);
+
+G_GNUC_INTERNAL
+void                    _dh_catalog_cache_writer_free   (DhCatalogCacheWriter   *writer);
+
+G_END_DECLS
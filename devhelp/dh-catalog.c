@@ -0,0 +1,136 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-catalog.h"
+
+struct _DhCatalog {
+        gint ref_count;
+
+        /* Owned JsonObject*, in the order of the catalog. */
+        GPtrArray *docsets;
+};
+
+DhCatalog *
+_dh_catalog_new (void)
+{
+        DhCatalog *catalog;
+
+        catalog = g_new0 (DhCatalog, 1);
+        catalog->ref_count = 1;
+        catalog->docsets = g_ptr_array_new_with_free_func ((GDestroyNotify) json_object_unref);
+
+        return catalog;
+}
+
+/* Parses a complete /item response. */
+DhCatalog *
+_dh_catalog_new_from_data (const gchar  *data,
+                           gsize         length,
+                           GError      **error)
+{
+        DhCatalog *catalog;
+        JsonParser *parser;
+        JsonNode *root;
+        JsonArray *array;
+        guint i;
+
+        g_return_val_if_fail (data != NULL || length == 0, NULL);
+        g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+        parser = json_parser_new ();
+        if (!json_parser_load_from_data (parser, data, length, error)) {
+                g_object_unref (parser);
+                return NULL;
+        }
+
+        root = json_parser_get_root (parser);
+        if (root == NULL || !JSON_NODE_HOLDS_ARRAY (root)) {
+                g_set_error_literal (error,
+                                     JSON_PARSER_ERROR,
+                                     JSON_PARSER_ERROR_INVALID_DATA,
+                                     "The docsets catalog is not an array");
+                g_object_unref (parser);
+                return NULL;
+        }
+
+        catalog = _dh_catalog_new ();
+        array = json_node_get_array (root);
+
+        for (i = 0; i < json_array_get_length (array); i++) {
+                JsonNode *element_node = json_array_get_element (array, i);
+
+                if (JSON_NODE_HOLDS_OBJECT (element_node))
+                        _dh_catalog_add_docset (catalog, json_node_get_object (element_node));
+        }
+
+        g_object_unref (parser);
+        return catalog;
+}
+
+DhCatalog *
+_dh_catalog_ref (DhCatalog *catalog)
+{
+        g_return_val_if_fail (catalog != NULL, NULL);
+
+        g_atomic_int_inc (&catalog->ref_count);
+
+        return catalog;
+}
+
+void
+_dh_catalog_unref (DhCatalog *catalog)
+{
+        if (catalog == NULL)
+                return;
+
+        if (!g_atomic_int_dec_and_test (&catalog->ref_count))
+                return;
+
+        g_ptr_array_unref (catalog->docsets);
+        g_free (catalog);
+}
+
+/* Only while the catalog is being built, by a single thread. */
+void
+_dh_catalog_add_docset (DhCatalog  *catalog,
+                        JsonObject *docset)
+{
+        g_return_if_fail (catalog != NULL);
+        g_return_if_fail (docset != NULL);
+
+        g_ptr_array_add (catalog->docsets, json_object_ref (docset));
+}
+
+guint
+_dh_catalog_get_n_docsets (DhCatalog *catalog)
+{
+        g_return_val_if_fail (catalog != NULL, 0);
+
+        return catalog->docsets->len;
+}
+
+/* Returns: (transfer none). */
+JsonObject *
+_dh_catalog_get_docset (DhCatalog *catalog,
+                        guint      index_)
+{
+        g_return_val_if_fail (catalog != NULL, NULL);
+        g_return_val_if_fail (index_ < catalog->docsets->len, NULL);
+
+        return g_ptr_array_index (catalog->docsets, index_);
+}
@@ -0,0 +1,64 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <json-glib/json-glib.h>
+#include "dh-book.h"
+#include "dh-book-list-directory.h"
+
+G_BEGIN_DECLS
+
+/* DhCatalog is a snapshot of the docsets catalog of zealcore (the response of
+ * /item), parsed once. It is immutable once built, so it can be built in a
+ * worker thread and then shared. The DhBook of a docset is found with
+ * dh_book_list_find_by_id(), which is indexed.
+ */
+typedef struct _DhCatalog DhCatalog;
+
+G_GNUC_INTERNAL
+DhCatalog *     _dh_catalog_new                 (void);
+
+G_GNUC_INTERNAL
+DhCatalog *     _dh_catalog_new_from_data       (const gchar  *data,
+                                                 gsize         length,
+                                                 GError      **error);
+
+G_GNUC_INTERNAL
+DhCatalog *     _dh_catalog_ref                 (DhCatalog    *catalog);
+
+G_GNUC_INTERNAL
+void            _dh_catalog_unref               (DhCatalog    *catalog);
+
+G_GNUC_INTERNAL
+void            _dh_catalog_add_docset          (DhCatalog    *catalog,
+                                                 JsonObject   *docset);
+
+G_GNUC_INTERNAL
+guint           _dh_catalog_get_n_docsets       (DhCatalog    *catalog);
+
+G_GNUC_INTERNAL
+JsonObject *    _dh_catalog_get_docset          (DhCatalog    *catalog,
+                                                 guint         index_);
+
+/* Implemented in dh-book-list-directory.c. */
+
+G_GNUC_INTERNAL
+DhCatalog *     _dh_book_list_directory_get_catalog     (DhBookListDirectory *list_directory);
+
+G_END_DECLS
@@ -0,0 +1,530 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-completion-index.h"
+#include <string.h>
+#include "dh-book.h"
+#include "dh-link.h"
+
+/* The sources of the strings are DhBook objects, with the names of their links
+ * and, for the zealcore docsets, the names of their symbols in the
+ * DhSymbolIndex, and DhCompletion objects. The sources must not be modified
+ * while in the index.
+ *
+ * The strings of all the sources are kept in an immutable IndexData: sorted,
+ * without duplicates, in one block, with the number of times each string has
+ * been added. Adding or removing a source only marks the index as dirty; an
+ * update then takes the sources added and removed since the previous update,
+ * and merges their strings with the current IndexData in a worker thread, in
+ * one linear pass. Meanwhile the completion uses the current IndexData, the new
+ * one replaces it when it is ready.
+ *
+ * When the DhSymbolIndex changes, the strings of the books change too, so the
+ * IndexData is built again from all the sources.
+ */
+
+typedef struct {
+        volatile gint ref_count;
+
+        guint n_strings;
+        guint32 *offsets;
+        guint32 *counts;
+        gchar *strings;
+} IndexData;
+
+struct _DhCompletionIndex {
+        IndexData *data;
+
+        /* Owned GObject* -> NULL. The sources to complete with, and the ones
+         * whose strings are in data.
+         */
+        GHashTable *sources;
+        GHashTable *merged_sources;
+
+        /* The symbol index to take the symbols from, and the one used for
+         * data. Owned, nullable.
+         */
+        DhSymbolIndex *symbol_index;
+        DhSymbolIndex *merged_symbol_index;
+
+        /* Not NULL while an update runs. */
+        GCancellable *update_cancellable;
+
+        /* Whether there are changes not taken by an update yet. */
+        guint dirty : 1;
+};
+
+typedef struct {
+        /* Owned, NULL when building from scratch. */
+        IndexData *base;
+
+        /* Owned, nullable. */
+        DhSymbolIndex *symbol_index;
+
+        /* Owned GObject*. */
+        GPtrArray *added_sources;
+        GPtrArray *removed_sources;
+} UpdateData;
+
+typedef struct {
+        /* Borrowed from the base IndexData or from the sources. */
+        const gchar *str;
+        guint32 count;
+} MergedString;
+
+static IndexData *
+index_data_new (guint n_strings,
+                gsize strings_length)
+{
+        IndexData *data;
+
+        data = g_new0 (IndexData, 1);
+        data->ref_count = 1;
+        data->n_strings = n_strings;
+        data->offsets = g_new (guint32, n_strings);
+        data->counts = g_new (guint32, n_strings);
+        data->strings = g_malloc (strings_length);
+
+        return data;
+}
+
+static IndexData *
+index_data_ref (IndexData *data)
+{
+        g_atomic_int_inc (&data->ref_count);
+        return data;
+}
+
+static void
+index_data_unref (IndexData *data)
+{
+        if (data == NULL || !g_atomic_int_dec_and_test (&data->ref_count))
+                return;
+
+        g_free (data->offsets);
+        g_free (data->counts);
+        g_free (data->strings);
+        g_free (data);
+}
+
+static const gchar *
+index_data_get_string (gconstpointer data,
+                       guint         index_)
+{
+        const IndexData *index_data = data;
+
+        return index_data->strings + index_data->offsets[index_];
+}
+
+static void
+update_data_free (UpdateData *update_data)
+{
+        index_data_unref (update_data->base);
+        _dh_symbol_index_unref (update_data->symbol_index);
+        g_ptr_array_unref (update_data->added_sources);
+        g_ptr_array_unref (update_data->removed_sources);
+        g_free (update_data);
+}
+
+DhCompletionIndex *
+_dh_completion_index_new (void)
+{
+        DhCompletionIndex *index_;
+
+        index_ = g_new0 (DhCompletionIndex, 1);
+        index_->data = index_data_new (0, 0);
+        index_->sources = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+        index_->merged_sources = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
+        return index_;
+}
+
+void
+_dh_completion_index_free (DhCompletionIndex *index_)
+{
+        if (index_ == NULL)
+                return;
+
+        /* The update callback doesn't touch @index_ once cancelled. */
+        if (index_->update_cancellable != NULL) {
+                g_cancellable_cancel (index_->update_cancellable);
+                g_object_unref (index_->update_cancellable);
+        }
+
+        index_data_unref (index_->data);
+        g_hash_table_unref (index_->sources);
+        g_hash_table_unref (index_->merged_sources);
+        _dh_symbol_index_unref (index_->symbol_index);
+        _dh_symbol_index_unref (index_->merged_symbol_index);
+        g_free (index_);
+}
+
+/* Adds @source, a #DhBook or a sorted #DhCompletion, to the index. Its strings
+ * are merged by the next update.
+ */
+void
+_dh_completion_index_add (DhCompletionIndex *index_,
+                          GObject           *source)
+{
+        g_return_if_fail (index_ != NULL);
+        g_return_if_fail (DH_IS_BOOK (source) || DH_IS_COMPLETION (source));
+
+        if (g_hash_table_contains (index_->sources, source))
+                return;
+
+        g_hash_table_add (index_->sources, g_object_ref (source));
+        index_->dirty = TRUE;
+}
+
+void
+_dh_completion_index_remove (DhCompletionIndex *index_,
+                             GObject           *source)
+{
+        g_return_if_fail (index_ != NULL);
+        g_return_if_fail (G_IS_OBJECT (source));
+
+        if (g_hash_table_remove (index_->sources, source))
+                index_->dirty = TRUE;
+}
+
+/* Sets the #DhSymbolIndex with the symbols of the zealcore docsets. */
+void
+_dh_completion_index_set_symbol_index (DhCompletionIndex *index_,
+                                       DhSymbolIndex     *symbol_index)
+{
+        g_return_if_fail (index_ != NULL);
+
+        if (index_->symbol_index == symbol_index)
+                return;
+
+        _dh_symbol_index_unref (index_->symbol_index);
+        index_->symbol_index = symbol_index != NULL ? _dh_symbol_index_ref (symbol_index) : NULL;
+        index_->dirty = TRUE;
+}
+
+/* Called in the worker thread. */
+static void
+append_source_strings (GPtrArray     *strings,
+                       GObject       *source,
+                       DhSymbolIndex *symbol_index)
+{
+        DhBook *book;
+        GList *l;
+
+        if (DH_IS_COMPLETION (source)) {
+                DhCompletion *completion = DH_COMPLETION (source);
+                guint n_strings;
+                guint i;
+
+                n_strings = _dh_completion_get_n_strings (completion);
+                for (i = 0; i < n_strings; i++)
+                        g_ptr_array_add (strings, (gpointer) _dh_completion_get_string (completion, i));
+
+                return;
+        }
+
+        book = DH_BOOK (source);
+
+        for (l = dh_book_get_links (book); l != NULL; l = l->next) {
+                DhLink *link = l->data;
+
+                /* Like dh_book_get_completion(), the book titles are not
+                 * completed.
+                 */
+                if (dh_link_get_link_type (link) != DH_LINK_TYPE_BOOK)
+                        g_ptr_array_add (strings, (gpointer) dh_link_get_name (link));
+        }
+
+        if (symbol_index != NULL && dh_book_get_id (book) != NULL) {
+                const guint32 *symbols;
+                guint n_symbols;
+                guint i;
+
+                symbols = _dh_symbol_index_get_docset_symbols (symbol_index,
+                                                               dh_book_get_id (book),
+                                                               &n_symbols);
+
+                for (i = 0; i < n_symbols; i++)
+                        g_ptr_array_add (strings, (gpointer) _dh_symbol_index_get_name (symbol_index, symbols[i]));
+        }
+}
+
+static gint
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+        return strcmp (*(const gchar * const *) a, *(const gchar * const *) b);
+}
+
+/* Returns: (transfer full): the sorted strings of @sources. */
+static GPtrArray *
+get_sorted_strings (GPtrArray     *sources,
+                    DhSymbolIndex *symbol_index)
+{
+        GPtrArray *strings;
+        guint i;
+
+        strings = g_ptr_array_new ();
+
+        for (i = 0; i < sources->len; i++)
+                append_source_strings (strings, g_ptr_array_index (sources, i), symbol_index);
+
+        g_ptr_array_sort (strings, compare_strings);
+
+        return strings;
+}
+
+/* Merges the sorted @added strings into @base, and takes out the sorted
+ * @removed strings, in one pass.
+ */
+static IndexData *
+merge (IndexData *base,
+       GPtrArray *added,
+       GPtrArray *removed)
+{
+        GArray *merged;
+        IndexData *data;
+        guint n_base;
+        guint i = 0;
+        guint j = 0;
+        guint k = 0;
+        gsize strings_length = 0;
+
+        n_base = base != NULL ? base->n_strings : 0;
+        merged = g_array_sized_new (FALSE, FALSE, sizeof (MergedString), n_base + added->len);
+
+        while (i < n_base || j < added->len) {
+                MergedString merged_string;
+                const gchar *str;
+
+                if (j == added->len)
+                        str = index_data_get_string (base, i);
+                else if (i == n_base)
+                        str = g_ptr_array_index (added, j);
+                else if (strcmp (index_data_get_string (base, i), g_ptr_array_index (added, j)) <= 0)
+                        str = index_data_get_string (base, i);
+                else
+                        str = g_ptr_array_index (added, j);
+
+                merged_string.str = str;
+                merged_string.count = 0;
+
+                if (i < n_base && strcmp (index_data_get_string (base, i), str) == 0) {
+                        merged_string.count += base->counts[i];
+                        i++;
+                }
+
+                while (j < added->len && strcmp (g_ptr_array_index (added, j), str) == 0) {
+                        merged_string.count++;
+                        j++;
+                }
+
+                while (k < removed->len && strcmp (g_ptr_array_index (removed, k), str) <= 0) {
+                        if (merged_string.count > 0 &&
+                            strcmp (g_ptr_array_index (removed, k), str) == 0) {
+                                merged_string.count--;
+                        }
+                        k++;
+                }
+
+                if (merged_string.count > 0) {
+                        g_array_append_val (merged, merged_string);
+                        strings_length += strlen (str) + 1;
+                }
+        }
+
+        data = index_data_new (merged->len, strings_length);
+
+        strings_length = 0;
+        for (i = 0; i < merged->len; i++) {
+                const MergedString *merged_string = &g_array_index (merged, MergedString, i);
+                gsize length = strlen (merged_string->str) + 1;
+
+                data->offsets[i] = strings_length;
+                data->counts[i] = merged_string->count;
+                memcpy (data->strings + strings_length, merged_string->str, length);
+                strings_length += length;
+        }
+
+        g_array_unref (merged);
+
+        return data;
+}
+
+static void
+update_thread (GTask        *task,
+               gpointer      source_object,
+               gpointer      task_data,
+               GCancellable *cancellable)
+{
+        UpdateData *update_data = task_data;
+        GPtrArray *added;
+        GPtrArray *removed;
+        IndexData *data;
+
+        added = get_sorted_strings (update_data->added_sources, update_data->symbol_index);
+        removed = get_sorted_strings (update_data->removed_sources, update_data->symbol_index);
+
+        if (!g_task_return_error_if_cancelled (task)) {
+                data = merge (update_data->base, added, removed);
+                g_task_return_pointer (task, data, (GDestroyNotify) index_data_unref);
+        }
+
+        g_ptr_array_unref (added);
+        g_ptr_array_unref (removed);
+}
+
+static void
+update_cb (GObject      *source_object,
+           GAsyncResult *result,
+           gpointer      user_data)
+{
+        DhCompletionIndex *index_;
+        UpdateData *update_data;
+        IndexData *data;
+        GError *error = NULL;
+        guint i;
+
+        data = g_task_propagate_pointer (G_TASK (result), &error);
+
+        /* @index_ is freed. */
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+                g_error_free (error);
+                return;
+        }
+
+        index_ = user_data;
+        update_data = g_task_get_task_data (G_TASK (result));
+        g_clear_object (&index_->update_cancellable);
+
+        index_data_unref (index_->data);
+        index_->data = data;
+
+        if (index_->merged_symbol_index != update_data->symbol_index) {
+                _dh_symbol_index_unref (index_->merged_symbol_index);
+                index_->merged_symbol_index = update_data->symbol_index != NULL ?
+                                              _dh_symbol_index_ref (update_data->symbol_index) :
+                                              NULL;
+        }
+
+        if (update_data->base == NULL)
+                g_hash_table_remove_all (index_->merged_sources);
+
+        for (i = 0; i < update_data->removed_sources->len; i++)
+                g_hash_table_remove (index_->merged_sources, g_ptr_array_index (update_data->removed_sources, i));
+
+        for (i = 0; i < update_data->added_sources->len; i++)
+                g_hash_table_add (index_->merged_sources, g_object_ref (g_ptr_array_index (update_data->added_sources, i)));
+
+        /* The changes made during the update. */
+        _dh_completion_index_update (index_);
+}
+
+/* Starts merging the changes in a worker thread, if there are changes and no
+ * update is running already. Otherwise it is done when the running update
+ * finishes.
+ */
+void
+_dh_completion_index_update (DhCompletionIndex *index_)
+{
+        UpdateData *update_data;
+        GHashTableIter iter;
+        gpointer source;
+        GTask *task;
+
+        g_return_if_fail (index_ != NULL);
+
+        if (!index_->dirty || index_->update_cancellable != NULL)
+                return;
+
+        index_->dirty = FALSE;
+
+        update_data = g_new0 (UpdateData, 1);
+        update_data->added_sources = g_ptr_array_new_with_free_func (g_object_unref);
+        update_data->removed_sources = g_ptr_array_new_with_free_func (g_object_unref);
+        if (index_->symbol_index != NULL)
+                update_data->symbol_index = _dh_symbol_index_ref (index_->symbol_index);
+
+        /* With another symbol index, the strings of the merged books are not
+         * the ones in the current data.
+         */
+        if (index_->symbol_index == index_->merged_symbol_index) {
+                update_data->base = index_data_ref (index_->data);
+
+                g_hash_table_iter_init (&iter, index_->merged_sources);
+                while (g_hash_table_iter_next (&iter, &source, NULL)) {
+                        if (!g_hash_table_contains (index_->sources, source))
+                                g_ptr_array_add (update_data->removed_sources, g_object_ref (source));
+                }
+        }
+
+        g_hash_table_iter_init (&iter, index_->sources);
+        while (g_hash_table_iter_next (&iter, &source, NULL)) {
+                if (update_data->base == NULL ||
+                    !g_hash_table_contains (index_->merged_sources, source)) {
+                        g_ptr_array_add (update_data->added_sources, g_object_ref (source));
+                }
+        }
+
+        if (update_data->base != NULL &&
+            update_data->added_sources->len == 0 &&
+            update_data->removed_sources->len == 0) {
+                update_data_free (update_data);
+                return;
+        }
+
+        index_->update_cancellable = g_cancellable_new ();
+
+        task = g_task_new (NULL, index_->update_cancellable, update_cb, index_);
+        g_task_set_source_tag (task, _dh_completion_index_update);
+        g_task_set_task_data (task, update_data, (GDestroyNotify) update_data_free);
+        g_task_run_in_thread (task, update_thread);
+        g_object_unref (task);
+}
+
+/* Returns: whether an update is running. */
+gboolean
+_dh_completion_index_is_updating (DhCompletionIndex *index_)
+{
+        g_return_val_if_fail (index_ != NULL, FALSE);
+
+        return index_->update_cancellable != NULL;
+}
+
+/* Like dh_completion_aggregate_complete() with the sources of @index_, but
+ * with a single binary search. It never waits for an update: until it
+ * finishes, the strings of the previous update are used.
+ *
+ * Returns: (transfer full) (nullable): the completed prefix, or %NULL if a
+ * longer prefix has not been found.
+ */
+gchar *
+_dh_completion_index_complete (DhCompletionIndex *index_,
+                               const gchar       *prefix)
+{
+        g_return_val_if_fail (index_ != NULL, NULL);
+        g_return_val_if_fail (prefix != NULL, NULL);
+
+        _dh_completion_index_update (index_);
+
+        return _dh_completion_complete_sorted (index_data_get_string,
+                                               index_->data,
+                                               index_->data->n_strings,
+                                               prefix,
+                                               NULL);
+}
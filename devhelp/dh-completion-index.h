@@ -0,0 +1,79 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include "dh-completion.h"
+#include "dh-profile.h"
+#include "dh-symbol-index.h"
+
+G_BEGIN_DECLS
+
+/* DhCompletionIndex merges the completion strings of all the books of a
+ * profile, so that completing a prefix is one lookup, whatever the number of
+ * books. The merged data is built in a worker thread, and replaces the previous
+ * one when it is ready.
+ */
+typedef struct _DhCompletionIndex DhCompletionIndex;
+
+/* Returns the string at @index_ in a sorted array of strings. */
+typedef const gchar * (* DhCompletionGetStringFunc) (gconstpointer strings,
+                                                     guint         index_);
+
+G_GNUC_INTERNAL
+DhCompletionIndex *     _dh_completion_index_new                (void);
+
+G_GNUC_INTERNAL
+void                    _dh_completion_index_free               (DhCompletionIndex *index_);
+
+G_GNUC_INTERNAL
+void                    _dh_completion_index_add                (DhCompletionIndex *index_,
+                                                                 GObject           *source);
+
+G_GNUC_INTERNAL
+void                    _dh_completion_index_remove             (DhCompletionIndex *index_,
+                                                                 GObject           *source);
+
+G_GNUC_INTERNAL
+void                    _dh_completion_index_set_symbol_index   (DhCompletionIndex *index_,
+                                                                 DhSymbolIndex     *symbol_index);
+
+G_GNUC_INTERNAL
+void                    _dh_completion_index_update             (DhCompletionIndex *index_);
+
+G_GNUC_INTERNAL
+gboolean                _dh_completion_index_is_updating        (DhCompletionIndex *index_);
+
+G_GNUC_INTERNAL
+gchar *                 _dh_completion_index_complete           (DhCompletionIndex *index_,
+                                                                 const gchar       *prefix);
+
+/* Implemented in dh-profile.c. */
+G_GNUC_INTERNAL
+DhCompletionIndex *     _dh_profile_get_completion_index        (DhProfile         *profile);
+
+/* Implemented in dh-completion.c. */
+G_GNUC_INTERNAL
+gchar *                 _dh_completion_complete_sorted          (DhCompletionGetStringFunc  get_string_func,
+                                                                 gconstpointer              strings,
+                                                                 guint                      n_strings,
+                                                                 const gchar               *prefix,
+                                                                 gboolean                  *found_string_with_prefix);
+
+G_END_DECLS
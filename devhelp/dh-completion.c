@@ -20,6 +20,7 @@
 
 #include "dh-completion.h"
 #include <string.h>
+#include "dh-completion-index.h"
 
 /**
  * SECTION:dh-completion
@@ -29,8 +30,9 @@
  * #DhCompletion is a basic replacement for #GCompletion. #GCompletion (part of
  * GLib) is deprecated.
  *
- * #GCompletion is implemented with a simple #GList, while #DhCompletion uses a
- * (sorted) #GSequence instead (or a #GList of #DhCompletion objects with
+ * #GCompletion is implemented with a simple #GList, while #DhCompletion stores
+ * the strings sorted in a single block of memory, and completes with a binary
+ * search (or a #GList of #DhCompletion objects with
  * dh_completion_aggregate_complete()). So #DhCompletion should scale better
  * with more data, and #DhCompletion should be more appropriate if the same data
  * is used several times (on the other hand if the data is used only once,
@@ -44,8 +46,17 @@
  */
 
 typedef struct {
-        /* Element types: gchar*, owned. */
-        GSequence *sequence;
+        /* The strings, NUL-terminated, one after the other. After
+         * dh_completion_sort() they are in sorted order without duplicates, so
+         * that the strings with a common prefix are next to each other.
+         */
+        GByteArray *blob;
+
+        /* Element types: guint32, the offsets of the strings in blob. */
+        GArray *offsets;
+
+        /* The number of strings at the start of offsets that are sorted. */
+        guint n_sorted;
 } DhCompletionPrivate;
 
 typedef struct {
@@ -56,13 +67,21 @@ typedef struct {
 
 G_DEFINE_TYPE_WITH_PRIVATE (DhCompletion, dh_completion, G_TYPE_OBJECT)
 
+static inline const gchar *
+get_string (DhCompletionPrivate *priv,
+            guint                index_)
+{
+        return (const gchar *) priv->blob->data + g_array_index (priv->offsets, guint32, index_);
+}
+
 static gint
 compare_func (gconstpointer a,
               gconstpointer b,
               gpointer      user_data)
 {
-        const gchar *str_a = a;
-        const gchar *str_b = b;
+        const guint8 *blob = user_data;
+        const gchar *str_a = (const gchar *) blob + *(const guint32 *) a;
+        const gchar *str_b = (const gchar *) blob + *(const guint32 *) b;
 
         /* We rely on the fact that if str_a is not equal to str_b but one is
          * the prefix of the other, the shorter string is sorted before the
@@ -70,7 +89,7 @@ compare_func (gconstpointer a,
          * string). See do_complete().
          */
 
-        return g_strcmp0 (str_a, str_b);
+        return strcmp (str_a, str_b);
 }
 
 static void
@@ -88,7 +107,8 @@ dh_completion_finalize (GObject *object)
         DhCompletion *completion = DH_COMPLETION (object);
         DhCompletionPrivate *priv = dh_completion_get_instance_private (completion);
 
-        g_sequence_free (priv->sequence);
+        g_byte_array_unref (priv->blob);
+        g_array_unref (priv->offsets);
 
         G_OBJECT_CLASS (dh_completion_parent_class)->finalize (object);
 }
@@ -105,7 +125,8 @@ static void
 dh_completion_init (DhCompletion *completion)
 {
         DhCompletionPrivate *priv = dh_completion_get_instance_private (completion);
-        priv->sequence = g_sequence_new (g_free);
+        priv->blob = g_byte_array_new ();
+        priv->offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
 }
 
 /**
@@ -136,11 +157,18 @@ dh_completion_add_string (DhCompletion *completion,
                           const gchar  *str)
 {
         DhCompletionPrivate *priv = dh_completion_get_instance_private (completion);
+        gsize length;
+        guint32 offset;
 
         g_return_if_fail (DH_IS_COMPLETION (completion));
         g_return_if_fail (str != NULL);
 
-        g_sequence_append (priv->sequence, g_strdup (str));
+        length = strlen (str) + 1;
+        g_return_if_fail (length <= G_MAXUINT32 - priv->blob->len);
+
+        offset = priv->blob->len;
+        g_byte_array_append (priv->blob, (const guint8 *) str, length);
+        g_array_append_val (priv->offsets, offset);
 }
 
 /**
@@ -156,12 +184,42 @@ void
 dh_completion_sort (DhCompletion *completion)
 {
         DhCompletionPrivate *priv = dh_completion_get_instance_private (completion);
+        GByteArray *sorted_blob;
+        GArray *sorted_offsets;
+        const gchar *prev_str = NULL;
+        guint i;
 
         g_return_if_fail (DH_IS_COMPLETION (completion));
 
-        g_sequence_sort (priv->sequence,
-                         compare_func,
-                         NULL);
+        if (priv->n_sorted == priv->offsets->len)
+                return;
+
+        g_array_sort_with_data (priv->offsets, compare_func, priv->blob->data);
+
+        /* Copy the strings in sorted order, the strings with a common prefix
+         * are then in the same cache lines.
+         */
+        sorted_blob = g_byte_array_sized_new (priv->blob->len);
+        sorted_offsets = g_array_sized_new (FALSE, FALSE, sizeof (guint32), priv->offsets->len);
+
+        for (i = 0; i < priv->offsets->len; i++) {
+                const gchar *str = get_string (priv, i);
+                guint32 offset;
+
+                if (prev_str != NULL && strcmp (prev_str, str) == 0)
+                        continue;
+
+                offset = sorted_blob->len;
+                g_byte_array_append (sorted_blob, (const guint8 *) str, strlen (str) + 1);
+                g_array_append_val (sorted_offsets, offset);
+                prev_str = str;
+        }
+
+        g_byte_array_unref (priv->blob);
+        g_array_unref (priv->offsets);
+        priv->blob = sorted_blob;
+        priv->offsets = sorted_offsets;
+        priv->n_sorted = sorted_offsets->len;
 }
 
 static gboolean
@@ -246,74 +304,121 @@ next_completion_iteration (CompletionData *data,
         return TRUE;
 }
 
-/* Like dh_completion_complete() but with @found_string_with_prefix in
- * addition, to differentiate two different cases when %NULL is returned.
+/* Does the completion in @strings, an array of @n_strings strings sorted with
+ * strcmp() and without duplicates. The shared implementation of do_complete()
+ * and of the merged completion index of a profile.
  *
- * Another implementation solution: instead of returning (NULL +
- * found_string_with_prefix=TRUE), return a string equal to @prefix. But it
- * would be harder to document (because it's less explicit) and less convenient
- * to use as a public API (I think for a public API we don't want as a return
- * value a string equal to @prefix).
+ * Returns: (transfer full) (nullable): like do_complete().
  */
-static gchar *
-do_complete (DhCompletion *completion,
-             const gchar  *prefix,
-             gboolean     *found_string_with_prefix)
+gchar *
+_dh_completion_complete_sorted (DhCompletionGetStringFunc  get_string_func,
+                                gconstpointer              strings,
+                                guint                      n_strings,
+                                const gchar               *prefix,
+                                gboolean                  *found_string_with_prefix)
 {
-        DhCompletionPrivate *priv = dh_completion_get_instance_private (completion);
-        GSequenceIter *iter;
+        gsize prefix_length;
+        guint first;
+        guint end;
+        guint low;
+        guint high;
+        const gchar *first_str;
         CompletionData data;
 
         if (found_string_with_prefix != NULL)
                 *found_string_with_prefix = FALSE;
 
-        g_return_val_if_fail (DH_IS_COMPLETION (completion), NULL);
+        g_return_val_if_fail (get_string_func != NULL, NULL);
         g_return_val_if_fail (prefix != NULL, NULL);
 
-        iter = g_sequence_search (priv->sequence,
-                                  (gpointer) prefix,
-                                  compare_func,
-                                  NULL);
+        prefix_length = strlen (prefix);
 
-        /* There can be an exact match just *before* iter, since compare_func
-         * returns 0 in that case.
+        /* The strings having @prefix as prefix are a contiguous range of the
+         * sorted strings, find its bounds.
          */
-        if (!g_sequence_iter_is_begin (iter)) {
-                GSequenceIter *prev_iter;
-                const gchar *prev_str;
+        low = 0;
+        high = n_strings;
+        while (low < high) {
+                guint mid = low + (high - low) / 2;
+
+                if (strncmp (get_string_func (strings, mid), prefix, prefix_length) < 0)
+                        low = mid + 1;
+                else
+                        high = mid;
+        }
+        first = low;
 
-                prev_iter = g_sequence_iter_prev (iter);
-                prev_str = g_sequence_get (prev_iter);
+        high = n_strings;
+        while (low < high) {
+                guint mid = low + (high - low) / 2;
 
-                /* If there is an exact match, the prefix can not be completed. */
-                if (g_str_equal (prev_str, prefix)) {
-                        if (found_string_with_prefix != NULL)
-                                *found_string_with_prefix = TRUE;
-                        return NULL;
-                }
+                if (strncmp (get_string_func (strings, mid), prefix, prefix_length) == 0)
+                        low = mid + 1;
+                else
+                        high = mid;
         }
+        end = low;
 
-        completion_data_init (&data, prefix);
+        if (first == end)
+                return NULL;
+
+        if (found_string_with_prefix != NULL)
+                *found_string_with_prefix = TRUE;
 
-        /* All the other strings in the GSequence that have @prefix as prefix
-         * will be *after* iter, see the comment in compare_func().
+        /* If there is an exact match, the prefix can not be completed. It is
+         * the first string of the range, see the comment in compare_func().
          */
-        while (!g_sequence_iter_is_end (iter)) {
-                const gchar *cur_str = g_sequence_get (iter);
+        first_str = get_string_func (strings, first);
+        if (first_str[prefix_length] == '\0')
+                return NULL;
 
-                if (!g_str_has_prefix (cur_str, prefix))
-                        break;
+        /* Since the strings are sorted, the longest common prefix of the whole
+         * range is the one of its first and last strings.
+         */
+        completion_data_init (&data, prefix);
+        next_completion_iteration (&data, first_str);
+        if (end - first > 1)
+                next_completion_iteration (&data, get_string_func (strings, end - 1));
+
+        return data.longest_prefix;
+}
 
-                if (found_string_with_prefix != NULL)
-                        *found_string_with_prefix = TRUE;
+static const gchar *
+get_sorted_string (gconstpointer strings,
+                   guint         index_)
+{
+        return get_string ((DhCompletionPrivate *) strings, index_);
+}
 
-                if (!next_completion_iteration (&data, cur_str))
-                        break;
+/* Like dh_completion_complete() but with @found_string_with_prefix in
+ * addition, to differentiate two different cases when %NULL is returned.
+ *
+ * Another implementation solution: instead of returning (NULL +
+ * found_string_with_prefix=TRUE), return a string equal to @prefix. But it
+ * would be harder to document (because it's less explicit) and less convenient
+ * to use as a public API (I think for a public API we don't want as a return
+ * value a string equal to @prefix).
+ */
+static gchar *
+do_complete (DhCompletion *completion,
+             const gchar  *prefix,
+             gboolean     *found_string_with_prefix)
+{
+        DhCompletionPrivate *priv;
 
-                iter = g_sequence_iter_next (iter);
-        }
+        if (found_string_with_prefix != NULL)
+                *found_string_with_prefix = FALSE;
 
-        return data.longest_prefix;
+        g_return_val_if_fail (DH_IS_COMPLETION (completion), NULL);
+        g_return_val_if_fail (prefix != NULL, NULL);
+
+        priv = dh_completion_get_instance_private (completion);
+
+        return _dh_completion_complete_sorted (get_sorted_string,
+                                               priv,
+                                               priv->n_sorted,
+                                               prefix,
+                                               found_string_with_prefix);
 }
 
 /**
@@ -393,3 +498,34 @@ dh_completion_aggregate_complete (GList       *completion_objects,
 
         return data.longest_prefix;
 }
+
+/* Returns: the number of sorted strings of @completion, i.e. the strings added
+ * before the last call to dh_completion_sort().
+ */
+guint
+_dh_completion_get_n_strings (DhCompletion *completion)
+{
+        DhCompletionPrivate *priv;
+
+        g_return_val_if_fail (DH_IS_COMPLETION (completion), 0);
+
+        priv = dh_completion_get_instance_private (completion);
+        return priv->n_sorted;
+}
+
+/* Returns: (transfer none): the sorted string at @index_. It is valid until
+ * @completion is modified.
+ */
+const gchar *
+_dh_completion_get_string (DhCompletion *completion,
+                           guint         index_)
+{
+        DhCompletionPrivate *priv;
+
+        g_return_val_if_fail (DH_IS_COMPLETION (completion), NULL);
+
+        priv = dh_completion_get_instance_private (completion);
+        g_return_val_if_fail (index_ < priv->n_sorted, NULL);
+
+        return get_string (priv, index_);
+}
@@ -43,5 +43,12 @@ gchar        *dh_completion_complete           (DhCompletion *completion,
 gchar        *dh_completion_aggregate_complete (GList        *completion_objects,
                                                 const gchar  *prefix);
 
+G_GNUC_INTERNAL
+guint         _dh_completion_get_n_strings     (DhCompletion *completion);
+
+G_GNUC_INTERNAL
+const gchar  *_dh_completion_get_string        (DhCompletion *completion,
+                                                guint         index_);
+
 G_END_DECLS
 
@@ -0,0 +1,741 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-core-client.h"
+#include "dh-core-endpoint.h"
+#include "dh-core-readiness.h"
+#include <string.h>
+
+/* The single client to talk to zealcore, shared by all the call sites.
+ *
+ * It owns the only SoupSession, so that the connections to zealcore are kept
+ * alive and reused between requests instead of being opened for each one. The
+ * requests wait for zealcore to be ready, see dh-core-readiness.h, and the
+ * idempotent ones are sent again, after a short delay, if the connection
+ * failed. The time until the response headers is counted per endpoint, see
+ * _dh_core_client_get_stats().
+ *
+ * Only the asynchronous functions can be called from the main thread.
+ * _dh_core_client_send_in_worker() is for the GTask worker threads.
+ */
+
+/* The I/O timeout, zealcore runs locally so a longer wait means it's stuck. */
+#define TIMEOUT_SECS 30
+#define IDLE_TIMEOUT_SECS 60
+#define MAX_CONNS_PER_HOST 6
+
+/* The delay before sending a request again, doubled each time. */
+#define MAX_RETRIES 3
+#define RETRY_MIN_DELAY_MS 100
+
+typedef struct {
+        SoupSession *session;
+
+        /* Endpoint name -> owned DhCoreClientStats*, protected by
+         * client_mutex since it's updated from the worker threads too.
+         */
+        GHashTable *stats;
+} DhCoreClient;
+
+typedef struct {
+        SoupMessage *msg;
+        gchar *endpoint;
+        gint64 start_time;
+        guint n_attempts;
+
+        /* For the WebSockets. */
+        GStrv protocols;
+} SendData;
+
+/* Protects default_instance and its stats. */
+static GMutex client_mutex;
+static DhCoreClient *default_instance;
+
+static DhCoreClient *
+get_default (void)
+{
+        DhCoreClient *client;
+
+        g_mutex_lock (&client_mutex);
+
+        if (default_instance == NULL) {
+                client = g_new0 (DhCoreClient, 1);
+                client->session = soup_session_new_with_options (SOUP_SESSION_TIMEOUT, TIMEOUT_SECS,
+                                                                 SOUP_SESSION_IDLE_TIMEOUT, IDLE_TIMEOUT_SECS,
+                                                                 SOUP_SESSION_MAX_CONNS_PER_HOST, MAX_CONNS_PER_HOST,
+                                                                 NULL);
+                client->stats = g_hash_table_new_full (g_str_hash,
+                                                       g_str_equal,
+                                                       g_free,
+                                                       g_free);
+                default_instance = client;
+        }
+
+        client = default_instance;
+        g_mutex_unlock (&client_mutex);
+
+        return client;
+}
+
+/* The first segment of the path, e.g. "group" for "/group/1/doc". */
+static gchar *
+get_endpoint (SoupMessage *msg)
+{
+        const gchar *path;
+        const gchar *end;
+
+        path = soup_message_get_uri (msg)->path;
+
+        while (*path == '/')
+                path++;
+
+        end = strchr (path, '/');
+        if (end == NULL)
+                return g_strdup (path);
+
+        return g_strndup (path, end - path);
+}
+
+static DhCoreClientStats *
+get_stats_locked (DhCoreClient *client,
+                  const gchar  *endpoint)
+{
+        DhCoreClientStats *stats;
+
+        stats = g_hash_table_lookup (client->stats, endpoint);
+        if (stats == NULL) {
+                stats = g_new0 (DhCoreClientStats, 1);
+                g_hash_table_insert (client->stats, g_strdup (endpoint), stats);
+        }
+
+        return stats;
+}
+
+static void
+record_retry (const gchar *endpoint)
+{
+        g_mutex_lock (&client_mutex);
+
+        /* Not recorded after _dh_core_client_shutdown(). */
+        if (default_instance != NULL)
+                get_stats_locked (default_instance, endpoint)->n_retries++;
+
+        g_mutex_unlock (&client_mutex);
+}
+
+static void
+record_result (const gchar *endpoint,
+               gint64       start_time,
+               gboolean     success)
+{
+        DhCoreClientStats *stats;
+        gint64 latency;
+
+        latency = g_get_monotonic_time () - start_time;
+
+        g_mutex_lock (&client_mutex);
+
+        if (default_instance == NULL) {
+                g_mutex_unlock (&client_mutex);
+                return;
+        }
+
+        stats = get_stats_locked (default_instance, endpoint);
+
+        if (success) {
+                stats->n_requests++;
+                stats->total_latency += latency;
+                stats->max_latency = MAX (stats->max_latency, latency);
+        } else {
+                stats->n_failures++;
+        }
+
+        g_mutex_unlock (&client_mutex);
+}
+
+static gboolean
+is_idempotent (SoupMessage *msg)
+{
+        return (g_str_equal (msg->method, SOUP_METHOD_GET) ||
+                g_str_equal (msg->method, SOUP_METHOD_HEAD) ||
+                g_str_equal (msg->method, SOUP_METHOD_PUT) ||
+                g_str_equal (msg->method, SOUP_METHOD_DELETE));
+}
+
+/* Whether the request failed before it reached zealcore, for example because
+ * zealcore has closed a kept-alive connection at the same time it was reused.
+ * A timeout isn't retried, zealcore is likely busy with the request.
+ */
+static gboolean
+is_connection_error (const GError *error)
+{
+        if (error->domain == SOUP_HTTP_ERROR)
+                return (SOUP_STATUS_IS_TRANSPORT_ERROR (error->code) &&
+                        error->code != SOUP_STATUS_CANCELLED &&
+                        error->code != SOUP_STATUS_IO_ERROR);
+
+        return (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CONNECTION_REFUSED) ||
+                g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CONNECTION_CLOSED) ||
+                g_error_matches (error, G_IO_ERROR, G_IO_ERROR_BROKEN_PIPE) ||
+                g_error_matches (error, G_IO_ERROR, G_IO_ERROR_HOST_UNREACHABLE) ||
+                g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NETWORK_UNREACHABLE));
+}
+
+static gboolean
+should_retry (SoupMessage  *msg,
+              const GError *error,
+              guint         n_attempts)
+{
+        return (n_attempts <= MAX_RETRIES &&
+                is_idempotent (msg) &&
+                is_connection_error (error));
+}
+
+static guint
+get_retry_delay_ms (guint n_attempts)
+{
+        return RETRY_MIN_DELAY_MS << (n_attempts - 1);
+}
+
+static SendData *
+send_data_new (SoupMessage *msg)
+{
+        SendData *data;
+
+        data = g_new0 (SendData, 1);
+        data->msg = g_object_ref (msg);
+        data->endpoint = get_endpoint (msg);
+
+        return data;
+}
+
+static void
+send_data_free (SendData *data)
+{
+        g_object_unref (data->msg);
+        g_free (data->endpoint);
+        g_strfreev (data->protocols);
+        g_free (data);
+}
+
+/**
+ * _dh_core_client_get_session:
+ *
+ * Returns: (transfer none): the #SoupSession shared by the requests to
+ * zealcore.
+ */
+SoupSession *
+_dh_core_client_get_session (void)
+{
+        return get_default ()->session;
+}
+
+/**
+ * _dh_core_client_new_message:
+ * @method: the HTTP method.
+ * @path: the path on the zealcore endpoint, see _dh_core_endpoint_get_uri().
+ *
+ * Returns: (transfer full): a new #SoupMessage for zealcore.
+ */
+SoupMessage *
+_dh_core_client_new_message (const gchar *method,
+                             const gchar *path)
+{
+        SoupMessage *msg;
+        gchar *uri;
+
+        g_return_val_if_fail (method != NULL, NULL);
+        g_return_val_if_fail (path != NULL, NULL);
+
+        uri = _dh_core_endpoint_get_uri (path);
+        msg = soup_message_new (method, uri);
+        g_free (uri);
+
+        return msg;
+}
+
+static void send_attempt (GTask *task);
+
+static gboolean
+retry_timeout_cb (gpointer user_data)
+{
+        GTask *task = G_TASK (user_data);
+
+        if (g_task_return_error_if_cancelled (task))
+                g_object_unref (task);
+        else
+                send_attempt (task);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+send_cb (GObject      *source_object,
+         GAsyncResult *result,
+         gpointer      user_data)
+{
+        GTask *task = G_TASK (user_data);
+        SendData *data = g_task_get_task_data (task);
+        GInputStream *stream;
+        GError *error = NULL;
+
+        stream = soup_session_send_finish (SOUP_SESSION (source_object), result, &error);
+
+        if (stream == NULL && should_retry (data->msg, error, data->n_attempts)) {
+                g_error_free (error);
+                record_retry (data->endpoint);
+                g_timeout_add (get_retry_delay_ms (data->n_attempts), retry_timeout_cb, task);
+                return;
+        }
+
+        record_result (data->endpoint, data->start_time, stream != NULL);
+
+        if (stream != NULL)
+                g_task_return_pointer (task, stream, g_object_unref);
+        else
+                g_task_return_error (task, error);
+
+        g_object_unref (task);
+}
+
+static void
+send_attempt (GTask *task)
+{
+        SendData *data = g_task_get_task_data (task);
+
+        data->n_attempts++;
+
+        soup_session_send_async (get_default ()->session,
+                                 data->msg,
+                                 g_task_get_cancellable (task),
+                                 send_cb,
+                                 task);
+}
+
+static void
+send_ready_cb (gboolean ready,
+               gpointer user_data)
+{
+        GTask *task = G_TASK (user_data);
+        SendData *data = g_task_get_task_data (task);
+
+        if (g_task_return_error_if_cancelled (task)) {
+                g_object_unref (task);
+                return;
+        }
+
+        if (!ready) {
+                g_task_return_new_error (task,
+                                         G_IO_ERROR,
+                                         G_IO_ERROR_NOT_CONNECTED,
+                                         "zealcore is not running");
+                g_object_unref (task);
+                return;
+        }
+
+        data->start_time = g_get_monotonic_time ();
+        send_attempt (task);
+}
+
+/**
+ * _dh_core_client_send_async:
+ * @msg: a #SoupMessage for zealcore.
+ * @cancellable: (nullable): a #GCancellable.
+ * @callback: the function to call when the response headers are received.
+ * @user_data: the data to pass to @callback.
+ *
+ * Sends @msg once zealcore is ready. Like soup_session_send_async(), the
+ * status of @msg isn't an error, the caller checks it. Main thread only.
+ */
+void
+_dh_core_client_send_async (SoupMessage         *msg,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+        GTask *task;
+
+        g_return_if_fail (SOUP_IS_MESSAGE (msg));
+        g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+        task = g_task_new (NULL, cancellable, callback, user_data);
+        g_task_set_source_tag (task, _dh_core_client_send_async);
+        g_task_set_task_data (task, send_data_new (msg), (GDestroyNotify) send_data_free);
+
+        _dh_core_readiness_when_ready (send_ready_cb, task, NULL);
+}
+
+/**
+ * _dh_core_client_send_finish:
+ * @result: a #GAsyncResult.
+ * @error: location to a %NULL #GError, or %NULL.
+ *
+ * Returns: (transfer full) (nullable): the stream of the response body, or
+ * %NULL on error.
+ */
+GInputStream *
+_dh_core_client_send_finish (GAsyncResult  *result,
+                             GError       **error)
+{
+        g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+        g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+        return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+read_splice_cb (GObject      *source_object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+        GTask *task = G_TASK (user_data);
+        GError *error = NULL;
+
+        if (g_output_stream_splice_finish (G_OUTPUT_STREAM (source_object), result, &error) < 0) {
+                g_task_return_error (task, error);
+        } else {
+                GMemoryOutputStream *output = G_MEMORY_OUTPUT_STREAM (source_object);
+
+                g_task_return_pointer (task,
+                                       g_memory_output_stream_steal_as_bytes (output),
+                                       (GDestroyNotify) g_bytes_unref);
+        }
+
+        g_object_unref (task);
+}
+
+static void
+read_send_cb (GObject      *source_object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+        GTask *task = G_TASK (user_data);
+        GInputStream *stream;
+        GOutputStream *output;
+        GError *error = NULL;
+
+        stream = _dh_core_client_send_finish (result, &error);
+        if (stream == NULL) {
+                g_task_return_error (task, error);
+                g_object_unref (task);
+                return;
+        }
+
+        output = g_memory_output_stream_new_resizable ();
+        g_output_stream_splice_async (output,
+                                      stream,
+                                      G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+                                      G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                                      G_PRIORITY_DEFAULT,
+                                      g_task_get_cancellable (task),
+                                      read_splice_cb,
+                                      task);
+
+        g_object_unref (output);
+        g_object_unref (stream);
+}
+
+/**
+ * _dh_core_client_send_and_read_async:
+ * @msg: a #SoupMessage for zealcore.
+ * @cancellable: (nullable): a #GCancellable.
+ * @callback: the function to call when the whole response is received.
+ * @user_data: the data to pass to @callback.
+ *
+ * Like _dh_core_client_send_async(), but reads the whole response body, for
+ * the small responses.
+ */
+void
+_dh_core_client_send_and_read_async (SoupMessage         *msg,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data)
+{
+        GTask *task;
+
+        g_return_if_fail (SOUP_IS_MESSAGE (msg));
+        g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+        task = g_task_new (NULL, cancellable, callback, user_data);
+        g_task_set_source_tag (task, _dh_core_client_send_and_read_async);
+
+        _dh_core_client_send_async (msg, cancellable, read_send_cb, task);
+}
+
+/**
+ * _dh_core_client_send_and_read_finish:
+ * @result: a #GAsyncResult.
+ * @error: location to a %NULL #GError, or %NULL.
+ *
+ * Returns: (transfer full) (nullable): the response body, or %NULL on error.
+ */
+GBytes *
+_dh_core_client_send_and_read_finish (GAsyncResult  *result,
+                                      GError       **error)
+{
+        g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+        g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+        return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * _dh_core_client_send_in_worker:
+ * @msg: a #SoupMessage for zealcore.
+ * @cancellable: (nullable): a #GCancellable.
+ * @error: location to a %NULL #GError, or %NULL.
+ *
+ * The blocking version of _dh_core_client_send_async(), for the worker
+ * threads that read the response as it arrives. It must not be called from
+ * the main thread.
+ *
+ * Returns: (transfer full) (nullable): the stream of the response body, or
+ * %NULL on error.
+ */
+GInputStream *
+_dh_core_client_send_in_worker (SoupMessage   *msg,
+                                GCancellable  *cancellable,
+                                GError       **error)
+{
+        SoupSession *session;
+        GInputStream *stream;
+        gchar *endpoint;
+        gint64 start_time;
+        guint n_attempts;
+        GError *local_error = NULL;
+
+        g_return_val_if_fail (SOUP_IS_MESSAGE (msg), NULL);
+        g_return_val_if_fail (!g_main_context_is_owner (g_main_context_default ()), NULL);
+        g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+        if (!_dh_core_readiness_wait (cancellable, error))
+                return NULL;
+
+        session = get_default ()->session;
+        endpoint = get_endpoint (msg);
+        start_time = g_get_monotonic_time ();
+
+        for (n_attempts = 1; ; n_attempts++) {
+                stream = soup_session_send (session, msg, cancellable, &local_error);
+
+                if (stream != NULL || !should_retry (msg, local_error, n_attempts))
+                        break;
+
+                g_clear_error (&local_error);
+                record_retry (endpoint);
+                g_usleep (get_retry_delay_ms (n_attempts) * G_TIME_SPAN_MILLISECOND);
+
+                if (g_cancellable_set_error_if_cancelled (cancellable, &local_error))
+                        break;
+        }
+
+        record_result (endpoint, start_time, stream != NULL);
+        g_free (endpoint);
+
+        if (local_error != NULL)
+                g_propagate_error (error, local_error);
+
+        return stream;
+}
+
+static void
+websocket_connect_cb (GObject      *source_object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+        GTask *task = G_TASK (user_data);
+        SendData *data = g_task_get_task_data (task);
+        SoupWebsocketConnection *ws;
+        GError *error = NULL;
+
+        ws = soup_session_websocket_connect_finish (SOUP_SESSION (source_object), result, &error);
+
+        record_result (data->endpoint, data->start_time, ws != NULL);
+
+        if (ws != NULL)
+                g_task_return_pointer (task, ws, g_object_unref);
+        else
+                g_task_return_error (task, error);
+
+        g_object_unref (task);
+}
+
+static void
+websocket_ready_cb (gboolean ready,
+                    gpointer user_data)
+{
+        GTask *task = G_TASK (user_data);
+        SendData *data = g_task_get_task_data (task);
+
+        if (g_task_return_error_if_cancelled (task)) {
+                g_object_unref (task);
+                return;
+        }
+
+        if (!ready) {
+                g_task_return_new_error (task,
+                                         G_IO_ERROR,
+                                         G_IO_ERROR_NOT_CONNECTED,
+                                         "zealcore is not running");
+                g_object_unref (task);
+                return;
+        }
+
+        data->start_time = g_get_monotonic_time ();
+
+        soup_session_websocket_connect_async (get_default ()->session,
+                                              data->msg,
+                                              "http://localhost/",
+                                              data->protocols,
+                                              g_task_get_cancellable (task),
+                                              websocket_connect_cb,
+                                              task);
+}
+
+/**
+ * _dh_core_client_websocket_connect_async:
+ * @msg: a #SoupMessage for a zealcore WebSocket, see
+ *   _dh_core_endpoint_get_websocket_uri().
+ * @protocols: (nullable): the sub-protocols to offer, see
+ *   soup_websocket_connection_get_protocol() for the one chosen by zealcore.
+ * @cancellable: (nullable): a #GCancellable.
+ * @callback: the function to call when the connection is open.
+ * @user_data: the data to pass to @callback.
+ *
+ * Opens a WebSocket to zealcore once it is ready. The connection isn't
+ * reopened if it fails, the callers reopen it on demand.
+ */
+void
+_dh_core_client_websocket_connect_async (SoupMessage         *msg,
+                                         const gchar * const *protocols,
+                                         GCancellable        *cancellable,
+                                         GAsyncReadyCallback  callback,
+                                         gpointer             user_data)
+{
+        GTask *task;
+        SendData *data;
+
+        g_return_if_fail (SOUP_IS_MESSAGE (msg));
+        g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+        data = send_data_new (msg);
+        data->protocols = g_strdupv ((gchar **) protocols);
+
+        task = g_task_new (NULL, cancellable, callback, user_data);
+        g_task_set_source_tag (task, _dh_core_client_websocket_connect_async);
+        g_task_set_task_data (task, data, (GDestroyNotify) send_data_free);
+
+        _dh_core_readiness_when_ready (websocket_ready_cb, task, NULL);
+}
+
+/**
+ * _dh_core_client_websocket_connect_finish:
+ * @result: a #GAsyncResult.
+ * @error: location to a %NULL #GError, or %NULL.
+ *
+ * Returns: (transfer full) (nullable): the WebSocket connection, or %NULL on
+ * error.
+ */
+SoupWebsocketConnection *
+_dh_core_client_websocket_connect_finish (GAsyncResult  *result,
+                                          GError       **error)
+{
+        g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+        g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+        return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * _dh_core_client_get_stats:
+ * @endpoint: the first path segment of the requests, e.g. "item".
+ * @stats: (out): the counters of @endpoint.
+ *
+ * Returns: whether a request has been sent to @endpoint.
+ */
+gboolean
+_dh_core_client_get_stats (const gchar       *endpoint,
+                           DhCoreClientStats *stats)
+{
+        DhCoreClientStats *endpoint_stats = NULL;
+
+        g_return_val_if_fail (endpoint != NULL, FALSE);
+        g_return_val_if_fail (stats != NULL, FALSE);
+
+        g_mutex_lock (&client_mutex);
+
+        if (default_instance != NULL)
+                endpoint_stats = g_hash_table_lookup (default_instance->stats, endpoint);
+
+        if (endpoint_stats != NULL)
+                *stats = *endpoint_stats;
+
+        g_mutex_unlock (&client_mutex);
+
+        return endpoint_stats != NULL;
+}
+
+/* Logs the counters, with G_MESSAGES_DEBUG=Devhelp. */
+static void
+log_stats (DhCoreClient *client)
+{
+        GHashTableIter iter;
+        gpointer key;
+        gpointer value;
+
+        g_hash_table_iter_init (&iter, client->stats);
+        while (g_hash_table_iter_next (&iter, &key, &value)) {
+                const gchar *endpoint = key;
+                DhCoreClientStats *stats = value;
+                gdouble mean_ms = 0.0;
+
+                if (stats->n_requests > 0)
+                        mean_ms = (gdouble) stats->total_latency / stats->n_requests / 1000.0;
+
+                g_debug ("zealcore /%s: %u requests, %u failures, %u retries, "
+                         "mean latency %.1f ms, max latency %.1f ms",
+                         endpoint,
+                         stats->n_requests,
+                         stats->n_failures,
+                         stats->n_retries,
+                         mean_ms,
+                         stats->max_latency / 1000.0);
+        }
+}
+
+/* Aborts the pending requests and frees the client, at the end of main(). */
+void
+_dh_core_client_shutdown (void)
+{
+        DhCoreClient *client;
+
+        g_mutex_lock (&client_mutex);
+        client = default_instance;
+        default_instance = NULL;
+        g_mutex_unlock (&client_mutex);
+
+        if (client == NULL)
+                return;
+
+        log_stats (client);
+
+        soup_session_abort (client->session);
+        g_object_unref (client->session);
+        g_hash_table_unref (client->stats);
+        g_free (client);
+}
@@ -0,0 +1,99 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+typedef struct _DhCoreClientStats DhCoreClientStats;
+
+/**
+ * DhCoreClientStats:
+ * @n_requests: the number of requests that got a response.
+ * @n_failures: the number of requests that failed without a response.
+ * @n_retries: the number of times a request has been sent again.
+ * @total_latency: the sum of the time until the response headers, in
+ *   microseconds.
+ * @max_latency: the longest time until the response headers, in microseconds.
+ *
+ * The counters for one endpoint of zealcore, i.e. the first path segment of
+ * the requests, like "item" or "group".
+ */
+struct _DhCoreClientStats {
+        guint n_requests;
+        guint n_failures;
+        guint n_retries;
+        gint64 total_latency;
+        gint64 max_latency;
+};
+
+G_GNUC_INTERNAL
+SoupSession *           _dh_core_client_get_session                     (void);
+
+G_GNUC_INTERNAL
+SoupMessage *           _dh_core_client_new_message                     (const gchar          *method,
+                                                                         const gchar          *path);
+
+G_GNUC_INTERNAL
+void                    _dh_core_client_send_async                      (SoupMessage          *msg,
+                                                                         GCancellable         *cancellable,
+                                                                         GAsyncReadyCallback   callback,
+                                                                         gpointer              user_data);
+
+G_GNUC_INTERNAL
+GInputStream *          _dh_core_client_send_finish                     (GAsyncResult         *result,
+                                                                         GError              **error);
+
+G_GNUC_INTERNAL
+void                    _dh_core_client_send_and_read_async             (SoupMessage          *msg,
+                                                                         GCancellable         *cancellable,
+                                                                         GAsyncReadyCallback   callback,
+                                                                         gpointer              user_data);
+
+G_GNUC_INTERNAL
+GBytes *                _dh_core_client_send_and_read_finish            (GAsyncResult         *result,
+                                                                         GError              **error);
+
+G_GNUC_INTERNAL
+GInputStream *          _dh_core_client_send_in_worker                  (SoupMessage          *msg,
+                                                                         GCancellable         *cancellable,
+                                                                         GError              **error);
+
+G_GNUC_INTERNAL
+void                    _dh_core_client_websocket_connect_async         (SoupMessage          *msg,
+                                                                         const gchar * const  *protocols,
+                                                                         GCancellable         *cancellable,
+                                                                         GAsyncReadyCallback   callback,
+                                                                         gpointer              user_data);
+
+G_GNUC_INTERNAL
+SoupWebsocketConnection *
+                        _dh_core_client_websocket_connect_finish        (GAsyncResult         *result,
+                                                                         GError              **error);
+
+G_GNUC_INTERNAL
+gboolean                _dh_core_client_get_stats                       (const gchar          *endpoint,
+                                                                         DhCoreClientStats    *stats);
+
+G_GNUC_INTERNAL
+void                    _dh_core_client_shutdown                        (void);
+
+G_END_DECLS
@@ -0,0 +1,162 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-core-endpoint.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* The single place where the address of zealcore is known. Every request to
+ * zealcore builds its URI with _dh_core_endpoint_get_uri() or
+ * _dh_core_endpoint_get_websocket_uri().
+ *
+ * The endpoint is read once from DH_CORE_ENDPOINT_ENV, in the form
+ * "tcp:HOST:PORT". The same variable is passed to zealcore when it is forked,
+ * so that both sides agree, and two users on the same host can each use their
+ * own port.
+ *
+ * "unix:PATH" endpoints are recognized but not supported: the HTTP and
+ * WebSocket requests go through libsoup 2.4 and the pages are loaded by
+ * WebKit, neither of which can connect to a Unix-domain socket. The default
+ * endpoint is used instead.
+ */
+
+#define DEFAULT_HOST "localhost"
+#define DEFAULT_PORT 12340
+
+typedef struct {
+        gchar *spec;
+        gchar *host;
+        guint16 port;
+} Endpoint;
+
+static gboolean
+parse_tcp_spec (const gchar *spec,
+                Endpoint    *endpoint)
+{
+        const gchar *host_start;
+        const gchar *port_start;
+        gchar *end = NULL;
+        gulong port;
+
+        if (!g_str_has_prefix (spec, "tcp:"))
+                return FALSE;
+
+        host_start = spec + strlen ("tcp:");
+        port_start = strrchr (host_start, ':');
+        if (port_start == NULL || port_start == host_start)
+                return FALSE;
+
+        port = strtoul (port_start + 1, &end, 10);
+        if (end == port_start + 1 || *end != '\0' || port == 0 || port > G_MAXUINT16)
+                return FALSE;
+
+        endpoint->host = g_strndup (host_start, port_start - host_start);
+        endpoint->port = port;
+        endpoint->spec = g_strdup (spec);
+
+        return TRUE;
+}
+
+static const Endpoint *
+get_endpoint (void)
+{
+        static gsize initialized = 0;
+        static Endpoint endpoint;
+
+        if (g_once_init_enter (&initialized)) {
+                const gchar *spec = g_getenv (DH_CORE_ENDPOINT_ENV);
+
+                if (spec != NULL && g_str_has_prefix (spec, "unix:")) {
+                        g_warning ("The zealcore endpoint “%s” is not supported, "
+                                   "only TCP endpoints are. Using the default one.",
+                                   spec);
+                } else if (spec != NULL && !parse_tcp_spec (spec, &endpoint)) {
+                        g_warning ("Invalid zealcore endpoint “%s”, expected "
+                                   "“tcp:HOST:PORT”. Using the default one.",
+                                   spec);
+                }
+
+                if (endpoint.spec == NULL) {
+                        endpoint.host = g_strdup (DEFAULT_HOST);
+                        endpoint.port = DEFAULT_PORT;
+                        endpoint.spec = g_strdup_printf ("tcp:%s:%u", DEFAULT_HOST, DEFAULT_PORT);
+                }
+
+                g_once_init_leave (&initialized, 1);
+        }
+
+        return &endpoint;
+}
+
+/* Returns: the endpoint, in the "tcp:HOST:PORT" form. */
+const gchar *
+_dh_core_endpoint_get_spec (void)
+{
+        return get_endpoint ()->spec;
+}
+
+/* Returns: (transfer full): the address to connect to zealcore directly. */
+GSocketConnectable *
+_dh_core_endpoint_get_connectable (void)
+{
+        const Endpoint *endpoint = get_endpoint ();
+
+        return g_network_address_new (endpoint->host, endpoint->port);
+}
+
+static gchar *
+get_uri (const gchar *scheme,
+         const gchar *path)
+{
+        const Endpoint *endpoint = get_endpoint ();
+
+        g_return_val_if_fail (path != NULL, NULL);
+
+        /* The paths returned by zealcore are relative. */
+        if (path[0] == '/')
+                path++;
+
+        return g_strdup_printf ("%s://%s:%u/%s", scheme, endpoint->host, endpoint->port, path);
+}
+
+/*
+ * _dh_core_endpoint_get_uri:
+ * @path: the path of the resource, e.g. "item", with or without the leading
+ *   slash. It must be already escaped.
+ *
+ * Can be called from any thread.
+ *
+ * Returns: (transfer full): the HTTP URI of @path on zealcore.
+ */
+gchar *
+_dh_core_endpoint_get_uri (const gchar *path)
+{
+        return get_uri ("http", path);
+}
+
+/*
+ * _dh_core_endpoint_get_websocket_uri:
+ * @path: the path of the WebSocket, e.g. "search".
+ *
+ * Returns: (transfer full): the WebSocket URI of @path on zealcore.
+ */
+gchar *
+_dh_core_endpoint_get_websocket_uri (const gchar *path)
+{
+        return get_uri ("ws", path);
+}
@@ -0,0 +1,42 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* The environment variable to configure the zealcore endpoint, and to pass it
+ * to zealcore, e.g. "tcp:127.0.0.1:12340".
+ */
+#define DH_CORE_ENDPOINT_ENV "ZEVDOCS_CORE_ENDPOINT"
+
+G_GNUC_INTERNAL
+const gchar *           _dh_core_endpoint_get_spec              (void);
+
+G_GNUC_INTERNAL
+GSocketConnectable *    _dh_core_endpoint_get_connectable       (void);
+
+G_GNUC_INTERNAL
+gchar *                 _dh_core_endpoint_get_uri               (const gchar *path);
+
+G_GNUC_INTERNAL
+gchar *                 _dh_core_endpoint_get_websocket_uri     (const gchar *path);
+
+G_END_DECLS
@@ -0,0 +1,375 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-core-readiness.h"
+#include "dh-core-endpoint.h"
+#include <errno.h>
+#include <glib-unix.h>
+#include <unistd.h>
+
+/* Tracks when zealcore, forked at startup, is ready to accept connections, so
+ * that the UI can be built in the meantime and only the requests to zealcore
+ * wait.
+ *
+ * zealcore inherits the write end of a pipe, see DH_CORE_READY_FD_ENV. It is
+ * ready as soon as it writes to it, or as soon as a connection to its endpoint
+ * succeeds, for the zealcore versions that don't write to it. The end of file
+ * on the pipe only means that zealcore has exited if a connection fails too:
+ * it also happens when zealcore closes the inherited fds or daemonizes.
+ *
+ * If zealcore isn't ready after READY_TIMEOUT_SECS, or has exited, the waiting
+ * requests fail. The connection attempts continue though, less often, and the
+ * requests succeed again once zealcore is up, for a slow first start.
+ *
+ * If _dh_core_readiness_start() is not called, zealcore is assumed to be
+ * managed by someone else and to be ready.
+ */
+
+/* The delay between two connection attempts, doubled each time. */
+#define PROBE_MIN_INTERVAL_MS 10
+#define PROBE_MAX_INTERVAL_MS 250
+
+/* The delay between two connection attempts once the startup has failed. */
+#define PROBE_FAILED_INTERVAL_MS 2000
+
+#define READY_TIMEOUT_SECS 60
+
+typedef enum {
+        CORE_STATE_NOT_WATCHED,
+        CORE_STATE_STARTING,
+        CORE_STATE_READY,
+        CORE_STATE_FAILED
+} CoreState;
+
+typedef struct {
+        DhCoreReadyFunc func;
+        gpointer user_data;
+        GDestroyNotify notify;
+} ReadyCallback;
+
+/* Protects state, which is read by the worker threads. */
+static GMutex state_mutex;
+static GCond state_cond;
+static CoreState state = CORE_STATE_NOT_WATCHED;
+
+/* The rest is only accessed from the main thread. */
+static gint ready_fd = -1;
+static guint ready_fd_source_id;
+static gboolean ready_fd_eof;
+static guint probe_timeout_id;
+static guint ready_timeout_id;
+static guint probe_interval_ms;
+static GSocketClient *probe_client;
+static GSocketConnectable *probe_address;
+static GCancellable *probe_cancellable;
+
+/* List of owned ReadyCallback*. */
+static GSList *ready_callbacks;
+
+static void probe (void);
+
+static void
+stop_watching (void)
+{
+        if (ready_fd_source_id != 0) {
+                g_source_remove (ready_fd_source_id);
+                ready_fd_source_id = 0;
+        }
+        if (ready_fd != -1) {
+                g_close (ready_fd, NULL);
+                ready_fd = -1;
+        }
+        if (probe_timeout_id != 0) {
+                g_source_remove (probe_timeout_id);
+                probe_timeout_id = 0;
+        }
+        if (ready_timeout_id != 0) {
+                g_source_remove (ready_timeout_id);
+                ready_timeout_id = 0;
+        }
+        if (probe_cancellable != NULL) {
+                g_cancellable_cancel (probe_cancellable);
+                g_clear_object (&probe_cancellable);
+        }
+        g_clear_object (&probe_client);
+        g_clear_object (&probe_address);
+}
+
+/* The transitions are STARTING -> READY or FAILED, and FAILED -> READY. */
+static void
+set_state (CoreState new_state)
+{
+        GSList *callbacks;
+        GSList *l;
+
+        g_mutex_lock (&state_mutex);
+        if (state != CORE_STATE_STARTING &&
+            !(state == CORE_STATE_FAILED && new_state == CORE_STATE_READY)) {
+                g_mutex_unlock (&state_mutex);
+                return;
+        }
+        state = new_state;
+        g_cond_broadcast (&state_cond);
+        g_mutex_unlock (&state_mutex);
+
+        if (new_state == CORE_STATE_FAILED) {
+                g_warning ("zealcore is not running, the documentation can't be loaded.");
+
+                /* Keep probing, in case zealcore is only slow to start. */
+                if (ready_timeout_id != 0) {
+                        g_source_remove (ready_timeout_id);
+                        ready_timeout_id = 0;
+                }
+        } else {
+                /* Nothing to watch anymore. */
+                stop_watching ();
+        }
+
+        callbacks = g_slist_reverse (ready_callbacks);
+        ready_callbacks = NULL;
+
+        for (l = callbacks; l != NULL; l = l->next) {
+                ReadyCallback *callback = l->data;
+
+                callback->func (new_state == CORE_STATE_READY, callback->user_data);
+
+                if (callback->notify != NULL)
+                        callback->notify (callback->user_data);
+                g_free (callback);
+        }
+
+        g_slist_free (callbacks);
+}
+
+static gboolean
+ready_fd_cb (gint         fd,
+             GIOCondition condition,
+             gpointer     user_data)
+{
+        gchar buffer[64];
+        gssize n_read;
+
+        n_read = read (fd, buffer, sizeof (buffer));
+        if (n_read < 0 && (errno == EINTR || errno == EAGAIN))
+                return G_SOURCE_CONTINUE;
+
+        /* The source is removed by set_state(). */
+        ready_fd_source_id = 0;
+
+        if (n_read > 0) {
+                set_state (CORE_STATE_READY);
+                return G_SOURCE_REMOVE;
+        }
+
+        /* The end of file: zealcore has exited, or has just closed the pipe.
+         * The next failed connection attempt tells, so do it right away.
+         */
+        g_close (ready_fd, NULL);
+        ready_fd = -1;
+        ready_fd_eof = TRUE;
+
+        if (probe_timeout_id != 0) {
+                g_source_remove (probe_timeout_id);
+                probe_timeout_id = 0;
+                probe ();
+        }
+
+        return G_SOURCE_REMOVE;
+}
+
+static gboolean
+probe_timeout_cb (gpointer user_data)
+{
+        probe_timeout_id = 0;
+        probe ();
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+probe_cb (GObject      *source_object,
+          GAsyncResult *result,
+          gpointer      user_data)
+{
+        GSocketConnection *connection;
+        GError *error = NULL;
+
+        connection = g_socket_client_connect_finish (G_SOCKET_CLIENT (source_object),
+                                                     result,
+                                                     &error);
+
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+                g_error_free (error);
+                return;
+        }
+
+        if (connection != NULL) {
+                g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+                g_object_unref (connection);
+                set_state (CORE_STATE_READY);
+                return;
+        }
+
+        g_clear_error (&error);
+
+        if (ready_fd_eof)
+                set_state (CORE_STATE_FAILED);
+
+        /* Main thread only, like set_state(), so no need to lock. */
+        if (state == CORE_STATE_FAILED) {
+                probe_timeout_id = g_timeout_add (PROBE_FAILED_INTERVAL_MS, probe_timeout_cb, NULL);
+                return;
+        }
+
+        probe_timeout_id = g_timeout_add (probe_interval_ms, probe_timeout_cb, NULL);
+        probe_interval_ms = MIN (probe_interval_ms * 2, PROBE_MAX_INTERVAL_MS);
+}
+
+static void
+probe (void)
+{
+        g_socket_client_connect_async (probe_client,
+                                       probe_address,
+                                       probe_cancellable,
+                                       probe_cb,
+                                       NULL);
+}
+
+static gboolean
+ready_timeout_cb (gpointer user_data)
+{
+        ready_timeout_id = 0;
+        set_state (CORE_STATE_FAILED);
+
+        return G_SOURCE_REMOVE;
+}
+
+/*
+ * _dh_core_readiness_start:
+ * @fd: the read end of the pipe given to zealcore, or -1. Owned by this module
+ *   afterwards.
+ *
+ * Starts watching zealcore, which has just been forked. Must be called from
+ * the main thread, before the main loop runs.
+ */
+void
+_dh_core_readiness_start (gint fd)
+{
+        g_return_if_fail (state == CORE_STATE_NOT_WATCHED);
+
+        g_mutex_lock (&state_mutex);
+        state = CORE_STATE_STARTING;
+        g_mutex_unlock (&state_mutex);
+
+        if (fd != -1) {
+                ready_fd = fd;
+                ready_fd_source_id = g_unix_fd_add (fd,
+                                                    G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                                    ready_fd_cb,
+                                                    NULL);
+        }
+
+        probe_client = g_socket_client_new ();
+        probe_address = _dh_core_endpoint_get_connectable ();
+        probe_cancellable = g_cancellable_new ();
+        probe_interval_ms = PROBE_MIN_INTERVAL_MS;
+        probe ();
+
+        ready_timeout_id = g_timeout_add_seconds (READY_TIMEOUT_SECS, ready_timeout_cb, NULL);
+}
+
+/*
+ * _dh_core_readiness_wait:
+ * @cancellable: (nullable): a #GCancellable.
+ * @error: location to a %NULL #GError, or %NULL.
+ *
+ * Blocks until zealcore is ready. It relies on the main loop, so it must be
+ * called from a worker thread, see _dh_core_readiness_when_ready() for the
+ * main thread.
+ *
+ * Returns: %TRUE if zealcore is ready, %FALSE if it has failed to start (it can
+ * still be ready later) or if @cancellable has been cancelled.
+ */
+gboolean
+_dh_core_readiness_wait (GCancellable  *cancellable,
+                         GError       **error)
+{
+        CoreState current_state;
+
+        g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+        g_mutex_lock (&state_mutex);
+
+        while (state == CORE_STATE_STARTING &&
+               !g_cancellable_is_cancelled (cancellable)) {
+                /* Wake up from time to time to check @cancellable. */
+                g_cond_wait_until (&state_cond,
+                                   &state_mutex,
+                                   g_get_monotonic_time () + 100 * G_TIME_SPAN_MILLISECOND);
+        }
+
+        current_state = state;
+        g_mutex_unlock (&state_mutex);
+
+        if (g_cancellable_set_error_if_cancelled (cancellable, error))
+                return FALSE;
+
+        if (current_state == CORE_STATE_FAILED) {
+                g_set_error_literal (error,
+                                     G_IO_ERROR,
+                                     G_IO_ERROR_NOT_CONNECTED,
+                                     "zealcore is not running");
+                return FALSE;
+        }
+
+        return TRUE;
+}
+
+/*
+ * _dh_core_readiness_when_ready:
+ * @func: the function to call once the startup of zealcore is over, with
+ *   whether it is ready.
+ * @user_data: the data to pass to @func.
+ * @notify: (nullable): the function to free @user_data, called after @func.
+ *
+ * Calls @func right away if the startup is already over. Main thread only.
+ */
+void
+_dh_core_readiness_when_ready (DhCoreReadyFunc func,
+                               gpointer        user_data,
+                               GDestroyNotify  notify)
+{
+        ReadyCallback *callback;
+
+        g_return_if_fail (func != NULL);
+
+        if (state != CORE_STATE_STARTING) {
+                func (state != CORE_STATE_FAILED, user_data);
+
+                if (notify != NULL)
+                        notify (user_data);
+                return;
+        }
+
+        callback = g_new0 (ReadyCallback, 1);
+        callback->func = func;
+        callback->user_data = user_data;
+        callback->notify = notify;
+
+        ready_callbacks = g_slist_prepend (ready_callbacks, callback);
+}
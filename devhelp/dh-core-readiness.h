@@ -0,0 +1,45 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* The name of the environment variable giving zealcore the file descriptor to
+ * write "READY=1\n" to once it accepts connections.
+ */
+#define DH_CORE_READY_FD_ENV "ZEVDOCS_READY_FD"
+
+typedef void (* DhCoreReadyFunc) (gboolean ready,
+                                  gpointer user_data);
+
+G_GNUC_INTERNAL
+void            _dh_core_readiness_start        (gint             ready_fd);
+
+G_GNUC_INTERNAL
+gboolean        _dh_core_readiness_wait         (GCancellable    *cancellable,
+                                                 GError         **error);
+
+G_GNUC_INTERNAL
+void            _dh_core_readiness_when_ready   (DhCoreReadyFunc  func,
+                                                 gpointer         user_data,
+                                                 GDestroyNotify   notify);
+
+G_END_DECLS
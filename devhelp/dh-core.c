@@ -0,0 +1,714 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-core.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "dh-core-client.h"
+#include "dh-core-endpoint.h"
+#include "dh-core-readiness.h"
+#include "dh-json-array-reader.h"
+
+/**
+ * SECTION:dh-core
+ * @Title: zealcore
+ * @Short_description: The docsets server
+ *
+ * zealcore is the server that downloads the docsets, and serves their catalog,
+ * their pages and the search results. The Devhelp library talks to it over
+ * HTTP and WebSocket.
+ *
+ * The application starts zealcore with dh_core_start() and stops it with
+ * dh_core_stop(). If dh_core_start() is not called, zealcore is assumed to be
+ * started by someone else.
+ *
+ * The docsets that can be downloaded are listed with
+ * dh_core_list_docsets_async(), and downloaded with
+ * dh_core_download_docset_async(). The installed docsets are removed with
+ * dh_core_remove_docset_async().
+ */
+
+typedef struct {
+        SoupMessage *msg;
+        DhJsonArrayReader *reader;
+        DhCoreDocsetFunc docset_func;
+        gpointer docset_data;
+} ListDocsetsData;
+
+typedef struct {
+        SoupMessage *msg;
+        SoupWebsocketConnection *connection;
+        DhCoreProgressFunc progress_func;
+        gpointer progress_data;
+} DownloadData;
+
+static pid_t zealcore_pid = -1;
+
+/**
+ * dh_core_start:
+ *
+ * Forks and executes zealcore, found in /app/bin, or in $SNAP/app/bin in a
+ * snap. This function returns right away: the requests to zealcore wait until
+ * it is ready to accept connections.
+ *
+ * zealcore is given the endpoint to listen to in the ZEVDOCS_CORE_ENDPOINT
+ * environment variable, and the file descriptor to report its readiness to in
+ * ZEVDOCS_READY_FD.
+ *
+ * This function is meant to be called at the beginning of main(), before any
+ * thread is created. It does nothing if zealcore is already started.
+ *
+ * Since: 3.32
+ */
+void
+dh_core_start (void)
+{
+        int ready_pipe[2] = { -1, -1 };
+        const gchar *endpoint;
+
+        if (zealcore_pid > 0)
+                return;
+
+        /* zealcore listens where the requests are sent. */
+        endpoint = _dh_core_endpoint_get_spec ();
+
+        /* zealcore signals on the pipe when it is ready, and the end of file
+         * tells that it has exited. The UI is built in the meantime.
+         */
+        if (pipe (ready_pipe) != 0) {
+                ready_pipe[0] = -1;
+                ready_pipe[1] = -1;
+        } else {
+                fcntl (ready_pipe[0], F_SETFD, FD_CLOEXEC);
+        }
+
+        zealcore_pid = fork();
+
+        if (zealcore_pid == 0) {
+                char env[10000] = {0};
+                strcat(env, "/run/host/usr/share:");
+                strcat(env, getenv("HOME"));
+                strcat(env, "/.local/share");
+                setenv("XDG_DATA_DIRS", env, 1);
+                setenv("GIN_MODE", "release", 1);
+                setenv(DH_CORE_ENDPOINT_ENV, endpoint, 1);
+                if (ready_pipe[1] != -1) {
+                    char fd[16];
+                    snprintf(fd, sizeof(fd), "%d", ready_pipe[1]);
+                    setenv(DH_CORE_READY_FD_ENV, fd, 1);
+                }
+                if (getenv("SNAP")) {
+                    char path[10000] = {0};
+                    strcat(path, getenv("SNAP"));
+                    strcat(path, "/app/bin/zealcore");
+                    execl(path, "zealcore", (char *) NULL);
+                } else {
+                    execl("/app/bin/zealcore", "zealcore", (char *) NULL);
+                }
+                _exit(1);
+        }
+
+        if (ready_pipe[1] != -1)
+                close (ready_pipe[1]);
+
+        /* Before anything queries zealcore. */
+        if (zealcore_pid > 0) {
+                _dh_core_readiness_start (ready_pipe[0]);
+        } else if (ready_pipe[0] != -1) {
+                close (ready_pipe[0]);
+        }
+}
+
+/**
+ * dh_core_stop:
+ *
+ * Terminates the zealcore started by dh_core_start(), if it is still running.
+ *
+ * This function is meant to be called at the end of main().
+ *
+ * Since: 3.32
+ */
+void
+dh_core_stop (void)
+{
+        int pid_status;
+
+        if (zealcore_pid <= 0)
+                return;
+
+        if (waitpid(zealcore_pid, &pid_status, WNOHANG) == 0) {
+                kill(zealcore_pid, SIGTERM);
+        }
+
+        zealcore_pid = -1;
+}
+
+static const gchar *
+get_repo_number (DhCoreRepo repo)
+{
+        switch (repo) {
+                case DH_CORE_REPO_KAPELI:
+                        return "1";
+
+                case DH_CORE_REPO_KAPELI_CONTRIB:
+                        return "2";
+
+                default:
+                        g_return_val_if_reached (NULL);
+        }
+}
+
+/* The ID of @repo in the requests and the messages of zealcore. */
+static const gchar *
+get_repo_id (DhCoreRepo repo)
+{
+        switch (repo) {
+                case DH_CORE_REPO_KAPELI:
+                        return "com.kapeli";
+
+                case DH_CORE_REPO_KAPELI_CONTRIB:
+                        return "com.kapeli.contrib";
+
+                default:
+                        g_return_val_if_reached (NULL);
+        }
+}
+
+static void
+list_docsets_data_free (gpointer user_data)
+{
+        ListDocsetsData *data = user_data;
+
+        g_object_unref (data->msg);
+        if (data->reader != NULL)
+                _dh_json_array_reader_free (data->reader);
+        g_free (data);
+}
+
+static void
+list_docsets_batch_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+        GTask *task = G_TASK (user_data);
+        ListDocsetsData *data = g_task_get_task_data (task);
+        GPtrArray *batch;
+        GError *error = NULL;
+        guint i;
+
+        batch = _dh_json_array_reader_next_batch_finish (data->reader, result, &error);
+        if (batch == NULL) {
+                g_task_return_error (task, error);
+                g_object_unref (task);
+                return;
+        }
+
+        if (batch->len == 0) {
+                g_ptr_array_unref (batch);
+                g_task_return_boolean (task, TRUE);
+                g_object_unref (task);
+                return;
+        }
+
+        /* Nothing is reported once cancelled, not even a batch already read. */
+        if (g_task_return_error_if_cancelled (task)) {
+                g_ptr_array_unref (batch);
+                g_object_unref (task);
+                return;
+        }
+
+        for (i = 0; i < batch->len; i++) {
+                JsonNode *element = g_ptr_array_index (batch, i);
+                JsonObject *object;
+
+                if (!JSON_NODE_HOLDS_OBJECT (element))
+                        continue;
+
+                object = json_node_get_object (element);
+                data->docset_func (json_object_get_string_member (object, "Id"),
+                                   json_object_get_string_member (object, "Title"),
+                                   data->docset_data);
+        }
+
+        g_ptr_array_unref (batch);
+
+        _dh_json_array_reader_next_batch_async (data->reader,
+                                                g_task_get_cancellable (task),
+                                                list_docsets_batch_cb,
+                                                task);
+}
+
+static void
+list_docsets_send_cb (GObject      *source_object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+        GTask *task = G_TASK (user_data);
+        ListDocsetsData *data = g_task_get_task_data (task);
+        GInputStream *stream;
+        GError *error = NULL;
+
+        stream = _dh_core_client_send_finish (result, &error);
+        if (stream == NULL) {
+                g_task_return_error (task, error);
+                g_object_unref (task);
+                return;
+        }
+
+        if (!SOUP_STATUS_IS_SUCCESSFUL (data->msg->status_code)) {
+                g_task_return_new_error (task,
+                                         G_IO_ERROR,
+                                         G_IO_ERROR_FAILED,
+                                         "Failed to get the list of docsets: %s",
+                                         data->msg->reason_phrase);
+                g_object_unref (stream);
+                g_object_unref (task);
+                return;
+        }
+
+        data->reader = _dh_json_array_reader_new (stream);
+        g_object_unref (stream);
+
+        _dh_json_array_reader_next_batch_async (data->reader,
+                                                g_task_get_cancellable (task),
+                                                list_docsets_batch_cb,
+                                                task);
+}
+
+/**
+ * dh_core_list_docsets_async:
+ * @repo: a #DhCoreRepo.
+ * @cancellable: (nullable): a #GCancellable.
+ * @docset_func: called for each docset of @repo.
+ * @docset_data: data to pass to @docset_func.
+ * @callback: called when all the docsets have been listed.
+ * @user_data: data to pass to @callback.
+ *
+ * Lists the docsets of @repo that can be downloaded. A repository holds
+ * thousands of docsets: the response is read as a stream, and @docset_func is
+ * called in the main context as the docsets arrive, before @callback. It is no
+ * longer called once @cancellable is cancelled.
+ *
+ * @docset_data must stay valid until @callback is called.
+ *
+ * Since: 3.32
+ */
+void
+dh_core_list_docsets_async (DhCoreRepo           repo,
+                            GCancellable        *cancellable,
+                            DhCoreDocsetFunc     docset_func,
+                            gpointer             docset_data,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+        GTask *task;
+        ListDocsetsData *data;
+        gchar *path;
+
+        g_return_if_fail (get_repo_number (repo) != NULL);
+        g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+        g_return_if_fail (docset_func != NULL);
+
+        task = g_task_new (NULL, cancellable, callback, user_data);
+
+        path = g_strdup_printf ("repo/%s/items", get_repo_number (repo));
+
+        data = g_new0 (ListDocsetsData, 1);
+        data->msg = _dh_core_client_new_message ("GET", path);
+        data->docset_func = docset_func;
+        data->docset_data = docset_data;
+        g_task_set_task_data (task, data, list_docsets_data_free);
+
+        _dh_core_client_send_async (data->msg,
+                                    cancellable,
+                                    list_docsets_send_cb,
+                                    task);
+
+        g_free (path);
+}
+
+/**
+ * dh_core_list_docsets_finish:
+ * @result: a #GAsyncResult.
+ * @error: a location for a #GError, or %NULL.
+ *
+ * Finishes an operation started with dh_core_list_docsets_async().
+ *
+ * Returns: whether all the docsets have been listed.
+ * Since: 3.32
+ */
+gboolean
+dh_core_list_docsets_finish (GAsyncResult  *result,
+                             GError       **error)
+{
+        g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+        return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void download_progress_message_cb (SoupWebsocketConnection *connection,
+                                          gint                     type,
+                                          GBytes                  *message,
+                                          GTask                   *task);
+
+static void download_progress_closed_cb (SoupWebsocketConnection *connection,
+                                         GTask                   *task);
+
+static void
+download_data_free (gpointer user_data)
+{
+        DownloadData *data = user_data;
+
+        g_object_unref (data->msg);
+
+        if (data->connection != NULL) {
+                g_signal_handlers_disconnect_matched (data->connection,
+                                                      G_SIGNAL_MATCH_FUNC,
+                                                      0, 0, NULL,
+                                                      download_progress_message_cb,
+                                                      NULL);
+                g_signal_handlers_disconnect_matched (data->connection,
+                                                      G_SIGNAL_MATCH_FUNC,
+                                                      0, 0, NULL,
+                                                      download_progress_closed_cb,
+                                                      NULL);
+                g_object_unref (data->connection);
+        }
+
+        g_free (data);
+}
+
+static void
+download_progress_message_cb (SoupWebsocketConnection *connection,
+                              gint                     type,
+                              GBytes                  *message,
+                              GTask                   *task)
+{
+        DownloadData *data = g_task_get_task_data (task);
+        JsonParser *parser;
+        JsonNode *root;
+        JsonObject *object;
+        const gchar *repo_id;
+        const gchar *message_data;
+        gsize length;
+
+        /* The progress stops being followed at the next message. */
+        if (g_cancellable_is_cancelled (g_task_get_cancellable (task))) {
+                if (soup_websocket_connection_get_state (connection) == SOUP_WEBSOCKET_STATE_OPEN)
+                        soup_websocket_connection_close (connection, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL);
+                return;
+        }
+
+        message_data = g_bytes_get_data (message, &length);
+        if (length < 2)
+                return;
+
+        parser = json_parser_new ();
+        if (!json_parser_load_from_data (parser, message_data, length, NULL))
+                goto out;
+
+        root = json_parser_get_root (parser);
+        if (!JSON_NODE_HOLDS_OBJECT (root))
+                goto out;
+
+        /* zealcore reports the progress of all the downloads. */
+        object = json_node_get_object (root);
+        repo_id = json_object_get_string_member (object, "RepoId");
+
+        data->progress_func (g_strcmp0 (repo_id, get_repo_id (DH_CORE_REPO_KAPELI)) == 0 ?
+                             DH_CORE_REPO_KAPELI :
+                             DH_CORE_REPO_KAPELI_CONTRIB,
+                             json_object_get_string_member (object, "Docset"),
+                             json_object_get_int_member (object, "Received"),
+                             json_object_get_int_member (object, "Total"),
+                             data->progress_data);
+
+out:
+        g_object_unref (parser);
+}
+
+static void
+download_progress_closed_cb (SoupWebsocketConnection *connection,
+                             GTask                   *task)
+{
+        if (!g_task_return_error_if_cancelled (task))
+                g_task_return_boolean (task, TRUE);
+
+        g_object_unref (task);
+}
+
+static void
+download_progress_connect_cb (GObject      *source_object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+        GTask *task = G_TASK (user_data);
+        DownloadData *data = g_task_get_task_data (task);
+
+        /* The download is queued anyway, only the progress is unknown. */
+        data->connection = _dh_core_client_websocket_connect_finish (result, NULL);
+        if (data->connection == NULL) {
+                g_task_return_boolean (task, TRUE);
+                g_object_unref (task);
+                return;
+        }
+
+        g_signal_connect_data (data->connection,
+                               "message",
+                               G_CALLBACK (download_progress_message_cb),
+                               task, NULL, 0);
+
+        g_signal_connect_data (data->connection,
+                               "closed",
+                               G_CALLBACK (download_progress_closed_cb),
+                               task, NULL, 0);
+}
+
+static void
+download_start_cb (GObject      *source_object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+        GTask *task = G_TASK (user_data);
+        DownloadData *data = g_task_get_task_data (task);
+        SoupMessage *request;
+        GBytes *body;
+        GError *error = NULL;
+        gchar *uri;
+
+        body = _dh_core_client_send_and_read_finish (result, &error);
+        if (body == NULL) {
+                g_task_return_error (task, error);
+                g_object_unref (task);
+                return;
+        }
+
+        g_bytes_unref (body);
+
+        if (!SOUP_STATUS_IS_SUCCESSFUL (data->msg->status_code)) {
+                g_task_return_new_error (task,
+                                         G_IO_ERROR,
+                                         G_IO_ERROR_FAILED,
+                                         "Failed to start the download: %s",
+                                         data->msg->reason_phrase);
+                g_object_unref (task);
+                return;
+        }
+
+        /* The progress is followed once zealcore has queued the download. */
+        uri = _dh_core_endpoint_get_websocket_uri ("download_progress");
+        request = soup_message_new ("GET", uri);
+        g_free (uri);
+
+        _dh_core_client_websocket_connect_async (request,
+                                                 NULL,
+                                                 g_task_get_cancellable (task),
+                                                 download_progress_connect_cb,
+                                                 task);
+        g_object_unref (request);
+}
+
+/**
+ * dh_core_download_docset_async:
+ * @repo: a #DhCoreRepo.
+ * @docset_id: the ID of the docset in @repo.
+ * @cancellable: (nullable): a #GCancellable.
+ * @progress_func: called as the docsets are downloaded.
+ * @progress_data: data to pass to @progress_func.
+ * @callback: called when zealcore has finished downloading.
+ * @user_data: data to pass to @callback.
+ *
+ * Asks zealcore to download and install a docset. zealcore reports the
+ * progress of all its downloads, not only the one of @docset_id, so
+ * @progress_func is called with the repository and the title of each docset.
+ *
+ * @callback is called when zealcore stops reporting the progress. If the
+ * progress can't be followed, @callback is called as soon as the download is
+ * queued. @progress_data must stay valid until @callback is called.
+ *
+ * Since: 3.32
+ */
+void
+dh_core_download_docset_async (DhCoreRepo           repo,
+                               const gchar         *docset_id,
+                               GCancellable        *cancellable,
+                               DhCoreProgressFunc   progress_func,
+                               gpointer             progress_data,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+        GTask *task;
+        DownloadData *data;
+        JsonObject *object;
+        JsonNode *root;
+        JsonGenerator *generator;
+        gchar *json;
+        gsize length;
+
+        g_return_if_fail (get_repo_id (repo) != NULL);
+        g_return_if_fail (docset_id != NULL);
+        g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+        g_return_if_fail (progress_func != NULL);
+
+        task = g_task_new (NULL, cancellable, callback, user_data);
+
+        object = json_object_new ();
+        json_object_set_string_member (object, "id", docset_id);
+        json_object_set_string_member (object, "repo", get_repo_id (repo));
+
+        root = json_node_new (JSON_NODE_OBJECT);
+        json_node_take_object (root, object);
+
+        generator = json_generator_new ();
+        json_generator_set_root (generator, root);
+        json = json_generator_to_data (generator, &length);
+
+        data = g_new0 (DownloadData, 1);
+        data->msg = _dh_core_client_new_message ("POST", "item");
+        data->progress_func = progress_func;
+        data->progress_data = progress_data;
+        g_task_set_task_data (task, data, download_data_free);
+
+        soup_message_set_request (data->msg,
+                                  "application/json",
+                                  SOUP_MEMORY_TAKE,
+                                  json,
+                                  length);
+
+        _dh_core_client_send_and_read_async (data->msg,
+                                             cancellable,
+                                             download_start_cb,
+                                             task);
+
+        g_object_unref (generator);
+        json_node_free (root);
+}
+
+/**
+ * dh_core_download_docset_finish:
+ * @result: a #GAsyncResult.
+ * @error: a location for a #GError, or %NULL.
+ *
+ * Finishes an operation started with dh_core_download_docset_async().
+ *
+ * Returns: whether zealcore has accepted to download the docset.
+ * Since: 3.32
+ */
+gboolean
+dh_core_download_docset_finish (GAsyncResult  *result,
+                                GError       **error)
+{
+        g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+        return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+remove_docset_cb (GObject      *source_object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+        GTask *task = G_TASK (user_data);
+        SoupMessage *msg = g_task_get_task_data (task);
+        GBytes *body;
+        GError *error = NULL;
+
+        body = _dh_core_client_send_and_read_finish (result, &error);
+        if (body == NULL) {
+                g_task_return_error (task, error);
+                g_object_unref (task);
+                return;
+        }
+
+        g_bytes_unref (body);
+
+        if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
+                g_task_return_new_error (task,
+                                         G_IO_ERROR,
+                                         G_IO_ERROR_FAILED,
+                                         "Failed to remove the docset: %s",
+                                         msg->reason_phrase);
+        } else {
+                g_task_return_boolean (task, TRUE);
+        }
+
+        g_object_unref (task);
+}
+
+/**
+ * dh_core_remove_docset_async:
+ * @docset_id: the ID of an installed docset, see dh_book_get_id().
+ * @cancellable: (nullable): a #GCancellable.
+ * @callback: called when the docset is removed.
+ * @user_data: data to pass to @callback.
+ *
+ * Asks zealcore to remove an installed docset.
+ *
+ * Since: 3.32
+ */
+void
+dh_core_remove_docset_async (const gchar         *docset_id,
+                             GCancellable        *cancellable,
+                             GAsyncReadyCallback  callback,
+                             gpointer             user_data)
+{
+        GTask *task;
+        SoupMessage *msg;
+        gchar *path;
+
+        g_return_if_fail (docset_id != NULL);
+        g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+        task = g_task_new (NULL, cancellable, callback, user_data);
+
+        path = g_strjoin ("/", "item", docset_id, NULL);
+        msg = _dh_core_client_new_message ("DELETE", path);
+        g_task_set_task_data (task, msg, g_object_unref);
+
+        _dh_core_client_send_and_read_async (msg,
+                                             cancellable,
+                                             remove_docset_cb,
+                                             task);
+
+        g_free (path);
+}
+
+/**
+ * dh_core_remove_docset_finish:
+ * @result: a #GAsyncResult.
+ * @error: a location for a #GError, or %NULL.
+ *
+ * Finishes an operation started with dh_core_remove_docset_async().
+ *
+ * Returns: whether the docset has been removed.
+ * Since: 3.32
+ */
+gboolean
+dh_core_remove_docset_finish (GAsyncResult  *result,
+                              GError       **error)
+{
+        g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+        return g_task_propagate_boolean (G_TASK (result), error);
+}
@@ -0,0 +1,104 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * DhCoreRepo:
+ * @DH_CORE_REPO_KAPELI: the docsets maintained by Kapeli.
+ * @DH_CORE_REPO_KAPELI_CONTRIB: the docsets contributed by the users of Dash.
+ *
+ * The repositories of docsets known by zealcore.
+ *
+ * Since: 3.32
+ */
+typedef enum {
+        DH_CORE_REPO_KAPELI,
+        DH_CORE_REPO_KAPELI_CONTRIB
+} DhCoreRepo;
+
+/**
+ * DhCoreDocsetFunc:
+ * @docset_id: the ID of the docset in its repository.
+ * @title: the title of the docset.
+ * @user_data: the user data.
+ *
+ * Called for each docset of a repository, see dh_core_list_docsets_async().
+ *
+ * Since: 3.32
+ */
+typedef void (* DhCoreDocsetFunc) (const gchar *docset_id,
+                                   const gchar *title,
+                                   gpointer     user_data);
+
+/**
+ * DhCoreProgressFunc:
+ * @repo: the repository of the docset.
+ * @title: the title of the docset.
+ * @received: the number of bytes received so far.
+ * @total: the size of the docset, in bytes.
+ * @user_data: the user data.
+ *
+ * Called as the docsets are downloaded, see dh_core_download_docset_async().
+ *
+ * Since: 3.32
+ */
+typedef void (* DhCoreProgressFunc) (DhCoreRepo   repo,
+                                     const gchar *title,
+                                     gint64       received,
+                                     gint64       total,
+                                     gpointer     user_data);
+
+void            dh_core_start                   (void);
+
+void            dh_core_stop                    (void);
+
+void            dh_core_list_docsets_async      (DhCoreRepo           repo,
+                                                 GCancellable        *cancellable,
+                                                 DhCoreDocsetFunc     docset_func,
+                                                 gpointer             docset_data,
+                                                 GAsyncReadyCallback  callback,
+                                                 gpointer             user_data);
+
+gboolean        dh_core_list_docsets_finish     (GAsyncResult        *result,
+                                                 GError             **error);
+
+void            dh_core_download_docset_async   (DhCoreRepo           repo,
+                                                 const gchar         *docset_id,
+                                                 GCancellable        *cancellable,
+                                                 DhCoreProgressFunc   progress_func,
+                                                 gpointer             progress_data,
+                                                 GAsyncReadyCallback  callback,
+                                                 gpointer             user_data);
+
+gboolean        dh_core_download_docset_finish  (GAsyncResult        *result,
+                                                 GError             **error);
+
+void            dh_core_remove_docset_async     (const gchar         *docset_id,
+                                                 GCancellable        *cancellable,
+                                                 GAsyncReadyCallback  callback,
+                                                 gpointer             user_data);
+
+gboolean        dh_core_remove_docset_finish    (GAsyncResult        *result,
+                                                 GError             **error);
+
+G_END_DECLS
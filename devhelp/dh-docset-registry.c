@@ -0,0 +1,96 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-docset-registry.h"
+
+struct _DhDocsetRegistry {
+        DhBookList *book_list;
+
+        /* Docset ID -> owned DhLink* of type DH_LINK_TYPE_BOOK. Created on the
+         * first hit of the docset, and kept for the lifetime of the registry,
+         * the hits already shown still reference it anyway.
+         */
+        GHashTable *book_links;
+};
+
+DhDocsetRegistry *
+_dh_docset_registry_new (DhBookList *book_list)
+{
+        DhDocsetRegistry *registry;
+
+        g_return_val_if_fail (DH_IS_BOOK_LIST (book_list), NULL);
+
+        registry = g_new0 (DhDocsetRegistry, 1);
+        registry->book_list = g_object_ref (book_list);
+        registry->book_links = g_hash_table_new_full (g_str_hash,
+                                                      g_str_equal,
+                                                      g_free,
+                                                      (GDestroyNotify) dh_link_unref);
+
+        return registry;
+}
+
+void
+_dh_docset_registry_free (DhDocsetRegistry *registry)
+{
+        if (registry == NULL)
+                return;
+
+        g_object_unref (registry->book_list);
+        g_hash_table_unref (registry->book_links);
+        g_free (registry);
+}
+
+/* Returns: (transfer none): the book link of @docset_id. @docset_name is used
+ * only when it is created.
+ */
+DhLink *
+_dh_docset_registry_get_book_link (DhDocsetRegistry *registry,
+                                   const gchar      *docset_id,
+                                   const gchar      *docset_name)
+{
+        DhLink *book_link;
+
+        g_return_val_if_fail (registry != NULL, NULL);
+        g_return_val_if_fail (docset_id != NULL, NULL);
+
+        book_link = g_hash_table_lookup (registry->book_links, docset_id);
+        if (book_link != NULL)
+                return book_link;
+
+        book_link = dh_link_new_book ("",
+                                      docset_id,
+                                      docset_name != NULL ? docset_name : docset_id,
+                                      "");
+        g_hash_table_insert (registry->book_links, g_strdup (docset_id), book_link);
+
+        return book_link;
+}
+
+/* Returns: (transfer none) (nullable): the #DhBook of @docset_id in the book
+ * list, or %NULL.
+ */
+DhBook *
+_dh_docset_registry_lookup_book (DhDocsetRegistry *registry,
+                                 const gchar      *docset_id)
+{
+        g_return_val_if_fail (registry != NULL, NULL);
+        g_return_val_if_fail (docset_id != NULL, NULL);
+
+        return dh_book_list_find_by_id (registry->book_list, docset_id);
+}
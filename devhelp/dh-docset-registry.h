@@ -0,0 +1,53 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include "dh-book-list.h"
+#include "dh-link.h"
+#include "dh-profile.h"
+
+G_BEGIN_DECLS
+
+/* DhDocsetRegistry maps the docset IDs of a profile to one canonical book
+ * DhLink, shared by all the search hits of the docset, and to the DhBook of
+ * the book list, if any.
+ */
+typedef struct _DhDocsetRegistry DhDocsetRegistry;
+
+G_GNUC_INTERNAL
+DhDocsetRegistry *      _dh_docset_registry_new                 (DhBookList       *book_list);
+
+G_GNUC_INTERNAL
+void                    _dh_docset_registry_free                (DhDocsetRegistry *registry);
+
+G_GNUC_INTERNAL
+DhLink *                _dh_docset_registry_get_book_link       (DhDocsetRegistry *registry,
+                                                                 const gchar      *docset_id,
+                                                                 const gchar      *docset_name);
+
+G_GNUC_INTERNAL
+DhBook *                _dh_docset_registry_lookup_book         (DhDocsetRegistry *registry,
+                                                                 const gchar      *docset_id);
+
+/* Implemented in dh-profile.c. */
+G_GNUC_INTERNAL
+DhDocsetRegistry *      _dh_profile_get_docset_registry         (DhProfile        *profile);
+
+G_END_DECLS
@@ -55,8 +55,11 @@ public class DhGroupDialog : Dialog {
 
     [GtkCallback]
     private void save_clicked () {
-        Soup.Session session = new Soup.Session();
-        Soup.Message msg = new Soup.Message("POST", "http://localhost:12340/group");
+        this.save.begin();
+    }
+
+    private async void save () {
+        Soup.Message msg = _dh_core_client_new_message("POST", "group");
         Json.Object object = new Json.Object();
         object.set_string_member("Icon", this.get_current_icon());
         object.set_string_member("Name", this.get_current_text());
@@ -67,17 +70,23 @@ public class DhGroupDialog : Dialog {
             Soup.MemoryUse.COPY,
             (uint8[])Json.to_string(node, false).to_utf8()
         );
-        GLib.InputStream result = session.send(msg, null);
-        GLib.DataInputStream result_data = new GLib.DataInputStream(result);
-        group_id = result_data.read_line();
+        try {
+            GLib.Bytes result = yield _dh_core_client_send_and_read_async(msg, null);
+            GLib.DataInputStream result_data = new GLib.DataInputStream(new GLib.MemoryInputStream.from_bytes(result));
+            group_id = result_data.read_line();
 
-        msg = new Soup.Message("POST", "http://localhost:12340/group/" + group_id + "/doc");
-        msg.set_request(
-            "text/plain",
-            Soup.MemoryUse.COPY,
-            (uint8[])this.docset_id.to_utf8()
-        );
-        session.send(msg);
+            msg = _dh_core_client_new_message("POST", "group/" + group_id + "/doc");
+            msg.set_request(
+                "text/plain",
+                Soup.MemoryUse.COPY,
+                (uint8[])this.docset_id.to_utf8()
+            );
+            yield _dh_core_client_send_and_read_async(msg, null);
+        } catch (GLib.Error e) {
+            warning("Failed to create the group: %s", e.message);
+            this.response(ResponseType.CANCEL);
+            return;
+        }
 
         this.response(ResponseType.OK);
     }
@@ -0,0 +1,172 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-icon-cache.h"
+#include <gdk/gdk.h>
+#include "dh-util-lib.h"
+
+/* Process-wide cache of the docset icons, rasterized as cairo surfaces.
+ *
+ * The DhBook's are re-created each time the catalog is reloaded, but their
+ * icons almost never change. An entry is kept per docset ID, together with a
+ * checksum of the base64 data it was decoded from, so that a changed icon
+ * replaces the old surfaces instead of accumulating. Each entry holds one
+ * surface per scale factor, decoded the first time it is asked for.
+ */
+
+#define ICON_SIZE 16
+
+typedef struct {
+        gchar *checksum;
+
+        /* Scale factor (as GINT_TO_POINTER()) -> owned cairo_surface_t*, or
+         * NULL if the icon couldn't be decoded.
+         */
+        GHashTable *surfaces;
+} IconCacheEntry;
+
+/* Docset ID -> owned IconCacheEntry*. */
+static GHashTable *icon_cache = NULL;
+
+static void
+surface_destroy (cairo_surface_t *surface)
+{
+        if (surface != NULL)
+                cairo_surface_destroy (surface);
+}
+
+static IconCacheEntry *
+icon_cache_entry_new (gchar *checksum)
+{
+        IconCacheEntry *entry;
+
+        entry = g_new0 (IconCacheEntry, 1);
+        entry->checksum = checksum;
+        entry->surfaces = g_hash_table_new_full (NULL, NULL,
+                                                 NULL,
+                                                 (GDestroyNotify) surface_destroy);
+
+        return entry;
+}
+
+static void
+icon_cache_entry_free (IconCacheEntry *entry)
+{
+        if (entry == NULL)
+                return;
+
+        g_free (entry->checksum);
+        g_hash_table_unref (entry->surfaces);
+        g_free (entry);
+}
+
+static cairo_surface_t *
+rasterize_icon (const gchar *icon_b64,
+                gint         scale)
+{
+        GInputStream *istream;
+        GdkPixbuf *pixbuf;
+        cairo_surface_t *surface;
+        guchar *data;
+        gsize len;
+        GError *error = NULL;
+
+        data = g_base64_decode (icon_b64, &len);
+        istream = g_memory_input_stream_new_from_data (data, len, g_free);
+        pixbuf = gdk_pixbuf_new_from_stream_at_scale (istream,
+                                                      ICON_SIZE * scale,
+                                                      ICON_SIZE * scale,
+                                                      TRUE,
+                                                      NULL,
+                                                      &error);
+        g_object_unref (istream);
+
+        if (pixbuf == NULL) {
+                g_warning ("Failed to decode a docset icon: %s", error->message);
+                g_clear_error (&error);
+                return NULL;
+        }
+
+        surface = gdk_cairo_surface_create_from_pixbuf (pixbuf,
+                                                        _dh_util_surface_scale (scale),
+                                                        NULL);
+        g_object_unref (pixbuf);
+
+        return surface;
+}
+
+/*
+ * _dh_icon_cache_get_surface:
+ * @docset_id: the docset ID.
+ * @icon_b64: the base64 encoded icon of the docset, at @scale.
+ * @scale: the scale factor.
+ *
+ * Must be called from the main thread.
+ *
+ * Returns: (transfer none) (nullable): the icon as a cairo surface, owned by
+ * the cache, or %NULL if it couldn't be decoded.
+ */
+cairo_surface_t *
+_dh_icon_cache_get_surface (const gchar *docset_id,
+                            const gchar *icon_b64,
+                            gint         scale)
+{
+        IconCacheEntry *entry;
+        gchar *checksum;
+        gpointer surface;
+
+        g_return_val_if_fail (docset_id != NULL, NULL);
+
+        if (icon_b64 == NULL || icon_b64[0] == '\0')
+                return NULL;
+
+        if (icon_cache == NULL) {
+                icon_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                    g_free,
+                                                    (GDestroyNotify) icon_cache_entry_free);
+        }
+
+        checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, icon_b64, -1);
+
+        entry = g_hash_table_lookup (icon_cache, docset_id);
+        if (entry == NULL || !g_str_equal (entry->checksum, checksum)) {
+                entry = icon_cache_entry_new (checksum);
+                g_hash_table_replace (icon_cache, g_strdup (docset_id), entry);
+        } else {
+                g_free (checksum);
+        }
+
+        if (!g_hash_table_lookup_extended (entry->surfaces,
+                                           GINT_TO_POINTER (scale),
+                                           NULL,
+                                           &surface)) {
+                surface = rasterize_icon (icon_b64, scale);
+                g_hash_table_insert (entry->surfaces, GINT_TO_POINTER (scale), surface);
+        }
+
+        return surface;
+}
+
+/* Frees the cached surfaces. The surfaces still referenced elsewhere stay
+ * alive until they are released.
+ */
+void
+_dh_icon_cache_clear (void)
+{
+        g_clear_pointer (&icon_cache, g_hash_table_unref);
+}
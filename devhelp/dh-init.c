@@ -23,6 +23,8 @@
 #include "dh-init.h"
 #include <glib/gi18n-lib.h>
 #include "dh-book-list.h"
+#include "dh-core-client.h"
+#include "dh-icon-cache.h"
 #include "dh-profile.h"
 #include "dh-settings.h"
 
@@ -85,6 +87,8 @@ dh_finalize (void)
                 _dh_book_list_unref_default ();
                 _dh_profile_unref_default ();
                 _dh_settings_unref_default ();
+                _dh_icon_cache_clear ();
+                _dh_core_client_shutdown ();
                 done = TRUE;
         }
 }
@@ -0,0 +1,450 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-json-array-reader.h"
+
+/* Reads a JSON array from a #GInputStream element by element, for the
+ * zealcore responses, which are all top-level arrays. The stream is read by
+ * chunks, and each element is parsed on its own as soon as all its bytes have
+ * arrived, so the whole response is never held in memory, neither as text nor
+ * as a JSON tree: only the chunk being read and the current element are.
+ *
+ * The boundaries of the elements are found by a small scanner that only
+ * tracks the nesting depth and the strings, the elements themselves are
+ * parsed by json-glib.
+ */
+
+#define CHUNK_SIZE (64 * 1024)
+
+typedef enum {
+        STATE_BEFORE_ARRAY,
+        STATE_BEFORE_FIRST_ELEMENT,
+        STATE_BEFORE_ELEMENT,
+        STATE_IN_ELEMENT,
+        STATE_AFTER_ELEMENT,
+        STATE_DONE
+} ReaderState;
+
+struct _DhJsonArrayReader {
+        GInputStream *stream;
+
+        DhJsonArrayReaderDataFunc data_func;
+        gpointer data_func_user_data;
+
+        /* The bytes not consumed yet: the beginning of the current element,
+         * followed by the rest of the last chunk.
+         */
+        GByteArray *buffer;
+        gsize scan_pos;
+        gsize element_start;
+
+        ReaderState state;
+        guint depth;
+        guint in_string : 1;
+        guint escaped : 1;
+
+        /* Owned JsonNode*, the elements parsed but not returned yet. */
+        GQueue elements;
+
+        JsonParser *parser;
+};
+
+DhJsonArrayReader *
+_dh_json_array_reader_new (GInputStream *stream)
+{
+        DhJsonArrayReader *reader;
+
+        g_return_val_if_fail (G_IS_INPUT_STREAM (stream), NULL);
+
+        reader = g_new0 (DhJsonArrayReader, 1);
+        reader->stream = g_object_ref (stream);
+        reader->buffer = g_byte_array_new ();
+        reader->state = STATE_BEFORE_ARRAY;
+        g_queue_init (&reader->elements);
+        reader->parser = json_parser_new ();
+
+        return reader;
+}
+
+void
+_dh_json_array_reader_free (DhJsonArrayReader *reader)
+{
+        JsonNode *element;
+
+        if (reader == NULL)
+                return;
+
+        while ((element = g_queue_pop_head (&reader->elements)) != NULL)
+                json_node_free (element);
+
+        g_object_unref (reader->stream);
+        g_byte_array_unref (reader->buffer);
+        g_object_unref (reader->parser);
+        g_free (reader);
+}
+
+/* @func is called for each chunk read from the stream, for example to save the
+ * response as it arrives.
+ */
+void
+_dh_json_array_reader_set_data_func (DhJsonArrayReader         *reader,
+                                     DhJsonArrayReaderDataFunc  func,
+                                     gpointer                   user_data)
+{
+        g_return_if_fail (reader != NULL);
+
+        reader->data_func = func;
+        reader->data_func_user_data = user_data;
+}
+
+static void
+set_invalid_data_error (GError      **error,
+                        const gchar  *message)
+{
+        g_set_error_literal (error,
+                             JSON_PARSER_ERROR,
+                             JSON_PARSER_ERROR_INVALID_DATA,
+                             message);
+}
+
+static gboolean
+parse_element (DhJsonArrayReader  *reader,
+               gsize               element_end,
+               GError            **error)
+{
+        JsonNode *root;
+
+        if (!json_parser_load_from_data (reader->parser,
+                                         (const gchar *) reader->buffer->data + reader->element_start,
+                                         element_end - reader->element_start,
+                                         error)) {
+                return FALSE;
+        }
+
+        root = json_parser_get_root (reader->parser);
+        if (root == NULL) {
+                set_invalid_data_error (error, "Empty element in a JSON array");
+                return FALSE;
+        }
+
+        /* The root is owned by the parser, which is reused. */
+        g_queue_push_tail (&reader->elements, json_node_copy (root));
+        return TRUE;
+}
+
+/* Scans the new bytes of the buffer, parsing the elements that are complete. */
+static gboolean
+scan (DhJsonArrayReader  *reader,
+      GError            **error)
+{
+        const gchar *data = (const gchar *) reader->buffer->data;
+        gsize pos;
+        gsize consumed;
+
+        for (pos = reader->scan_pos; pos < reader->buffer->len; pos++) {
+                gchar c = data[pos];
+
+                switch (reader->state) {
+                case STATE_BEFORE_ARRAY:
+                        if (g_ascii_isspace (c))
+                                break;
+
+                        if (c != '[') {
+                                set_invalid_data_error (error, "Expected a JSON array");
+                                return FALSE;
+                        }
+
+                        reader->state = STATE_BEFORE_FIRST_ELEMENT;
+                        break;
+
+                case STATE_BEFORE_FIRST_ELEMENT:
+                case STATE_BEFORE_ELEMENT:
+                        if (g_ascii_isspace (c))
+                                break;
+
+                        if (c == ']') {
+                                /* Only an empty array, not a trailing comma. */
+                                if (reader->state == STATE_BEFORE_ELEMENT) {
+                                        set_invalid_data_error (error, "Unexpected “]” after “,” in a JSON array");
+                                        return FALSE;
+                                }
+
+                                reader->state = STATE_DONE;
+                                break;
+                        }
+
+                        reader->state = STATE_IN_ELEMENT;
+                        reader->element_start = pos;
+                        reader->depth = 0;
+
+                        /* Scan @c again as part of the element. */
+                        pos--;
+                        break;
+
+                case STATE_IN_ELEMENT:
+                        if (reader->in_string) {
+                                if (reader->escaped)
+                                        reader->escaped = FALSE;
+                                else if (c == '\\')
+                                        reader->escaped = TRUE;
+                                else if (c == '"')
+                                        reader->in_string = FALSE;
+                                break;
+                        }
+
+                        if (c == '"') {
+                                reader->in_string = TRUE;
+                        } else if (c == '[' || c == '{') {
+                                reader->depth++;
+                        } else if ((c == ']' || c == '}') && reader->depth > 0) {
+                                reader->depth--;
+
+                                if (reader->depth == 0) {
+                                        if (!parse_element (reader, pos + 1, error))
+                                                return FALSE;
+                                        reader->state = STATE_AFTER_ELEMENT;
+                                }
+                        } else if ((c == ',' || c == ']') && reader->depth == 0) {
+                                /* The end of a scalar element. */
+                                if (!parse_element (reader, pos, error))
+                                        return FALSE;
+                                reader->state = c == ',' ? STATE_BEFORE_ELEMENT : STATE_DONE;
+                        }
+                        break;
+
+                case STATE_AFTER_ELEMENT:
+                        if (g_ascii_isspace (c))
+                                break;
+
+                        if (c == ',') {
+                                reader->state = STATE_BEFORE_ELEMENT;
+                        } else if (c == ']') {
+                                reader->state = STATE_DONE;
+                        } else {
+                                set_invalid_data_error (error, "Expected “,” or “]” in a JSON array");
+                                return FALSE;
+                        }
+                        break;
+
+                case STATE_DONE:
+                        /* Trailing data is ignored. */
+                        pos = reader->buffer->len - 1;
+                        break;
+
+                default:
+                        g_assert_not_reached ();
+                }
+        }
+
+        /* Drop what has been consumed. */
+        consumed = reader->state == STATE_IN_ELEMENT ? reader->element_start : pos;
+        g_byte_array_remove_range (reader->buffer, 0, consumed);
+        reader->scan_pos = pos - consumed;
+        reader->element_start = 0;
+
+        return TRUE;
+}
+
+/* Feeds a chunk read from the stream, an empty one meaning the end of the
+ * stream.
+ */
+static gboolean
+feed (DhJsonArrayReader  *reader,
+      const gchar        *data,
+      gsize               length,
+      GError            **error)
+{
+        if (length == 0) {
+                if (reader->state != STATE_DONE) {
+                        set_invalid_data_error (error, "Unexpected end of a JSON array");
+                        return FALSE;
+                }
+
+                return TRUE;
+        }
+
+        if (reader->data_func != NULL)
+                reader->data_func (data, length, reader->data_func_user_data);
+
+        g_byte_array_append (reader->buffer, (const guint8 *) data, length);
+        return scan (reader, error);
+}
+
+/*
+ * _dh_json_array_reader_next:
+ * @reader: a #DhJsonArrayReader.
+ * @cancellable: (nullable): a #GCancellable.
+ * @error: location to a %NULL #GError, or %NULL.
+ *
+ * Reads the stream until the next element of the array is complete. It
+ * blocks, so it is meant for worker threads.
+ *
+ * Returns: (transfer full) (nullable): the next element, or %NULL at the end of
+ * the array or on error.
+ */
+JsonNode *
+_dh_json_array_reader_next (DhJsonArrayReader  *reader,
+                            GCancellable       *cancellable,
+                            GError            **error)
+{
+        gchar *chunk = NULL;
+
+        g_return_val_if_fail (reader != NULL, NULL);
+        g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+        while (g_queue_is_empty (&reader->elements) &&
+               reader->state != STATE_DONE) {
+                gssize n_read;
+
+                if (chunk == NULL)
+                        chunk = g_malloc (CHUNK_SIZE);
+
+                n_read = g_input_stream_read (reader->stream,
+                                              chunk,
+                                              CHUNK_SIZE,
+                                              cancellable,
+                                              error);
+
+                if (n_read < 0 || !feed (reader, chunk, n_read, error)) {
+                        g_free (chunk);
+                        return NULL;
+                }
+        }
+
+        g_free (chunk);
+        return g_queue_pop_head (&reader->elements);
+}
+
+static GPtrArray *
+take_batch (DhJsonArrayReader *reader)
+{
+        GPtrArray *batch;
+        JsonNode *element;
+
+        batch = g_ptr_array_new_full (reader->elements.length,
+                                      (GDestroyNotify) json_node_free);
+
+        while ((element = g_queue_pop_head (&reader->elements)) != NULL)
+                g_ptr_array_add (batch, element);
+
+        return batch;
+}
+
+static void
+read_chunk_cb (GObject      *source_object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+        GTask *task = G_TASK (user_data);
+        DhJsonArrayReader *reader = g_task_get_task_data (task);
+        GBytes *bytes;
+        gconstpointer data;
+        gsize length;
+        GError *error = NULL;
+
+        bytes = g_input_stream_read_bytes_finish (G_INPUT_STREAM (source_object), result, &error);
+        if (bytes == NULL) {
+                g_task_return_error (task, error);
+                g_object_unref (task);
+                return;
+        }
+
+        data = g_bytes_get_data (bytes, &length);
+        if (!feed (reader, data, length, &error)) {
+                g_task_return_error (task, error);
+                g_object_unref (task);
+                g_bytes_unref (bytes);
+                return;
+        }
+
+        g_bytes_unref (bytes);
+
+        if (!g_queue_is_empty (&reader->elements) || reader->state == STATE_DONE) {
+                g_task_return_pointer (task, take_batch (reader), (GDestroyNotify) g_ptr_array_unref);
+                g_object_unref (task);
+                return;
+        }
+
+        g_input_stream_read_bytes_async (reader->stream,
+                                         CHUNK_SIZE,
+                                         G_PRIORITY_DEFAULT,
+                                         g_task_get_cancellable (task),
+                                         read_chunk_cb,
+                                         task);
+}
+
+/*
+ * _dh_json_array_reader_next_batch_async:
+ * @reader: a #DhJsonArrayReader.
+ * @cancellable: (nullable): a #GCancellable.
+ * @callback: the callback to call when the batch is ready.
+ * @user_data: the data to pass to @callback.
+ *
+ * Reads the stream asynchronously until at least one element of the array is
+ * complete, or the end of the array is reached. All the elements complete at
+ * that point form the batch, so that a model can be populated as the data
+ * arrives, one chunk at a time.
+ */
+void
+_dh_json_array_reader_next_batch_async (DhJsonArrayReader   *reader,
+                                        GCancellable        *cancellable,
+                                        GAsyncReadyCallback  callback,
+                                        gpointer             user_data)
+{
+        GTask *task;
+
+        g_return_if_fail (reader != NULL);
+
+        /* @reader is owned by the caller and must outlive the operation. */
+        task = g_task_new (NULL, cancellable, callback, user_data);
+        g_task_set_source_tag (task, _dh_json_array_reader_next_batch_async);
+        g_task_set_task_data (task, reader, NULL);
+
+        if (!g_queue_is_empty (&reader->elements) || reader->state == STATE_DONE) {
+                g_task_return_pointer (task, take_batch (reader), (GDestroyNotify) g_ptr_array_unref);
+                g_object_unref (task);
+                return;
+        }
+
+        g_input_stream_read_bytes_async (reader->stream,
+                                         CHUNK_SIZE,
+                                         G_PRIORITY_DEFAULT,
+                                         cancellable,
+                                         read_chunk_cb,
+                                         task);
+}
+
+/*
+ * _dh_json_array_reader_next_batch_finish:
+ * @reader: a #DhJsonArrayReader.
+ * @result: a #GAsyncResult.
+ * @error: location to a %NULL #GError, or %NULL.
+ *
+ * Returns: (transfer full) (element-type JsonNode) (nullable): the elements
+ * of the batch, an empty array at the end of the array, or %NULL on error.
+ */
+GPtrArray *
+_dh_json_array_reader_next_batch_finish (DhJsonArrayReader  *reader,
+                                         GAsyncResult       *result,
+                                         GError            **error)
+{
+        g_return_val_if_fail (reader != NULL, NULL);
+        g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+
+        return g_task_propagate_pointer (G_TASK (result), error);
+}
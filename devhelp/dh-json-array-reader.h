@@ -0,0 +1,60 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <json-glib/json-glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _DhJsonArrayReader DhJsonArrayReader;
+
+/* Called with the raw data, as read from the stream. */
+typedef void (* DhJsonArrayReaderDataFunc) (const gchar *data,
+                                            gsize        length,
+                                            gpointer     user_data);
+
+G_GNUC_INTERNAL
+DhJsonArrayReader *     _dh_json_array_reader_new               (GInputStream              *stream);
+
+G_GNUC_INTERNAL
+void                    _dh_json_array_reader_free              (DhJsonArrayReader         *reader);
+
+G_GNUC_INTERNAL
+void                    _dh_json_array_reader_set_data_func     (DhJsonArrayReader         *reader,
+                                                                 DhJsonArrayReaderDataFunc  func,
+                                                                 gpointer                   user_data);
+
+G_GNUC_INTERNAL
+JsonNode *              _dh_json_array_reader_next              (DhJsonArrayReader         *reader,
+                                                                 GCancellable              *cancellable,
+                                                                 GError                   **error);
+
+G_GNUC_INTERNAL
+void                    _dh_json_array_reader_next_batch_async  (DhJsonArrayReader         *reader,
+                                                                 GCancellable              *cancellable,
+                                                                 GAsyncReadyCallback        callback,
+                                                                 gpointer                   user_data);
+
+G_GNUC_INTERNAL
+GPtrArray *             _dh_json_array_reader_next_batch_finish (DhJsonArrayReader         *reader,
+                                                                 GAsyncResult              *result,
+                                                                 GError                   **error);
+
+G_END_DECLS
@@ -0,0 +1,168 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-keyword-matcher.h"
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* The substring search compares 16 candidate positions at once with SSE2,
+ * which is always available on x86-64: the first and the last byte of the
+ * keyword are compared with two blocks of the string, and only the positions
+ * where both are equal are compared entirely. Elsewhere, and for the last
+ * positions, it is a scalar loop.
+ *
+ * The comparison is byte by byte. To ignore the case, DhSearchContext matches
+ * a lowercase keyword with the folded name of the DhLink, computed when the
+ * link is created.
+ */
+
+#define BLOCK_SIZE 16
+
+struct _DhKeywordMatcher {
+        gchar *keyword;
+        gsize length;
+};
+
+DhKeywordMatcher *
+_dh_keyword_matcher_new (const gchar *keyword)
+{
+        DhKeywordMatcher *matcher;
+
+        g_return_val_if_fail (keyword != NULL, NULL);
+
+        matcher = g_new0 (DhKeywordMatcher, 1);
+        matcher->keyword = g_strdup (keyword);
+        matcher->length = strlen (keyword);
+
+        return matcher;
+}
+
+void
+_dh_keyword_matcher_free (DhKeywordMatcher *matcher)
+{
+        if (matcher == NULL)
+                return;
+
+        g_free (matcher->keyword);
+        g_free (matcher);
+}
+
+static inline gboolean
+equal_at (DhKeywordMatcher *matcher,
+          const gchar      *str)
+{
+        return memcmp (str, matcher->keyword, matcher->length) == 0;
+}
+
+/**
+ * _dh_keyword_matcher_match_prefix:
+ * @matcher: a #DhKeywordMatcher.
+ * @str: a string.
+ * @length: the length of @str, in bytes.
+ *
+ * Returns: whether @str starts with the keyword.
+ */
+gboolean
+_dh_keyword_matcher_match_prefix (DhKeywordMatcher *matcher,
+                                  const gchar      *str,
+                                  gsize             length)
+{
+        g_return_val_if_fail (matcher != NULL, FALSE);
+        g_return_val_if_fail (str != NULL, FALSE);
+
+        return length >= matcher->length && equal_at (matcher, str);
+}
+
+/**
+ * _dh_keyword_matcher_find:
+ * @matcher: a #DhKeywordMatcher.
+ * @str: a string.
+ * @length: the length of @str, in bytes.
+ *
+ * Returns: (nullable): the first occurrence of the keyword in @str, or %NULL.
+ */
+const gchar *
+_dh_keyword_matcher_find (DhKeywordMatcher *matcher,
+                          const gchar      *str,
+                          gsize             length)
+{
+        gsize n_starts;
+        gsize i = 0;
+        gchar first;
+
+        g_return_val_if_fail (matcher != NULL, NULL);
+        g_return_val_if_fail (str != NULL, NULL);
+
+        if (matcher->length == 0)
+                return str;
+
+        first = matcher->keyword[0];
+
+        if (length < matcher->length)
+                return NULL;
+
+        /* The number of positions where the keyword can start. */
+        n_starts = length - matcher->length + 1;
+
+#ifdef __SSE2__
+        {
+                const __m128i first_bytes = _mm_set1_epi8 (first);
+                const __m128i last_bytes = _mm_set1_epi8 (matcher->keyword[matcher->length - 1]);
+
+                /* The blocks are read entirely within @str. */
+                for (; n_starts - i >= BLOCK_SIZE; i += BLOCK_SIZE) {
+                        const gchar *p = str + i;
+                        __m128i first_block;
+                        __m128i last_block;
+                        __m128i first_equal;
+                        __m128i last_equal;
+                        guint mask;
+
+                        first_block = _mm_loadu_si128 ((const __m128i *) p);
+                        last_block = _mm_loadu_si128 ((const __m128i *) (p + matcher->length - 1));
+
+                        first_equal = _mm_cmpeq_epi8 (first_block, first_bytes);
+                        last_equal = _mm_cmpeq_epi8 (last_block, last_bytes);
+
+                        mask = _mm_movemask_epi8 (_mm_and_si128 (first_equal, last_equal));
+
+                        while (mask != 0) {
+                                gint bit = g_bit_nth_lsf (mask, -1);
+
+                                if (equal_at (matcher, p + bit))
+                                        return p + bit;
+
+                                mask &= mask - 1;
+                        }
+                }
+        }
+#endif
+
+        for (; i < n_starts; i++) {
+                const gchar *p = str + i;
+
+                if (*p == first && equal_at (matcher, p)) {
+                        return p;
+                }
+        }
+
+        return NULL;
+}
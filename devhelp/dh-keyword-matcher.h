@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* DhKeywordMatcher finds a keyword in strings, without allocating anything per
+ * string. It is meant to be created once per search and used on every DhLink.
+ */
+typedef struct _DhKeywordMatcher DhKeywordMatcher;
+
+G_GNUC_INTERNAL
+DhKeywordMatcher *      _dh_keyword_matcher_new                 (const gchar      *keyword);
+
+G_GNUC_INTERNAL
+void                    _dh_keyword_matcher_free                (DhKeywordMatcher *matcher);
+
+G_GNUC_INTERNAL
+gboolean                _dh_keyword_matcher_match_prefix        (DhKeywordMatcher *matcher,
+                                                                 const gchar      *str,
+                                                                 gsize             length);
+
+G_GNUC_INTERNAL
+const gchar *           _dh_keyword_matcher_find                (DhKeywordMatcher *matcher,
+                                                                 const gchar      *str,
+                                                                 gsize             length);
+
+G_END_DECLS
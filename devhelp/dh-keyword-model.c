@@ -29,8 +29,13 @@
 #include <glib/gi18n.h>
 #include "dh-book.h"
 #include "dh-book-list.h"
+#include "dh-core-client.h"
+#include "dh-core-endpoint.h"
+#include "dh-docset-registry.h"
 #include "dh-keyword-model.h"
 #include "dh-search-context.h"
+#include "dh-search-frame.h"
+#include "dh-symbol-index.h"
 #include "dh-util-lib.h"
 
 /**
@@ -80,19 +85,101 @@
  */
 
 
+/* A row of the model. */
+typedef struct {
+        DhLink *link;
+
+        /* The #DhBook of @link in the profile, or NULL. */
+        DhBook *book;
+} Row;
+
 typedef struct {
         gchar *current_book_id;
 
-        /* List of owned DhLink*.
+        /* The profile of the last dh_keyword_model_filter() call. Its docset
+         * registry provides the book links of the hits.
+         */
+        DhProfile *profile;
+
+        /* List of owned Row*.
          *
          * Note: GQueue, not GQueue* so we are sure that it always exists, we
-         * don't need to check if priv->links == NULL.
+         * don't need to check if priv->rows == NULL.
          */
-        GQueue links;
+        GQueue rows;
 
         gint stamp;
         GtkTreeModel *filter_store;
         GString *group_id;
+
+        /* The docsets of the group, or NULL for all the docsets. */
+        GStrv group_docset_ids;
+
+        /* Long-lived search channel to zealcore, shared by all the queries.
+         * It is re-opened lazily when zealcore closes it (e.g. on restart) or
+         * when the group changes.
+         */
+        SoupWebsocketConnection *ws;
+        gchar *ws_uri;
+        GCancellable *connect_cancellable;
+
+        /* For the binary frames of the channel: the string table, the book
+         * links by (docset ID, docset name) string indexes, and the URIs of
+         * the hits built in place after the base URI of zealcore.
+         */
+        DhSearchFrameDecoder *frame_decoder;
+        GHashTable *frame_book_links;
+        GString *hit_uri;
+        gsize hit_uri_base_length;
+
+        /* Query to send as soon as the channel is open, and its generation. */
+        gchar *pending_query;
+        guint pending_generation;
+
+        /* Joined keywords of the query whose results are currently wanted, or
+         * NULL.
+         */
+        gchar *current_keywords;
+
+        /* The search of the last dh_keyword_model_filter() call, or NULL. The
+         * hits of both the symbol index and zealcore are checked against it,
+         * see queue_hit().
+         */
+        DhSearchContext *search_context;
+
+        /* The first hit matching @search_context exactly, in @rows or
+         * @new_links, or NULL.
+         */
+        DhLink *exact_link;
+
+        /* Each dh_keyword_model_filter() call starts a new generation. Only
+         * the frames of the current generation are kept.
+         */
+        guint generation;
+
+        /* Generations of the queries sent whose end of results has not been
+         * received yet, oldest first.
+         */
+        GQueue generations_in_flight;
+
+        /* Checks that zealcore answers the queries in flight, see
+         * query_timeout_cb(). @last_activity_time is the monotonic time of the
+         * last query sent or frame received.
+         */
+        guint query_timeout_id;
+        gint64 last_activity_time;
+
+        /* The number of queries answered on the current channel. */
+        guint n_answered_queries;
+
+        /* Set once zealcore has been seen answering only the first query of a
+         * channel. A new channel is then opened for each query.
+         */
+        guint one_query_per_channel : 1;
+
+        /* Hits received but not yet inserted in the model, owned DhLink*. */
+        GQueue new_links;
+        guint flush_id;
 } DhKeywordModelPrivate;
 
 typedef struct {
@@ -105,6 +192,11 @@ typedef struct {
 
 #define MAX_HITS 1000
 
+/* Without any frame for that long while queries are in flight, zealcore is
+ * considered not to answer them, and the channel is re-opened.
+ */
+#define QUERY_TIMEOUT_MS 5000
+
 enum {
         SIGNAL_FILTER_COMPLETE,
         N_SIGNALS
@@ -119,18 +211,55 @@ G_DEFINE_TYPE_WITH_CODE (DhKeywordModel, dh_keyword_model, G_TYPE_OBJECT,
                          G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
                                                 dh_keyword_model_tree_model_init));
 
+static Row *
+row_new (DhLink *link,
+         DhBook *book)
+{
+        Row *row;
+
+        row = g_slice_new (Row);
+        row->link = link;
+        row->book = book != NULL ? g_object_ref (book) : NULL;
+
+        return row;
+}
+
+static void
+row_free (Row *row)
+{
+        dh_link_unref (row->link);
+        g_clear_object (&row->book);
+        g_slice_free (Row, row);
+}
+
 static void
-clear_links (DhKeywordModel *model)
+clear_rows (DhKeywordModel *model)
 {
         DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
-        GList *l;
 
-        for (l = priv->links.head; l != NULL; l = l->next) {
-                DhLink *cur_link = l->data;
-                dh_link_unref (cur_link);
+        g_queue_foreach (&priv->rows, (GFunc) row_free, NULL);
+        g_queue_clear (&priv->rows);
+}
+
+static void search_channel_close (DhKeywordModel *model);
+static void search_channel_lost (DhKeywordModel *model);
+
+static void
+dh_keyword_model_dispose (GObject *object)
+{
+        DhKeywordModel *model = DH_KEYWORD_MODEL (object);
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+
+        search_channel_close (model);
+
+        if (priv->flush_id != 0) {
+                g_source_remove (priv->flush_id);
+                priv->flush_id = 0;
         }
 
-        g_queue_clear (&priv->links);
+        g_clear_object (&priv->profile);
+
+        G_OBJECT_CLASS (dh_keyword_model_parent_class)->dispose (object);
 }
 
 static void
@@ -140,7 +269,18 @@ dh_keyword_model_finalize (GObject *object)
         DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
 
         g_free (priv->current_book_id);
-        clear_links (model);
+        clear_rows (model);
+        g_queue_foreach (&priv->new_links, (GFunc) dh_link_unref, NULL);
+        g_queue_clear (&priv->new_links);
+        g_queue_clear (&priv->generations_in_flight);
+
+        if (priv->group_id != NULL)
+                g_string_free (priv->group_id, TRUE);
+        g_strfreev (priv->group_docset_ids);
+
+        g_free (priv->pending_query);
+        g_free (priv->current_keywords);
+        _dh_search_context_free (priv->search_context);
 
         G_OBJECT_CLASS (dh_keyword_model_parent_class)->finalize (object);
 }
@@ -150,7 +290,16 @@ dh_keyword_model_class_init (DhKeywordModelClass *klass)
 {
         GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+        object_class->dispose = dh_keyword_model_dispose;
         object_class->finalize = dh_keyword_model_finalize;
+
+        /**
+         * DhKeywordModel::filter-complete:
+         * @model: the #DhKeywordModel emitting the signal.
+         *
+         * The ::filter-complete signal is emitted when all the results of the
+         * last dh_keyword_model_filter() call have been inserted in @model.
+         */
         signals[SIGNAL_FILTER_COMPLETE] =
                 g_signal_new ("filter-complete",
                               G_TYPE_FROM_CLASS (klass),
@@ -195,6 +344,9 @@ dh_keyword_model_get_column_type (GtkTreeModel *tree_model,
         case DH_KEYWORD_MODEL_COL_CURRENT_BOOK_FLAG:
                 return G_TYPE_BOOLEAN;
 
+        case DH_KEYWORD_MODEL_COL_BOOK_ICON:
+                return CAIRO_GOBJECT_TYPE_SURFACE;
+
         default:
                 return G_TYPE_INVALID;
         }
@@ -221,7 +373,7 @@ dh_keyword_model_get_iter (GtkTreeModel *tree_model,
                 return FALSE;
         }
 
-        node = g_queue_peek_nth_link (&priv->links, indices[0]);
+        node = g_queue_peek_nth_link (&priv->rows, indices[0]);
 
         if (node != NULL) {
                 iter->stamp = priv->stamp;
@@ -246,7 +398,7 @@ dh_keyword_model_get_path (GtkTreeModel *tree_model,
         g_return_val_if_fail (iter->stamp == priv->stamp, NULL);
 
         node = iter->user_data;
-        pos = g_queue_link_index (&priv->links, node);
+        pos = g_queue_link_index (&priv->rows, node);
 
         if (pos < 0) {
                 return NULL;
@@ -266,6 +418,7 @@ dh_keyword_model_get_value (GtkTreeModel *tree_model,
 {
         DhKeywordModelPrivate *priv;
         GList *node;
+        Row *row;
         DhLink *link;
         gboolean in_current_book;
 
@@ -274,7 +427,8 @@ dh_keyword_model_get_value (GtkTreeModel *tree_model,
         g_return_if_fail (iter->stamp == priv->stamp);
 
         node = iter->user_data;
-        link = node->data;
+        row = node->data;
+        link = row->link;
 
         switch (column) {
         case DH_KEYWORD_MODEL_COL_NAME:
@@ -293,6 +447,12 @@ dh_keyword_model_get_value (GtkTreeModel *tree_model,
                 g_value_set_boolean (value, in_current_book);
                 break;
 
+        case DH_KEYWORD_MODEL_COL_BOOK_ICON:
+                g_value_init (value, CAIRO_GOBJECT_TYPE_SURFACE);
+                if (row->book != NULL)
+                        g_value_set_boxed (value, dh_book_get_icon_surface (row->book));
+                break;
+
         default:
                 g_warning ("Bad column %d requested", column);
         }
@@ -332,9 +492,9 @@ dh_keyword_model_iter_children (GtkTreeModel *tree_model,
         /* But if parent == NULL we return the list itself as children of
          * the "root".
          */
-        if (priv->links.head != NULL) {
+        if (priv->rows.head != NULL) {
                 iter->stamp = priv->stamp;
-                iter->user_data = priv->links.head;
+                iter->user_data = priv->rows.head;
                 return TRUE;
         }
 
@@ -357,7 +517,7 @@ dh_keyword_model_iter_n_children (GtkTreeModel *tree_model,
         priv = dh_keyword_model_get_instance_private (DH_KEYWORD_MODEL (tree_model));
 
         if (iter == NULL) {
-                return priv->links.length;
+                return priv->rows.length;
         }
 
         g_return_val_if_fail (priv->stamp == iter->stamp, -1);
@@ -380,7 +540,7 @@ dh_keyword_model_iter_nth_child (GtkTreeModel *tree_model,
                 return FALSE;
         }
 
-        child = g_queue_peek_nth_link (&priv->links, n);
+        child = g_queue_peek_nth_link (&priv->rows, n);
 
         if (child != NULL) {
                 iter->stamp = priv->stamp;
@@ -467,98 +627,645 @@ search_single_book (DhBook          *book,
         return ret;
 }
 
-typedef struct {
-        SearchSettings settings;
-        DhKeywordModel *model;
-        DhKeywordModelPrivate *priv;
-} SearchContext;
+static gchar *
+get_search_uri (DhKeywordModel *model)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        gchar *path;
+        gchar *uri;
+
+        if (priv->group_id == NULL || g_str_equal ("*", priv->group_id->str))
+                return _dh_core_endpoint_get_websocket_uri ("search");
+
+        path = g_strdup_printf ("search/group/%s", priv->group_id->str);
+        uri = _dh_core_endpoint_get_websocket_uri (path);
+        g_free (path);
+
+        return uri;
+}
+
+/* Moves the hits received since the last flush to the model, emitting
+ * ::row-inserted for each of them. Their books are resolved here, once, so
+ * that rendering a row doesn't need to look for them.
+ */
+static void
+flush_new_links (DhKeywordModel *model)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        DhDocsetRegistry *registry;
+        DhLink *link;
+
+        if (priv->new_links.length == 0)
+                return;
+
+        registry = _dh_profile_get_docset_registry (priv->profile);
+
+        while ((link = g_queue_pop_head (&priv->new_links)) != NULL) {
+                GtkTreePath *path;
+                GtkTreeIter iter;
+                DhBook *book;
+
+                book = _dh_docset_registry_lookup_book (registry, dh_link_get_book_id (link));
+                g_queue_push_tail (&priv->rows, row_new (link, book));
+
+                iter.stamp = priv->stamp;
+                iter.user_data = priv->rows.tail;
+
+                path = gtk_tree_path_new_from_indices (priv->rows.length - 1, -1);
+                gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+                gtk_tree_path_free (path);
+        }
+}
+
+static gboolean
+flush_new_links_idle_cb (gpointer user_data)
+{
+        DhKeywordModel *model = DH_KEYWORD_MODEL (user_data);
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+
+        priv->flush_id = 0;
+        flush_new_links (model);
+
+        return G_SOURCE_REMOVE;
+}
+
+/* Removes all the rows, emitting ::row-deleted for each of them, and the hits
+ * not yet flushed.
+ */
+static void
+remove_all_rows (DhKeywordModel *model)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        Row *row;
+
+        if (priv->flush_id != 0) {
+                g_source_remove (priv->flush_id);
+                priv->flush_id = 0;
+        }
+
+        g_queue_foreach (&priv->new_links, (GFunc) dh_link_unref, NULL);
+        g_queue_clear (&priv->new_links);
+        priv->exact_link = NULL;
+
+        /* Remove from the end, so that the other rows don't move. */
+        while ((row = g_queue_pop_tail (&priv->rows)) != NULL) {
+                GtkTreePath *path;
+
+                row_free (row);
+
+                path = gtk_tree_path_new_from_indices (priv->rows.length, -1);
+                gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+                gtk_tree_path_free (path);
+        }
+
+        /* The content has been modified, change the stamp so that older
+         * GtkTreeIter's become invalid.
+         */
+        priv->stamp++;
+}
+
+/* Returns: (transfer none): the book link shared by all the hits of
+ * @docset_id.
+ */
+static DhLink *
+get_book_link (DhKeywordModel *model,
+               const gchar    *docset_id,
+               const gchar    *docset_name)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        DhDocsetRegistry *registry;
+
+        registry = _dh_profile_get_docset_registry (priv->profile);
+
+        return _dh_docset_registry_get_book_link (registry, docset_id, docset_name);
+}
+
+/* Whether the hits of @docset_id are wanted for the current search: the
+ * docset must be in the book list of the profile, and be the book of "book:"
+ * if the search has one.
+ */
+static gboolean
+docset_in_scope (DhKeywordModel *model,
+                 const gchar    *docset_id)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        const gchar *book_id;
+
+        if (docset_id == NULL)
+                return FALSE;
+
+        book_id = _dh_search_context_get_book_id (priv->search_context);
+        if (book_id != NULL && g_ascii_strcasecmp (book_id, docset_id) != 0)
+                return FALSE;
+
+        return dh_book_list_find_by_id (dh_profile_get_book_list (priv->profile), docset_id) != NULL;
+}
+
+/* Queues @link, a hit of the current search, to be inserted by
+ * flush_new_links(). The exact match is found with the same rule as in
+ * search_single_book(), whether the hits come from the symbol index or from
+ * zealcore.
+ */
+static void
+queue_hit (DhKeywordModel *model,
+           DhLink         *link)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+
+        g_queue_push_tail (&priv->new_links, link);
+
+        if (priv->exact_link == NULL &&
+            _dh_search_context_is_exact_link (priv->search_context, link)) {
+                priv->exact_link = link;
+        }
+}
+
+/* Offers to search @keywords on Stack Overflow, when there are no results. */
+static void
+append_stackoverflow_link (DhKeywordModel *model,
+                           const gchar    *keywords)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        DhLink *link;
+        gchar *form;
+        gchar *uri;
+
+        form = soup_form_encode ("q", keywords, NULL);
+        uri = g_strconcat ("https://stackoverflow.com/search?", form, NULL);
+        link = dh_link_new (DH_LINK_TYPE_KEYWORD,
+                            get_book_link (model, "stackoverflow", "Stack Overflow"),
+                            _("Search on Stack Overflow"),
+                            uri);
+        g_queue_push_tail (&priv->new_links, link);
+
+        g_free (form);
+        g_free (uri);
+}
+
+/* Called when the end of the results of the current generation has been
+ * reached, or when the search channel has been lost while waiting for them.
+ */
+static void
+finish_current_query (DhKeywordModel *model)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+
+        if (priv->current_keywords == NULL)
+                return;
+
+        if (priv->rows.length == 0 && priv->new_links.length == 0)
+                append_stackoverflow_link (model, priv->current_keywords);
+
+        if (priv->flush_id != 0) {
+                g_source_remove (priv->flush_id);
+                priv->flush_id = 0;
+        }
+
+        flush_new_links (model);
+
+        g_free (priv->current_keywords);
+        priv->current_keywords = NULL;
+
+        g_signal_emit (model, signals[SIGNAL_FILTER_COMPLETE], 0);
+}
+
+/* Without DH_SEARCH_FRAME_PROTOCOL, zealcore sends one JSON object per hit,
+ * and ends the results of each query with a frame that is not a JSON object.
+ * Looking at the first byte is enough to tell them apart, without parsing.
+ */
+static gboolean
+is_end_of_results (const gchar *data,
+                   gsize        len)
+{
+        gsize i;
+
+        for (i = 0; i < len; i++) {
+                if (!g_ascii_isspace (data[i]))
+                        return data[i] != '{';
+        }
+
+        return TRUE;
+}
+
+static void
+frame_hit_cb (guint        docset_id,
+              guint        docset_name,
+              const gchar *name,
+              const gchar *path,
+              gpointer     user_data)
+{
+        DhKeywordModel *model = DH_KEYWORD_MODEL (user_data);
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        gpointer key;
+        DhLink *book_link;
+        DhLink *link;
+
+        /* Cache the book links of the registry by string indexes, to not hash
+         * the docset ID of each hit.
+         */
+        key = GUINT_TO_POINTER ((docset_id << 16) | docset_name);
+        book_link = g_hash_table_lookup (priv->frame_book_links, key);
+        if (book_link == NULL) {
+                book_link = get_book_link (model,
+                                           _dh_search_frame_decoder_get_string (priv->frame_decoder, docset_id),
+                                           _dh_search_frame_decoder_get_string (priv->frame_decoder, docset_name));
+                g_hash_table_insert (priv->frame_book_links, key, dh_link_ref (book_link));
+        }
+
+        if (!docset_in_scope (model, dh_link_get_book_id (book_link)))
+                return;
+
+        /* The paths returned by zealcore are relative. */
+        if (path[0] == '/')
+                path++;
+
+        g_string_truncate (priv->hit_uri, priv->hit_uri_base_length);
+        g_string_append (priv->hit_uri, path);
+
+        link = dh_link_new (DH_LINK_TYPE_KEYWORD, book_link, name, priv->hit_uri->str);
+        queue_hit (model, link);
+}
+
+static void
+frame_skip_hit_cb (guint        docset_id,
+                   guint        docset_name,
+                   const gchar *name,
+                   const gchar *path,
+                   gpointer     user_data)
+{
+}
+
+static void
+query_answered (DhKeywordModel *model,
+                guint           generation)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+
+        g_queue_pop_head (&priv->generations_in_flight);
+        priv->n_answered_queries++;
+
+        if (generation == priv->generation)
+                finish_current_query (model);
+}
+
+static void
+handle_binary_frame (DhKeywordModel *model,
+                     GBytes         *message,
+                     guint           generation)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        gboolean wanted;
+        gboolean end_of_results;
+        GError *error = NULL;
+
+        wanted = generation == priv->generation && priv->current_keywords != NULL;
+
+        /* The frames of a superseded query are still decoded, for the strings
+         * they add to the table.
+         */
+        if (!_dh_search_frame_decoder_decode (priv->frame_decoder,
+                                              message,
+                                              &end_of_results,
+                                              wanted ? frame_hit_cb : frame_skip_hit_cb,
+                                              model,
+                                              &error)) {
+                g_warning ("%s", error->message);
+                g_error_free (error);
+                search_channel_lost (model);
+                return;
+        }
+
+        if (end_of_results) {
+                query_answered (model, generation);
+                return;
+        }
+
+        if (wanted && priv->flush_id == 0)
+                priv->flush_id = g_idle_add (flush_new_links_idle_cb, model);
+}
 
 static void
-websocket_message_cb (SoupWebsocketConnection *self,
+websocket_message_cb (SoupWebsocketConnection *ws,
                       gint                     type,
                       GBytes                  *message,
-                      gpointer                 user_data)
+                      DhKeywordModel          *model)
 {
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
         JsonParser *parser;
-        JsonNode *root;
         JsonObject *object;
-        GError *error = NULL;
-        size_t len;
-        DhLink *link;
-        SearchContext *ctx = user_data;
         DhLink *book_link;
-        gchar* msg = g_bytes_get_data(message, &len), *uri;
+        DhLink *link;
+        const gchar *data;
+        gsize len;
+        guint generation;
+        gchar *uri;
 
-        if (len < 2) {
+        if (g_queue_is_empty (&priv->generations_in_flight))
+                return;
+
+        priv->last_activity_time = g_get_monotonic_time ();
+
+        /* zealcore answers the queries in order, so the frame belongs to the
+         * oldest query in flight.
+         */
+        generation = GPOINTER_TO_UINT (g_queue_peek_head (&priv->generations_in_flight));
+
+        /* DH_SEARCH_FRAME_PROTOCOL has been negotiated. */
+        if (type == SOUP_WEBSOCKET_DATA_BINARY) {
+                handle_binary_frame (model, message, generation);
                 return;
         }
 
-        parser = json_parser_new();
-        json_parser_load_from_data(parser, msg, len, &error);
+        data = g_bytes_get_data (message, &len);
+        if (len < 2)
+                return;
 
-        if (error != NULL) {
-                const char *data = "";
-                soup_websocket_connection_close(self, 0, data);
-
-                if (g_queue_get_length(&ctx->priv->links) == 0) {
-                        book_link = dh_link_new_book ("", "stackoverflow", "Stack Overflow", "");
-
-                        uri = g_strjoin("",
-                                        "https://stackoverflow.com/search?",
-                                        soup_form_encode("q", ctx->settings.search_context->joined_keywords, NULL),
-                                        NULL);
-                        link = dh_link_new (DH_LINK_TYPE_KEYWORD,
-                                            book_link,
-                                            _("Search on Stack Overflow"),
-                                            uri);
-                        g_queue_push_tail(&ctx->priv->links, link);
-                        g_free (uri);
-                        dh_link_unref (book_link);
-                }
+        if (is_end_of_results (data, len)) {
+                query_answered (model, generation);
+                return;
+        }
 
-                g_signal_emit(ctx->model, signals[SIGNAL_FILTER_COMPLETE], 0);
+        /* Late frame of a superseded query. */
+        if (generation != priv->generation || priv->current_keywords == NULL)
+                return;
+
+        parser = json_parser_new ();
+
+        if (!json_parser_load_from_data (parser, data, len, NULL) ||
+            !JSON_NODE_HOLDS_OBJECT (json_parser_get_root (parser))) {
+                g_object_unref (parser);
                 return;
         }
 
-        root = json_parser_get_root(parser);
-        object = json_node_get_object(root);
+        object = json_node_get_object (json_parser_get_root (parser));
 
-        book_link = dh_link_new_book ("",
-                                      json_object_get_string_member(object, "DocsetId"),
-                                      json_object_get_string_member(object, "DocsetName"),
-                                      "");
-        uri = g_strjoin("/",
-                        "http://localhost:12340",
-                        json_object_get_string_member(object, "Path"),
-                        NULL);
+        if (!docset_in_scope (model, json_object_get_string_member (object, "DocsetId"))) {
+                g_object_unref (parser);
+                return;
+        }
+
+        book_link = get_book_link (model,
+                                   json_object_get_string_member (object, "DocsetId"),
+                                   json_object_get_string_member (object, "DocsetName"));
+        uri = _dh_core_endpoint_get_uri (json_object_get_string_member (object, "Path"));
         link = dh_link_new (DH_LINK_TYPE_KEYWORD,
                             book_link,
-                            json_object_get_string_member(object, "Res"),
+                            json_object_get_string_member (object, "Res"),
                             uri);
-        g_free(uri);
-        dh_link_unref (book_link);
-        g_queue_push_tail(&ctx->priv->links, link);
+        queue_hit (model, link);
+
+        g_free (uri);
         g_object_unref (parser);
+
+        /* Several frames usually arrive in the same main loop iteration,
+         * insert them as one batch.
+         */
+        if (priv->flush_id == 0)
+                priv->flush_id = g_idle_add (flush_new_links_idle_cb, model);
 }
 
-void
-websocket_connected_cb (GObject *source_object,
-                        GAsyncResult *res,
-                        gpointer user_data)
+static void
+search_channel_close (DhKeywordModel *model)
 {
-        SearchContext *ctx = user_data;
-        SoupWebsocketConnection *conn = soup_session_websocket_connect_finish(source_object, res, NULL);
-        g_signal_connect(conn, "message", (GCallback*)websocket_message_cb, user_data);
-        gchar *kws = ctx->settings.search_context->joined_keywords;
-        soup_websocket_connection_send_text(conn, kws);
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+
+        if (priv->connect_cancellable != NULL) {
+                g_cancellable_cancel (priv->connect_cancellable);
+                g_clear_object (&priv->connect_cancellable);
+        }
+
+        if (priv->ws != NULL) {
+                g_signal_handlers_disconnect_by_data (priv->ws, model);
+
+                if (soup_websocket_connection_get_state (priv->ws) == SOUP_WEBSOCKET_STATE_OPEN)
+                        soup_websocket_connection_close (priv->ws, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL);
+
+                g_clear_object (&priv->ws);
+        }
+
+        g_free (priv->ws_uri);
+        priv->ws_uri = NULL;
+
+        g_clear_pointer (&priv->frame_decoder, _dh_search_frame_decoder_free);
+        g_clear_pointer (&priv->frame_book_links, g_hash_table_unref);
+        if (priv->hit_uri != NULL) {
+                g_string_free (priv->hit_uri, TRUE);
+                priv->hit_uri = NULL;
+        }
+
+        g_queue_clear (&priv->generations_in_flight);
+
+        if (priv->query_timeout_id != 0) {
+                g_source_remove (priv->query_timeout_id);
+                priv->query_timeout_id = 0;
+        }
+
+        priv->n_answered_queries = 0;
 }
 
-static gint
-link_compare (gconstpointer a,
-              gconstpointer b,
-              gpointer      user_data)
+/* Closes the channel, and ends the current query if its results were still
+ * expected. The channel is re-opened on the next query.
+ */
+static void
+search_channel_lost (DhKeywordModel *model)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        gboolean was_waiting;
+
+        was_waiting = g_queue_find (&priv->generations_in_flight,
+                                    GUINT_TO_POINTER (priv->generation)) != NULL;
+        search_channel_close (model);
+
+        if (was_waiting)
+                finish_current_query (model);
+}
+
+static void
+websocket_closed_cb (SoupWebsocketConnection *ws,
+                     DhKeywordModel          *model)
+{
+        /* zealcore went away, for example because it has been restarted. */
+        search_channel_lost (model);
+}
+
+/* zealcore is expected to answer several queries in order on the same
+ * channel. If it hasn't sent anything for QUERY_TIMEOUT_MS while queries are in
+ * flight, the channel is dropped, so that the searches don't silently show
+ * nothing. If the channel had already answered a query, zealcore is assumed to
+ * answer only one query per connection, and the next queries each get a new
+ * channel.
+ */
+static gboolean
+query_timeout_cb (gpointer user_data)
+{
+        DhKeywordModel *model = DH_KEYWORD_MODEL (user_data);
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        gint64 idle_ms;
+
+        priv->query_timeout_id = 0;
+
+        if (g_queue_is_empty (&priv->generations_in_flight))
+                return G_SOURCE_REMOVE;
+
+        idle_ms = (g_get_monotonic_time () - priv->last_activity_time) / 1000;
+        if (idle_ms < QUERY_TIMEOUT_MS) {
+                priv->query_timeout_id = g_timeout_add (QUERY_TIMEOUT_MS - idle_ms,
+                                                        query_timeout_cb,
+                                                        model);
+                return G_SOURCE_REMOVE;
+        }
+
+        if (priv->n_answered_queries > 0) {
+                priv->one_query_per_channel = TRUE;
+        } else {
+                g_warning ("zealcore didn't answer the search after %d ms.",
+                           QUERY_TIMEOUT_MS);
+        }
+
+        search_channel_lost (model);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+search_channel_send (DhKeywordModel *model,
+                     const gchar    *query,
+                     guint           generation)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+
+        soup_websocket_connection_send_text (priv->ws, query);
+        g_queue_push_tail (&priv->generations_in_flight, GUINT_TO_POINTER (generation));
+
+        priv->last_activity_time = g_get_monotonic_time ();
+        if (priv->query_timeout_id == 0) {
+                priv->query_timeout_id = g_timeout_add (QUERY_TIMEOUT_MS,
+                                                        query_timeout_cb,
+                                                        model);
+        }
+}
+
+static void
+websocket_connected_cb (GObject      *source_object,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+        DhKeywordModel *model = DH_KEYWORD_MODEL (user_data);
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        SoupWebsocketConnection *ws;
+        gchar *base_uri;
+        GError *error = NULL;
+
+        ws = _dh_core_client_websocket_connect_finish (result, &error);
+
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+                g_error_free (error);
+                g_object_unref (model);
+                return;
+        }
+
+        g_clear_object (&priv->connect_cancellable);
+
+        if (error != NULL) {
+                g_warning ("Failed to connect to the zealcore search service: %s",
+                           error->message);
+                g_error_free (error);
+
+                g_free (priv->ws_uri);
+                priv->ws_uri = NULL;
+                g_free (priv->pending_query);
+                priv->pending_query = NULL;
+                finish_current_query (model);
+
+                g_object_unref (model);
+                return;
+        }
+
+        priv->ws = ws;
+
+        priv->frame_decoder = _dh_search_frame_decoder_new ();
+        priv->frame_book_links = g_hash_table_new_full (g_direct_hash,
+                                                        g_direct_equal,
+                                                        NULL,
+                                                        (GDestroyNotify) dh_link_unref);
+        base_uri = _dh_core_endpoint_get_uri ("");
+        priv->hit_uri = g_string_new (base_uri);
+        g_free (base_uri);
+        priv->hit_uri_base_length = priv->hit_uri->len;
+
+        g_signal_connect (priv->ws,
+                          "message",
+                          G_CALLBACK (websocket_message_cb),
+                          model);
+
+        g_signal_connect (priv->ws,
+                          "closed",
+                          G_CALLBACK (websocket_closed_cb),
+                          model);
+
+        if (priv->pending_query != NULL) {
+                search_channel_send (model, priv->pending_query, priv->pending_generation);
+                g_free (priv->pending_query);
+                priv->pending_query = NULL;
+        }
+
+        g_object_unref (model);
+}
+
+/* Sends @query tagged with the current generation on the search channel,
+ * (re-)opening it if needed.
+ */
+static void
+search_channel_query (DhKeywordModel *model,
+                      const gchar    *query)
 {
-        return dh_link_compare (a, b);
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        /* zealcore falls back to one JSON text frame per hit if it doesn't
+         * support the batched binary frames.
+         */
+        const gchar *protocols[] = { DH_SEARCH_FRAME_PROTOCOL, NULL };
+        gchar *uri;
+        SoupMessage *msg;
+
+        uri = get_search_uri (model);
+
+        /* The group has changed since the channel was opened, or zealcore
+         * doesn't answer a second query on the same channel.
+         */
+        if ((priv->ws_uri != NULL && !g_str_equal (priv->ws_uri, uri)) ||
+            (priv->one_query_per_channel && priv->ws != NULL))
+                search_channel_close (model);
+
+        if (priv->ws != NULL &&
+            soup_websocket_connection_get_state (priv->ws) == SOUP_WEBSOCKET_STATE_OPEN) {
+                search_channel_send (model, query, priv->generation);
+                g_free (uri);
+                return;
+        }
+
+        /* Replaces the previous pending query, if any: it is superseded. */
+        g_free (priv->pending_query);
+        priv->pending_query = g_strdup (query);
+        priv->pending_generation = priv->generation;
+
+        /* Still connecting, the pending query will be sent when it's done. */
+        if (priv->connect_cancellable != NULL) {
+                g_free (uri);
+                return;
+        }
+
+        g_free (priv->ws_uri);
+        priv->ws_uri = uri;
+
+        priv->connect_cancellable = g_cancellable_new ();
+
+        msg = soup_message_new ("GET", priv->ws_uri);
+        _dh_core_client_websocket_connect_async (msg,
+                                                 protocols,
+                                                 priv->connect_cancellable,
+                                                 websocket_connected_cb,
+                                                 g_object_ref (model));
+        g_object_unref (msg);
 }
 
 void dh_keyword_model_set_group_id(DhKeywordModel *model, gchar *id)
@@ -570,59 +1277,155 @@ void dh_keyword_model_set_group_id(DhKeywordModel *model, gchar *id)
         priv->group_id = g_string_new(id);
 }
 
-static void
-search_books (DhKeywordModel *model,
-              SearchSettings  *settings,
-              guint            max_hits,
-              DhLink         **exact_link)
+/**
+ * _dh_keyword_model_set_group_docsets:
+ * @model: a #DhKeywordModel.
+ * @comma_separated_docs: the IDs of the docsets of the group, separated by
+ *   commas, or "*" for all the docsets.
+ *
+ * Restricts the searches answered by the symbol index to the docsets of the
+ * group, like dh_keyword_model_set_group_id() does for zealcore.
+ */
+void
+_dh_keyword_model_set_group_docsets (DhKeywordModel *model,
+                                     const gchar    *comma_separated_docs)
+{
+        DhKeywordModelPrivate *priv;
+
+        g_return_if_fail (DH_IS_KEYWORD_MODEL (model));
+        g_return_if_fail (comma_separated_docs != NULL);
+
+        priv = dh_keyword_model_get_instance_private (model);
+
+        g_strfreev (priv->group_docset_ids);
+        priv->group_docset_ids = NULL;
+
+        if (!g_str_equal (comma_separated_docs, "*"))
+                priv->group_docset_ids = g_strsplit (comma_separated_docs, ",", 0);
+}
+
+/* Returns: (transfer container): the NULL-terminated IDs of the docsets whose
+ * hits are wanted for @search_context: the books of the profile that are in the
+ * group, or only the book of "book:". The strings are owned by the books.
+ */
+static GPtrArray *
+get_docset_ids_in_scope (DhKeywordModel  *model,
+                         DhSearchContext *search_context)
 {
-        GList *l;
-        GQueue *ret;
-        clear_links(model);
         DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        DhBookList *book_list;
+        const gchar *book_id;
+        GPtrArray *docset_ids;
+        GList *l;
 
-        if (settings->search_context->keywords == NULL) {
-                return;
+        book_list = dh_profile_get_book_list (priv->profile);
+        book_id = _dh_search_context_get_book_id (search_context);
+        docset_ids = g_ptr_array_new ();
+
+        for (l = dh_book_list_get_books (book_list); l != NULL; l = l->next) {
+                const gchar *docset_id = dh_book_get_id (DH_BOOK (l->data));
+
+                if (book_id != NULL && g_ascii_strcasecmp (book_id, docset_id) != 0)
+                        continue;
+
+                if (priv->group_docset_ids != NULL &&
+                    !g_strv_contains ((const gchar * const *) priv->group_docset_ids, docset_id))
+                        continue;
+
+                g_ptr_array_add (docset_ids, (gpointer) docset_id);
         }
 
-        SoupSession *session;
-        char *uri;
-        gboolean uri_needs_free = FALSE;
-        GHashTable *hash;
-        SearchContext *ctx;
-        SoupMessage *request;
+        g_ptr_array_add (docset_ids, NULL);
 
-        ctx = malloc(sizeof(SearchContext));
-        ctx->settings = *settings;
-        ctx->model = model;
-        ctx->priv = priv;
+        return docset_ids;
+}
 
-        session = soup_session_new();
-        if (priv->group_id == NULL || g_str_equal("*", priv->group_id->str)) {
-                uri = "ws://localhost:12340/search";
-        } else {
-                uri = g_strdup_printf("ws://localhost:12340/search/group/%s", priv->group_id->str);
-                uri_needs_free = TRUE;
+/* Answers the search synchronously from the symbol index, if it is built and
+ * if the search is a single keyword, without "page:". Returns FALSE if zealcore
+ * needs to be queried instead.
+ *
+ * The symbol index is built by the default #DhBookList from the whole zealcore
+ * catalog. So like the hits of zealcore, the hits are restricted to the books
+ * of the profile and to the book of "book:". The restriction is applied by the
+ * index itself, so that the other docsets don't take the max_hits places.
+ */
+static gboolean
+search_symbol_index (DhKeywordModel  *model,
+                     DhSearchContext *search_context,
+                     guint            max_hits)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+        DhBookList *default_book_list;
+        DhSymbolIndex *symbol_index;
+        GPtrArray *docset_ids;
+        GArray *hits;
+        guint i;
+
+        if (search_context->keywords == NULL ||
+            g_strv_length (search_context->keywords) != 1 ||
+            _dh_search_context_get_page_id (search_context) != NULL) {
+                return FALSE;
         }
-        hash = g_hash_table_new(g_str_hash, g_str_equal);
-        request = soup_form_request_new_from_hash ("GET", uri, hash);
 
+        default_book_list = dh_book_list_get_default (-1);  // should be already created
+        if (!DH_IS_BOOK_LIST_DIRECTORY (default_book_list))
+                return FALSE;
+
+        symbol_index = _dh_book_list_directory_get_symbol_index (DH_BOOK_LIST_DIRECTORY (default_book_list));
+        if (symbol_index == NULL)
+                return FALSE;
 
-        char **protocols = malloc(sizeof(char*));
-        *protocols = NULL;
-        soup_session_websocket_connect_async(session,
-                                             request,
-                                             "http://localhost/",
-                                             protocols,
-                                             NULL,
-                                             websocket_connected_cb,
-                                             ctx);
-        free(protocols);
-        g_hash_table_unref(hash);
-        g_object_unref(request);
-        if (uri_needs_free) {
-                g_free(uri);
+        docset_ids = get_docset_ids_in_scope (model, search_context);
+        hits = _dh_symbol_index_search (symbol_index,
+                                        search_context->keywords[0],
+                                        (const gchar * const *) docset_ids->pdata,
+                                        max_hits);
+        g_ptr_array_unref (docset_ids);
+
+        for (i = 0; i < hits->len; i++) {
+                guint symbol = g_array_index (hits, guint, i);
+                const gchar *docset_id;
+                DhLink *book_link;
+                DhLink *link;
+                gchar *uri;
+
+                docset_id = _dh_symbol_index_get_docset_id (symbol_index, symbol);
+                book_link = get_book_link (model,
+                                           docset_id,
+                                           _dh_symbol_index_get_docset_name (symbol_index, symbol));
+                uri = _dh_core_endpoint_get_uri (_dh_symbol_index_get_path (symbol_index, symbol));
+                link = dh_link_new (DH_LINK_TYPE_KEYWORD,
+                                    book_link,
+                                    _dh_symbol_index_get_name (symbol_index, symbol),
+                                    uri);
+                queue_hit (model, link);
+
+                g_free (uri);
         }
+
+        if (priv->new_links.length == 0)
+                append_stackoverflow_link (model, search_context->joined_keywords);
+
+        g_array_unref (hits);
+
+        flush_new_links (model);
+
+        return TRUE;
+}
+
+static void
+search_books (DhKeywordModel *model,
+              SearchSettings  *settings,
+              guint            max_hits,
+              DhLink         **exact_link)
+{
+        DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
+
+        if (settings->search_context->keywords == NULL)
+                return;
+
+        priv->current_keywords = g_strdup (settings->search_context->joined_keywords);
+        search_channel_query (model, priv->current_keywords);
 }
 
 static GQueue *
@@ -690,10 +1493,9 @@ handle_book_id_only (DhBookList       *book_list,
  *   the page link is the one given as exact match.
  */
 static void
-keyword_model_search (DhKeywordModel   *model,
-                      DhBookList       *book_list,
-                      DhSearchContext  *search_context,
-                      DhLink          **exact_link)
+keyword_model_search (DhKeywordModel  *model,
+                      DhBookList      *book_list,
+                      DhSearchContext *search_context)
 {
         DhKeywordModelPrivate *priv = dh_keyword_model_get_instance_private (model);
         SearchSettings settings;
@@ -730,6 +1532,10 @@ keyword_model_search (DhKeywordModel   *model,
          */
         settings.book_id = NULL;
         settings.skip_book_id = priv->current_book_id;
+
+        if (search_symbol_index (model, search_context, max_hits))
+                return;
+
         search_books (model, &settings,
                       max_hits,
                       &other_books_exact_link);
@@ -737,6 +1543,38 @@ keyword_model_search (DhKeywordModel   *model,
 
 }
 
+/*
+ * _dh_keyword_model_get_exact_link:
+ * @model: a #DhKeywordModel.
+ *
+ * Like the return value of dh_keyword_model_filter(), but also once the
+ * results received asynchronously from zealcore are in @model, for example in
+ * a #DhKeywordModel::filter-complete handler.
+ *
+ * Returns: (nullable) (transfer none): the only hit, or the first hit that
+ * matches the search exactly. The link to search on Stack Overflow when there
+ * are no results is not returned.
+ */
+DhLink *
+_dh_keyword_model_get_exact_link (DhKeywordModel *model)
+{
+        DhKeywordModelPrivate *priv;
+
+        g_return_val_if_fail (DH_IS_KEYWORD_MODEL (model), NULL);
+
+        priv = dh_keyword_model_get_instance_private (model);
+
+        /* One hit */
+        if (priv->rows.length == 1) {
+                Row *row = g_queue_peek_head (&priv->rows);
+
+                if (g_strcmp0 (dh_link_get_book_id (row->link), "stackoverflow") != 0)
+                        return row->link;
+        }
+
+        return priv->exact_link;
+}
+
 /**
  * dh_keyword_model_filter:
  * @model: a #DhKeywordModel.
@@ -748,21 +1586,23 @@ keyword_model_search (DhKeywordModel   *model,
  * to @search_string, and fills the @model with that list (erasing the previous
  * content).
  *
- * Attention, when calling this function the @model needs to be disconnected
- * from the #GtkTreeView, because the #GtkTreeModel signals are not emitted, to
- * improve the performances (sending a lot of signals is slow) and have a
- * simpler implementation. The previous row selection is anyway no longer
- * relevant.
+ * When the in-process symbol index is built and the search is a single
+ * keyword, @model is filled before this function returns. Otherwise the
+ * results are received asynchronously from zealcore, and inserted in @model
+ * in batches, with the usual #GtkTreeModel signals, so @model can stay
+ * connected to a #GtkTreeView. The #DhKeywordModel::filter-complete signal is
+ * emitted when all the results have been received. Calling this function again
+ * before that supersedes the previous search: its late results are ignored.
  *
- * Note that there is a maximum number of matches (configured internally). When
- * the maximum is reached the search is stopped, to avoid blocking the GUI
- * (since this function runs synchronously) if the @search_string contains for
- * example only one character. (And it is anyway not very useful to show to the
- * user tens of thousands search results).
+ * Note that there is a maximum number of matches (configured internally), it
+ * is anyway not very useful to show to the user tens of thousands search
+ * results.
  *
  * Returns: (nullable) (transfer none): the #DhLink that matches exactly
  * @search_string, or %NULL if no such #DhLink was found within the maximum
- * number of matches.
+ * number of matches. The same rules apply to the results received
+ * asynchronously, but they can be known only once
+ * #DhKeywordModel::filter-complete is emitted.
  */
 DhLink *
 dh_keyword_model_filter (DhKeywordModel *model,
@@ -772,8 +1612,6 @@ dh_keyword_model_filter (DhKeywordModel *model,
 {
         DhKeywordModelPrivate *priv;
         DhBookList *book_list;
-        DhSearchContext *search_context;
-        DhLink *exact_link = NULL;
 
         g_return_val_if_fail (DH_IS_KEYWORD_MODEL (model), NULL);
         g_return_val_if_fail (search_string != NULL, NULL);
@@ -786,38 +1624,46 @@ dh_keyword_model_filter (DhKeywordModel *model,
 
         book_list = dh_profile_get_book_list (profile);
 
+        if (priv->profile != profile) {
+                g_set_object (&priv->profile, profile);
+
+                /* The cached book links come from the registry of the
+                 * previous profile.
+                 */
+                if (priv->frame_book_links != NULL)
+                        g_hash_table_remove_all (priv->frame_book_links);
+        }
+
         g_free (priv->current_book_id);
         priv->current_book_id = NULL;
 
-        search_context = _dh_search_context_new (search_string);
+        /* Start a new generation, the results of the previous one are no
+         * longer wanted.
+         */
+        priv->generation++;
+        remove_all_rows (model);
+        g_free (priv->current_keywords);
+        priv->current_keywords = NULL;
 
-        if (search_context != NULL) {
+        _dh_search_context_free (priv->search_context);
+        priv->search_context = _dh_search_context_new (search_string);
+
+        if (priv->search_context != NULL) {
                 const gchar *book_id_in_search_string;
 
-                book_id_in_search_string = _dh_search_context_get_book_id (search_context);
+                book_id_in_search_string = _dh_search_context_get_book_id (priv->search_context);
 
                 if (book_id_in_search_string != NULL)
                         priv->current_book_id = g_strdup (book_id_in_search_string);
                 else
                         priv->current_book_id = g_strdup (current_book_id);
 
-                keyword_model_search (model, book_list, search_context, &exact_link);
+                keyword_model_search (model, book_list, priv->search_context);
         }
 
-        //clear_links (model);
-        //_dh_util_queue_concat (&priv->links, new_links);
-        //new_links = NULL;
-
-        /* The content has been modified, change the stamp so that older
-         * GtkTreeIter's become invalid.
-         */
-        priv->stamp++;
-
-        // _dh_search_context_free (search_context);
-
-        /* One hit */
-        if (priv->links.length == 1)
-                return g_queue_peek_head (&priv->links);
+        /* Nothing to wait for. */
+        if (priv->current_keywords == NULL)
+                g_signal_emit (model, signals[SIGNAL_FILTER_COMPLETE], 0);
 
-        return exact_link;
+        return _dh_keyword_model_get_exact_link (model);
 }
@@ -45,6 +45,7 @@ enum {
         DH_KEYWORD_MODEL_COL_NAME,
         DH_KEYWORD_MODEL_COL_LINK,
         DH_KEYWORD_MODEL_COL_CURRENT_BOOK_FLAG,
+        DH_KEYWORD_MODEL_COL_BOOK_ICON,
         DH_KEYWORD_MODEL_NUM_COLS
 };
 
@@ -55,5 +56,12 @@ DhLink         *dh_keyword_model_filter (DhKeywordModel *model,
                                          DhProfile      *profile);
 void dh_keyword_model_set_group_id(DhKeywordModel *model, gchar *id);
 
+G_GNUC_INTERNAL
+void            _dh_keyword_model_set_group_docsets     (DhKeywordModel *model,
+                                                         const gchar    *comma_separated_docs);
+
+G_GNUC_INTERNAL
+DhLink *        _dh_keyword_model_get_exact_link        (DhKeywordModel *model);
+
 G_END_DECLS
 
@@ -24,6 +24,7 @@
 #include "dh-link.h"
 #include "dh-book.h"
 #include "dh-book-list.h"
+#include "dh-docset-registry.h"
 #include <string.h>
 #include <glib/gi18n-lib.h>
 #include <gtk/gtk.h>
@@ -69,7 +70,17 @@ struct _DhLink {
                 DhLink *link;
         } book;
 
+        /* @name is one allocation, with after it the name folded to
+         * lowercase if it differs from @name, computed when the link is
+         * created so that searching is a byte comparison. The offset is 0
+         * otherwise.
+         */
         gchar *name;
+        guint32 folded_name_offset;
+
+        /* Computed by the first dh_link_compare(), most links are never
+         * sorted.
+         */
         gchar *name_collation_key;
 
         gchar *relative_url;
@@ -125,6 +136,36 @@ link_free (DhLink *link)
         g_slice_free (DhLink, link);
 }
 
+static void
+set_name (DhLink      *link,
+          const gchar *name)
+{
+        gsize name_size;
+        gboolean has_uppercase = FALSE;
+        gsize i;
+
+        name_size = strlen (name) + 1;
+        for (i = 0; name[i] != '\0'; i++) {
+                if (g_ascii_isupper (name[i])) {
+                        has_uppercase = TRUE;
+                        break;
+                }
+        }
+
+        if (!has_uppercase) {
+                link->name = g_strdup (name);
+                return;
+        }
+
+        link->name = g_malloc (2 * name_size);
+        memcpy (link->name, name, name_size);
+
+        for (i = 0; i < name_size; i++)
+                link->name[name_size + i] = g_ascii_tolower (name[i]);
+
+        link->folded_name_offset = name_size;
+}
+
 static DhLink *
 dh_link_new_common (DhLinkType   type,
                     const gchar *name,
@@ -135,7 +176,7 @@ dh_link_new_common (DhLinkType   type,
         link = g_slice_new0 (DhLink);
         link->ref_count = 1;
         link->type = type;
-        link->name = g_strdup (name);
+        set_name (link, name);
         link->relative_url = g_strdup (relative_url);
 
         return link;
@@ -300,6 +341,18 @@ dh_link_get_name (DhLink *link)
         return link->name;
 }
 
+/* Returns: the name of @link with the ASCII letters folded to lowercase, to
+ * match it with lowercase keywords. It's the name itself if it has no
+ * uppercase letter.
+ */
+const gchar *
+_dh_link_get_folded_name (DhLink *link)
+{
+        g_return_val_if_fail (link != NULL, NULL);
+
+        return link->name + link->folded_name_offset;
+}
+
 /**
  * dh_link_match_relative_url:
  * @link: a #DhLink.
@@ -439,33 +492,27 @@ dh_link_get_book_id (DhLink *link)
 }
 
 
+/**
+ * dh_link_get_book_surface:
+ * @link: a #DhLink.
+ *
+ * Returns: (nullable) (transfer none): the icon of the book that the @link is
+ * contained in, in the default profile, or %NULL.
+ */
 cairo_surface_t*
 dh_link_get_book_surface (DhLink* link)
 {
-        g_return_val_if_fail (link != NULL, NULL);
+        DhDocsetRegistry *registry;
+        DhBook *book;
 
-        gchar *book_id = dh_link_get_book_id(link);
-
-        if (book_id != NULL) {
-                GList *books = dh_book_list_get_books(dh_book_list_get_default(-1));
-                DhBook *book;
-                while (books) {
-                        book = books->data;
-                        if (g_str_equal(book_id, dh_book_get_id(book))) {
-                                break;
-                        }
-                        books = books->next;
-                }
+        g_return_val_if_fail (link != NULL, NULL);
 
-                if (books != NULL) {
-                        return dh_book_get_icon_surface(book);
-                }
-        }
+        registry = _dh_profile_get_docset_registry (dh_profile_get_default (-1));
+        book = _dh_docset_registry_lookup_book (registry, dh_link_get_book_id (link));
 
-        return NULL;
+        return book != NULL ? dh_book_get_icon_surface (book) : NULL;
 }
 
-
 static gint
 dh_link_type_compare (DhLinkType a,
                       DhLinkType b)
@@ -94,6 +94,9 @@ void         dh_link_set_flags          (DhLink        *link,
 
 const gchar *dh_link_get_name           (DhLink        *link);
 
+G_GNUC_INTERNAL
+const gchar *_dh_link_get_folded_name   (DhLink        *link);
+
 gboolean     dh_link_match_relative_url (DhLink        *link,
                                          const gchar   *relative_url);
 
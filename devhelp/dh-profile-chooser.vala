@@ -9,6 +9,15 @@ int _dh_util_surface_scale(int scale)
                 return (int)(2.0 * (2.0 / (double)scale));
 }
 
+// See dh-catalog-cache.h.
+extern GLib.Bytes? _dh_catalog_cache_load(string name, out string? etag);
+extern void _dh_catalog_cache_save(string name, string? etag, GLib.Bytes data);
+
+// See dh-core-client.h.
+extern Soup.Message _dh_core_client_new_message(string method, string path);
+[CCode (finish_name = "_dh_core_client_send_and_read_finish")]
+extern async GLib.Bytes _dh_core_client_send_and_read_async(Soup.Message msg, GLib.Cancellable? cancellable) throws GLib.Error;
+
 public class DhProfileChooser : Box {
 
     ToggleButton drag_button;
@@ -51,7 +60,7 @@ public class DhProfileChooser : Box {
         );
         this.pack_end(toolbar);
         this.show_all();
-        load_groups();
+        load_cached_groups();
     }
 
     void bind_toggle_handler(ToggleButton btn, int i) {
@@ -78,13 +87,67 @@ public class DhProfileChooser : Box {
         });
     }
 
-    int load_groups() {
-        Soup.Session session = new Soup.Session();
-        Soup.Request req = session.request("http://localhost:12340/group");
-        GLib.InputStream stream = req.send();
-        GLib.DataInputStream data_stream = new GLib.DataInputStream(stream);
-        Json.Node line_node = Json.from_string(data_stream.read_line()); 
-        Json.Array array = line_node.get_array();
+    // Shows the groups of the previous session right away, then reconciles
+    // them with zealcore in the background.
+    void load_cached_groups() {
+        string? etag;
+        GLib.Bytes? cached = _dh_catalog_cache_load("group", out etag);
+        if (cached == null || parse_and_populate_groups(cached) < -1) {
+            etag = null;
+        }
+
+        load_groups.begin(etag);
+    }
+
+    // Returns the index of the current group, -1 if it is not found, or -2 if
+    // the groups couldn't be loaded. The groups are kept as they are if they
+    // still match @etag.
+    async int load_groups(string? etag = null) {
+        Soup.Message msg = _dh_core_client_new_message("GET", "group");
+        if (etag != null) {
+            msg.request_headers.append("If-None-Match", etag);
+        }
+        GLib.Bytes body;
+        try {
+            body = yield _dh_core_client_send_and_read_async(msg, null);
+        } catch (GLib.Error e) {
+            warning("Failed to get the groups: %s", e.message);
+            return -2;
+        }
+        if (msg.status_code == Soup.Status.NOT_MODIFIED) {
+            return current_group == "*" ? -1 : current_group_i;
+        }
+        return groups_received(msg, body);
+    }
+
+    int groups_received(Soup.Message msg, GLib.Bytes body) {
+        if (msg.status_code < 200 || msg.status_code >= 300) {
+            warning("Failed to get the groups: %s", msg.reason_phrase);
+            return -2;
+        }
+        int cur_group_found = parse_and_populate_groups(body);
+        if (cur_group_found >= -1) {
+            _dh_catalog_cache_save("group", msg.response_headers.get_one("ETag"), body);
+        }
+        return cur_group_found;
+    }
+
+    int parse_and_populate_groups(GLib.Bytes data) {
+        Json.Parser parser = new Json.Parser();
+        try {
+            parser.load_from_data((string) data.get_data(), (ssize_t) data.get_size());
+        } catch (GLib.Error e) {
+            warning("Failed to parse the groups: %s", e.message);
+            return -2;
+        }
+        Json.Node? root = parser.get_root();
+        if (root == null || root.get_node_type() != Json.NodeType.ARRAY) {
+            return -2;
+        }
+        return populate_groups(root.get_array());
+    }
+
+    int populate_groups(Json.Array array) {
         for (int i = 0; i < buttons.length; ++i) {
             this.remove(buttons[i]);
             buttons[i].destroy();
@@ -186,23 +249,40 @@ public class DhProfileChooser : Box {
             if (dialog.run() == ResponseType.OK) {
                     string current_text = dialog.get_current_text();
                     string current_icon = dialog.get_current_icon();
-                    load_groups();
+                    load_groups.begin();
             }
             dialog.destroy();
         } else {
-            Soup.Session session = new Soup.Session();
-            Soup.Message msg = new Soup.Message("DELETE", "http://localhost:12340/group/" + current_group + "/doc/" + cur_docset_id);
-            session.send(msg);
-            this.group_selected("*", "*");
-            int cur_group_found = load_groups();
-            if (cur_group_found >= 0) {
-                this.group_selected(current_group, group_lists[current_group_i]);
-            }
+            remove_from_current_group.begin(cur_docset_id);
         }
         cur_docset_id = null;
         return true;
     }
 
+    async void remove_from_current_group(string docset_id) {
+        Soup.Message msg = _dh_core_client_new_message("DELETE", "group/" + current_group + "/doc/" + docset_id);
+        try {
+            yield _dh_core_client_send_and_read_async(msg, null);
+        } catch (GLib.Error e) {
+            warning("Failed to remove the docset from the group: %s", e.message);
+        }
+        this.group_selected("*", "*");
+        int cur_group_found = yield load_groups();
+        if (cur_group_found >= 0) {
+            this.group_selected(current_group, group_lists[current_group_i]);
+        }
+    }
+
+    async void add_to_group(string group_id, string docset_id) {
+        Soup.Message msg = _dh_core_client_new_message("POST", "group/" + group_id + "/doc/" + docset_id);
+        try {
+            yield _dh_core_client_send_and_read_async(msg, null);
+        } catch (GLib.Error e) {
+            warning("Failed to add the docset to the group: %s", e.message);
+        }
+        yield load_groups();
+    }
+
     void on_drag_leave(DragContext context, uint time) {
         drag_unhighlight(toolbar);
         if (drag_button != null) {
@@ -233,10 +313,7 @@ public class DhProfileChooser : Box {
 
     void make_btn_on_drag_drop(ToggleButton btn) {
         btn.drag_drop.connect((context, x, y, time) => {
-            Soup.Session session = new Soup.Session();
-            Soup.Message msg = new Soup.Message("POST", "http://localhost:12340/group/" + current_drop_group + "/doc/" + cur_docset_id);
-            session.send(msg);
-            load_groups();
+            add_to_group.begin(current_drop_group, cur_docset_id);
 
             return true;
         });
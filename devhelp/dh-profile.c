@@ -20,6 +20,8 @@
 
 #include "dh-profile.h"
 #include "dh-profile-builder.h"
+#include "dh-completion-index.h"
+#include "dh-docset-registry.h"
 
 /**
  * SECTION:dh-profile
@@ -54,6 +56,14 @@ struct _DhProfile {
 typedef struct {
         DhSettings *settings;
         DhBookList *book_list;
+
+        /* Created on the first search. */
+        DhDocsetRegistry *docset_registry;
+
+        /* Created on the first completion, then kept in sync with the book
+         * list.
+         */
+        DhCompletionIndex *completion_index;
 } DhProfilePrivate;
 
 static DhProfile *default_instance = NULL;
@@ -66,6 +76,8 @@ dh_profile_dispose (GObject *object)
         DhProfile *profile = DH_PROFILE (object);
         DhProfilePrivate *priv = dh_profile_get_instance_private (profile);
 
+        g_clear_pointer (&priv->docset_registry, _dh_docset_registry_free);
+        g_clear_pointer (&priv->completion_index, _dh_completion_index_free);
         g_clear_object (&priv->settings);
         g_clear_object (&priv->book_list);
 
@@ -186,3 +198,94 @@ dh_profile_get_book_list (DhProfile *profile)
 
         return priv->book_list;
 }
+
+DhDocsetRegistry *
+_dh_profile_get_docset_registry (DhProfile *profile)
+{
+        DhProfilePrivate *priv;
+
+        g_return_val_if_fail (DH_IS_PROFILE (profile), NULL);
+
+        priv = dh_profile_get_instance_private (profile);
+
+        if (priv->docset_registry == NULL)
+                priv->docset_registry = _dh_docset_registry_new (priv->book_list);
+
+        return priv->docset_registry;
+}
+
+static void
+completion_index_add_book_cb (DhBookList *book_list,
+                              DhBook     *book,
+                              DhProfile  *profile)
+{
+        DhProfilePrivate *priv = dh_profile_get_instance_private (profile);
+
+        if (priv->completion_index != NULL)
+                _dh_completion_index_add (priv->completion_index, G_OBJECT (book));
+}
+
+static void
+completion_index_remove_book_cb (DhBookList *book_list,
+                                 DhBook     *book,
+                                 DhProfile  *profile)
+{
+        DhProfilePrivate *priv = dh_profile_get_instance_private (profile);
+
+        if (priv->completion_index != NULL)
+                _dh_completion_index_remove (priv->completion_index, G_OBJECT (book));
+}
+
+/* The symbols of the zealcore docsets come from the symbol index of the
+ * default book list, which is replaced when it has been built in the
+ * background.
+ */
+static void
+sync_completion_symbol_index (DhProfile *profile)
+{
+        DhProfilePrivate *priv = dh_profile_get_instance_private (profile);
+        DhBookList *default_book_list;
+
+        default_book_list = dh_book_list_get_default (-1);
+        if (!DH_IS_BOOK_LIST_DIRECTORY (default_book_list))
+                return;
+
+        _dh_completion_index_set_symbol_index (priv->completion_index,
+                                               _dh_book_list_directory_get_symbol_index (DH_BOOK_LIST_DIRECTORY (default_book_list)));
+}
+
+DhCompletionIndex *
+_dh_profile_get_completion_index (DhProfile *profile)
+{
+        DhProfilePrivate *priv;
+        GList *l;
+
+        g_return_val_if_fail (DH_IS_PROFILE (profile), NULL);
+
+        priv = dh_profile_get_instance_private (profile);
+
+        if (priv->completion_index != NULL) {
+                sync_completion_symbol_index (profile);
+                return priv->completion_index;
+        }
+
+        priv->completion_index = _dh_completion_index_new ();
+        sync_completion_symbol_index (profile);
+
+        for (l = dh_book_list_get_books (priv->book_list); l != NULL; l = l->next)
+                _dh_completion_index_add (priv->completion_index, G_OBJECT (l->data));
+
+        g_signal_connect_object (priv->book_list,
+                                 "add-book",
+                                 G_CALLBACK (completion_index_add_book_cb),
+                                 profile,
+                                 0);
+
+        g_signal_connect_object (priv->book_list,
+                                 "remove-book",
+                                 G_CALLBACK (completion_index_remove_book_cb),
+                                 profile,
+                                 0);
+
+        return priv->completion_index;
+}
@@ -20,6 +20,7 @@
 
 #include "dh-search-context.h"
 #include <string.h>
+#include "dh-keyword-matcher.h"
 
 typedef struct _KeywordData {
         gchar *keyword;
@@ -30,6 +31,9 @@ typedef struct _KeywordData {
         /* Created only if has_glob. */
         GPatternSpec *pattern_spec_anywhere;
 
+        /* Created only if !has_glob. */
+        DhKeywordMatcher *matcher;
+
         guint is_first : 1;
         guint has_glob : 1;
 } KeywordData;
@@ -225,6 +229,11 @@ keyword_data_new (const gchar *keyword,
                 pattern = g_strdup_printf ("*%s*", keyword);
                 data->pattern_spec_anywhere = g_pattern_spec_new (pattern);
                 g_free (pattern);
+        } else {
+                /* If the search is case insensitive, the keyword is lowercase
+                 * and is matched with the folded link name.
+                 */
+                data->matcher = _dh_keyword_matcher_new (keyword);
         }
 
         return data;
@@ -246,6 +255,8 @@ keyword_data_free (gpointer _data)
         if (data->pattern_spec_anywhere != NULL)
                 g_pattern_spec_free (data->pattern_spec_anywhere);
 
+        _dh_keyword_matcher_free (data->matcher);
+
         g_free (data);
 }
 
@@ -373,8 +384,8 @@ _dh_search_context_match_link (DhSearchContext *search,
                                DhLink          *link,
                                gboolean         prefix)
 {
-        gchar *str_to_free = NULL;
         const gchar *link_name;
+        gsize link_name_length;
         gboolean match = FALSE;
         GSList *l;
 
@@ -396,15 +407,17 @@ _dh_search_context_match_link (DhSearchContext *search,
         if (search->keywords == NULL)
                 return FALSE;
 
-        if (search->case_sensitive) {
+        /* The folded name is precomputed in the DhLink, so that matching it
+         * is a byte comparison.
+         */
+        if (search->case_sensitive)
                 link_name = dh_link_get_name (link);
-        } else {
-                str_to_free = g_ascii_strdown (dh_link_get_name (link), -1);
-                link_name = str_to_free;
-        }
-
+        else
+                link_name = _dh_link_get_folded_name (link);
         g_return_val_if_fail (link_name != NULL, FALSE);
 
+        link_name_length = strlen (link_name);
+
         /* Why isn't there only one GPatternSpec (or two variants:
          * prefix/anywhere) for all the keywords? For example searching
          * "dh_link_ book" (two keywords) would create the GPatternSpec
@@ -426,8 +439,8 @@ _dh_search_context_match_link (DhSearchContext *search,
          *   namespace.
          */
 
-        /* Use simple string functions when the keyword doesn't contain globs,
-         * to improve performances (this function can be called on *every*
+        /* Use a DhKeywordMatcher when the keyword doesn't contain globs, to
+         * improve performances (this function can be called on *every*
          * DhLink).
          */
 
@@ -443,18 +456,28 @@ _dh_search_context_match_link (DhSearchContext *search,
                                                  g_pattern_match_string (data->pattern_spec_anywhere, link_name));
                                 }
                         } else {
+                                gboolean has_prefix;
+
+                                has_prefix = _dh_keyword_matcher_match_prefix (data->matcher,
+                                                                               link_name,
+                                                                               link_name_length);
+
                                 if (prefix) {
-                                        match = g_str_has_prefix (link_name, data->keyword);
+                                        match = has_prefix;
                                 } else {
-                                        match = (!g_str_has_prefix (link_name, data->keyword) &&
-                                                 strstr (link_name, data->keyword) != NULL);
+                                        match = (!has_prefix &&
+                                                 _dh_keyword_matcher_find (data->matcher,
+                                                                           link_name,
+                                                                           link_name_length) != NULL);
                                 }
                         }
                 } else {
                         if (data->has_glob) {
                                 match = g_pattern_match_string (data->pattern_spec_anywhere, link_name);
                         } else {
-                                match = strstr (link_name, data->keyword) != NULL;
+                                match = _dh_keyword_matcher_find (data->matcher,
+                                                                  link_name,
+                                                                  link_name_length) != NULL;
                         }
                 }
 
@@ -462,7 +485,6 @@ _dh_search_context_match_link (DhSearchContext *search,
                         break;
         }
 
-        g_free (str_to_free);
         return match;
 }
 
@@ -0,0 +1,228 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-search-frame.h"
+#include <gio/gio.h>
+
+/* The binary frames of the search channel, when DH_SEARCH_FRAME_PROTOCOL is
+ * negotiated. Each frame carries many hits, and the docset IDs and names are
+ * sent once per connection, then referenced by index.
+ *
+ * All the integers are little-endian:
+ *
+ *   frame  := u8 kind, then for kind 1 (hits):
+ *             u16 n_strings, string * n_strings,
+ *             u16 n_hits, hit * n_hits
+ *             kind 2 is the end of the results of a query, with no payload.
+ *   string := u16 length, the bytes, a NUL byte (not counted in length)
+ *   hit    := u16 docset_id, u16 docset_name, string name, string path
+ *
+ * The strings of a frame are appended to the string table of the connection,
+ * docset_id and docset_name are indexes in it. The NUL bytes let the names
+ * and paths be used in place, without a copy.
+ */
+
+#define FRAME_KIND_HITS 1
+#define FRAME_KIND_END 2
+
+struct _DhSearchFrameDecoder {
+        /* The string table of the connection, owned gchar*. */
+        GPtrArray *strings;
+};
+
+typedef struct {
+        const guint8 *data;
+        gsize length;
+        gsize pos;
+} Cursor;
+
+DhSearchFrameDecoder *
+_dh_search_frame_decoder_new (void)
+{
+        DhSearchFrameDecoder *decoder;
+
+        decoder = g_new0 (DhSearchFrameDecoder, 1);
+        decoder->strings = g_ptr_array_new_with_free_func (g_free);
+
+        return decoder;
+}
+
+void
+_dh_search_frame_decoder_free (DhSearchFrameDecoder *decoder)
+{
+        if (decoder == NULL)
+                return;
+
+        g_ptr_array_unref (decoder->strings);
+        g_free (decoder);
+}
+
+static gboolean
+read_u8 (Cursor *cursor,
+         guint  *value)
+{
+        if (cursor->length - cursor->pos < 1)
+                return FALSE;
+
+        *value = cursor->data[cursor->pos];
+        cursor->pos++;
+
+        return TRUE;
+}
+
+static gboolean
+read_u16 (Cursor *cursor,
+          guint  *value)
+{
+        if (cursor->length - cursor->pos < 2)
+                return FALSE;
+
+        *value = cursor->data[cursor->pos] | (cursor->data[cursor->pos + 1] << 8);
+        cursor->pos += 2;
+
+        return TRUE;
+}
+
+/* Returns the string in place, it's NUL-terminated in the frame. */
+static const gchar *
+read_string (Cursor *cursor)
+{
+        const gchar *str;
+        guint length;
+
+        if (!read_u16 (cursor, &length))
+                return NULL;
+
+        if (cursor->length - cursor->pos < (gsize) length + 1 ||
+            cursor->data[cursor->pos + length] != '\0') {
+                return NULL;
+        }
+
+        str = (const gchar *) cursor->data + cursor->pos;
+        cursor->pos += length + 1;
+
+        return str;
+}
+
+/**
+ * _dh_search_frame_decoder_decode:
+ * @decoder: a #DhSearchFrameDecoder.
+ * @frame: a binary frame of the search channel.
+ * @end_of_results: (out): whether @frame ends the results of a query.
+ * @func: the function to call for each hit.
+ * @user_data: the data to pass to @func.
+ * @error: location to a %NULL #GError, or %NULL.
+ *
+ * Calls @func for each hit of @frame. The strings passed to @func are only
+ * valid during the call.
+ *
+ * Returns: %FALSE if @frame is malformed. The string table is then out of
+ * sync, the connection should be closed.
+ */
+gboolean
+_dh_search_frame_decoder_decode (DhSearchFrameDecoder  *decoder,
+                                 GBytes                *frame,
+                                 gboolean              *end_of_results,
+                                 DhSearchFrameHitFunc   func,
+                                 gpointer               user_data,
+                                 GError               **error)
+{
+        Cursor cursor;
+        guint kind;
+        guint n_strings;
+        guint n_hits;
+        guint i;
+
+        g_return_val_if_fail (decoder != NULL, FALSE);
+        g_return_val_if_fail (frame != NULL, FALSE);
+        g_return_val_if_fail (end_of_results != NULL, FALSE);
+        g_return_val_if_fail (func != NULL, FALSE);
+        g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+        cursor.data = g_bytes_get_data (frame, &cursor.length);
+        cursor.pos = 0;
+
+        *end_of_results = FALSE;
+
+        if (!read_u8 (&cursor, &kind))
+                goto malformed;
+
+        if (kind == FRAME_KIND_END) {
+                *end_of_results = TRUE;
+                return TRUE;
+        }
+
+        if (kind != FRAME_KIND_HITS || !read_u16 (&cursor, &n_strings))
+                goto malformed;
+
+        for (i = 0; i < n_strings; i++) {
+                const gchar *str = read_string (&cursor);
+
+                if (str == NULL || decoder->strings->len > G_MAXUINT16)
+                        goto malformed;
+
+                g_ptr_array_add (decoder->strings, g_strdup (str));
+        }
+
+        if (!read_u16 (&cursor, &n_hits))
+                goto malformed;
+
+        for (i = 0; i < n_hits; i++) {
+                guint docset_id;
+                guint docset_name;
+                const gchar *name;
+                const gchar *path;
+
+                if (!read_u16 (&cursor, &docset_id) ||
+                    !read_u16 (&cursor, &docset_name) ||
+                    docset_id >= decoder->strings->len ||
+                    docset_name >= decoder->strings->len) {
+                        goto malformed;
+                }
+
+                name = read_string (&cursor);
+                path = read_string (&cursor);
+                if (name == NULL || path == NULL)
+                        goto malformed;
+
+                func (docset_id, docset_name, name, path, user_data);
+        }
+
+        if (cursor.pos != cursor.length)
+                goto malformed;
+
+        return TRUE;
+
+malformed:
+        g_set_error (error,
+                     G_IO_ERROR,
+                     G_IO_ERROR_INVALID_DATA,
+                     "Malformed search results frame at byte %" G_GSIZE_FORMAT,
+                     cursor.pos);
+        return FALSE;
+}
+
+const gchar *
+_dh_search_frame_decoder_get_string (DhSearchFrameDecoder *decoder,
+                                     guint                 index_)
+{
+        g_return_val_if_fail (decoder != NULL, NULL);
+        g_return_val_if_fail (index_ < decoder->strings->len, NULL);
+
+        return g_ptr_array_index (decoder->strings, index_);
+}
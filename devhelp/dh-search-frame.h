@@ -0,0 +1,60 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The WebSocket sub-protocol of the search channel for the batched binary
+ * frames, see dh-search-frame.c. Without it, zealcore sends one JSON object
+ * per hit.
+ */
+#define DH_SEARCH_FRAME_PROTOCOL "zealcore-search-batch-1"
+
+typedef struct _DhSearchFrameDecoder DhSearchFrameDecoder;
+
+/* @docset_id and @docset_name are indexes in the string table, see
+ * _dh_search_frame_decoder_get_string().
+ */
+typedef void (* DhSearchFrameHitFunc) (guint        docset_id,
+                                       guint        docset_name,
+                                       const gchar *name,
+                                       const gchar *path,
+                                       gpointer     user_data);
+
+G_GNUC_INTERNAL
+DhSearchFrameDecoder *  _dh_search_frame_decoder_new            (void);
+
+G_GNUC_INTERNAL
+void                    _dh_search_frame_decoder_free           (DhSearchFrameDecoder  *decoder);
+
+G_GNUC_INTERNAL
+gboolean                _dh_search_frame_decoder_decode         (DhSearchFrameDecoder  *decoder,
+                                                                 GBytes                *frame,
+                                                                 gboolean              *end_of_results,
+                                                                 DhSearchFrameHitFunc   func,
+                                                                 gpointer               user_data,
+                                                                 GError               **error);
+
+G_GNUC_INTERNAL
+const gchar *           _dh_search_frame_decoder_get_string     (DhSearchFrameDecoder  *decoder,
+                                                                 guint                  index_);
+
+G_END_DECLS
@@ -90,8 +90,15 @@ typedef struct {
         GSettings *gsettings_fonts;
         GSettings *gsettings_desktop_interface;
 
-        /* List of book IDs (gchar*) currently disabled. */
-        GList *books_disabled;
+        /* Book IDs (owned gchar*) currently disabled, in the order of the
+         * "books-disabled" key, without duplicates.
+         */
+        GQueue books_disabled;
+
+        /* Book ID -> its GList node in @books_disabled. The keys are owned by
+         * @books_disabled.
+         */
+        GHashTable *books_disabled_set;
 
         gchar *variable_font;
         gchar *fixed_font;
@@ -99,6 +106,10 @@ typedef struct {
         guint group_books_by_language : 1;
         guint use_system_fonts : 1;
         guint dark_mode : 1;
+
+        /* See dh_settings_freeze_books_disabled_changed(). */
+        guint books_disabled_frozen : 1;
+        guint store_books_disabled_pending : 1;
 } DhSettingsPrivate;
 
 enum {
@@ -123,6 +134,16 @@ static DhSettings *default_instance = NULL;
 
 G_DEFINE_TYPE_WITH_PRIVATE (DhSettings, dh_settings, G_TYPE_OBJECT);
 
+static void
+clear_books_disabled (DhSettings *settings)
+{
+        DhSettingsPrivate *priv = dh_settings_get_instance_private (settings);
+
+        g_hash_table_remove_all (priv->books_disabled_set);
+        g_queue_foreach (&priv->books_disabled, (GFunc) g_free, NULL);
+        g_queue_clear (&priv->books_disabled);
+}
+
 static void
 load_books_disabled (DhSettings *settings)
 {
@@ -130,8 +151,7 @@ load_books_disabled (DhSettings *settings)
         gchar **books_disabled_strv;
         gint i;
 
-        g_list_free_full (priv->books_disabled, g_free);
-        priv->books_disabled = NULL;
+        clear_books_disabled (settings);
 
         books_disabled_strv = g_settings_get_strv (priv->gsettings_contents,
                                                    "books-disabled");
@@ -141,10 +161,17 @@ load_books_disabled (DhSettings *settings)
 
         for (i = 0; books_disabled_strv[i] != NULL; i++) {
                 gchar *book_id = books_disabled_strv[i];
-                priv->books_disabled = g_list_prepend (priv->books_disabled, book_id);
-        }
 
-        priv->books_disabled = g_list_reverse (priv->books_disabled);
+                if (g_hash_table_contains (priv->books_disabled_set, book_id)) {
+                        g_free (book_id);
+                        continue;
+                }
+
+                g_queue_push_tail (&priv->books_disabled, book_id);
+                g_hash_table_insert (priv->books_disabled_set,
+                                     book_id,
+                                     priv->books_disabled.tail);
+        }
 
         g_free (books_disabled_strv);
 }
@@ -157,9 +184,17 @@ store_books_disabled (DhSettings *settings)
         GVariant *variant;
         GList *l;
 
+        /* Written once when thawed. */
+        if (priv->books_disabled_frozen) {
+                priv->store_books_disabled_pending = TRUE;
+                return;
+        }
+
+        priv->store_books_disabled_pending = FALSE;
+
         builder = g_variant_builder_new (G_VARIANT_TYPE_STRING_ARRAY);
 
-        for (l = priv->books_disabled; l != NULL; l = l->next) {
+        for (l = priv->books_disabled.head; l != NULL; l = l->next) {
                 const gchar *book_id = l->data;
                 g_variant_builder_add (builder, "s", book_id);
         }
@@ -170,58 +205,56 @@ store_books_disabled (DhSettings *settings)
         g_settings_set_value (priv->gsettings_contents, "books-disabled", variant);
 }
 
-static GList *
-find_in_books_disabled (DhSettings  *settings,
-                        const gchar *book_id)
+static gboolean
+is_book_disabled (DhSettings  *settings,
+                  const gchar *book_id)
 {
         DhSettingsPrivate *priv = dh_settings_get_instance_private (settings);
-        GList *node;
-
-        for (node = priv->books_disabled; node != NULL; node = node->next) {
-                const gchar *cur_book_id = node->data;
 
-                if (g_strcmp0 (book_id, cur_book_id) == 0)
-                        return node;
-        }
-
-        return NULL;
+        return book_id != NULL && g_hash_table_contains (priv->books_disabled_set, book_id);
 }
 
-static void
+/* Returns: whether the set of disabled books has changed. */
+static gboolean
 enable_book (DhSettings  *settings,
              const gchar *book_id)
 {
         DhSettingsPrivate *priv = dh_settings_get_instance_private (settings);
         GList *node;
 
-        node = find_in_books_disabled (settings, book_id);
+        if (book_id == NULL)
+                return FALSE;
+
+        node = g_hash_table_lookup (priv->books_disabled_set, book_id);
 
         /* Already enabled. */
         if (node == NULL)
-                return;
+                return FALSE;
 
+        g_hash_table_remove (priv->books_disabled_set, book_id);
         g_free (node->data);
-        priv->books_disabled = g_list_delete_link (priv->books_disabled, node);
+        g_queue_delete_link (&priv->books_disabled, node);
 
-        store_books_disabled (settings);
+        return TRUE;
 }
 
-static void
+/* Returns: whether the set of disabled books has changed. */
+static gboolean
 disable_book (DhSettings  *settings,
               const gchar *book_id)
 {
         DhSettingsPrivate *priv = dh_settings_get_instance_private (settings);
-        GList *node;
-
-        node = find_in_books_disabled (settings, book_id);
+        gchar *id;
 
         /* Already disabled. */
-        if (node != NULL)
-                return;
+        if (book_id == NULL || is_book_disabled (settings, book_id))
+                return FALSE;
 
-        priv->books_disabled = g_list_append (priv->books_disabled,
-                                              g_strdup (book_id));
-        store_books_disabled (settings);
+        id = g_strdup (book_id);
+        g_queue_push_tail (&priv->books_disabled, id);
+        g_hash_table_insert (priv->books_disabled_set, id, priv->books_disabled.tail);
+
+        return TRUE;
 }
 
 static void
@@ -327,7 +360,8 @@ dh_settings_finalize (GObject *object)
         DhSettings *settings = DH_SETTINGS (object);
         DhSettingsPrivate *priv = dh_settings_get_instance_private (settings);
 
-        g_list_free_full (priv->books_disabled, g_free);
+        clear_books_disabled (settings);
+        g_hash_table_unref (priv->books_disabled_set);
         g_free (priv->variable_font);
         g_free (priv->fixed_font);
 
@@ -477,6 +511,10 @@ static void
 dh_settings_init (DhSettings *settings)
 {
         DhSettingsPrivate *priv = dh_settings_get_instance_private (settings);
+
+        g_queue_init (&priv->books_disabled);
+        priv->books_disabled_set = g_hash_table_new (g_str_hash, g_str_equal);
+
         priv->gsettings_desktop_interface = g_settings_new (SETTINGS_SCHEMA_ID_DESKTOP_INTERFACE);
 
         g_signal_connect_object (priv->gsettings_desktop_interface,
@@ -694,7 +732,7 @@ dh_settings_is_book_enabled (DhSettings *settings,
         g_return_val_if_fail (DH_IS_BOOK (book), FALSE);
 
         book_id = dh_book_get_id (book);
-        return find_in_books_disabled (settings, book_id) == NULL;
+        return !is_book_disabled (settings, book_id);
 }
 
 /**
@@ -720,10 +758,51 @@ dh_settings_set_book_enabled (DhSettings *settings,
 
         book_id = dh_book_get_id (book);
 
-        if (enabled)
-                enable_book (settings, book_id);
-        else
-                disable_book (settings, book_id);
+        if (enabled ? enable_book (settings, book_id) : disable_book (settings, book_id))
+                store_books_disabled (settings);
+}
+
+/**
+ * dh_settings_set_books_enabled:
+ * @settings: a #DhSettings.
+ * @books: (element-type DhBook): a list of #DhBook's.
+ * @enabled: the new value.
+ *
+ * Like dh_settings_set_book_enabled() for each book of @books, but the
+ * "books-disabled" #GSettings key is written only once, so the
+ * #DhSettings::books-disabled-changed signal is emitted at most once.
+ *
+ * Since: 3.32
+ */
+void
+dh_settings_set_books_enabled (DhSettings *settings,
+                               GList      *books,
+                               gboolean    enabled)
+{
+        gboolean changed = FALSE;
+        GList *l;
+
+        g_return_if_fail (DH_IS_SETTINGS (settings));
+
+        /* Before modifying anything, to not leave "books-disabled" out of
+         * sync with the books already enabled or disabled.
+         */
+        for (l = books; l != NULL; l = l->next)
+                g_return_if_fail (DH_IS_BOOK (l->data));
+
+        for (l = books; l != NULL; l = l->next) {
+                const gchar *book_id;
+
+                book_id = dh_book_get_id (l->data);
+
+                if (enabled)
+                        changed |= enable_book (settings, book_id);
+                else
+                        changed |= disable_book (settings, book_id);
+        }
+
+        if (changed)
+                store_books_disabled (settings);
 }
 
 /**
@@ -736,7 +815,8 @@ dh_settings_set_book_enabled (DhSettings *settings,
  * A bit like g_object_freeze_notify(), except that there is no freeze count.
  *
  * This function is useful if you call dh_settings_set_book_enabled() several
- * times in a row.
+ * times in a row. The "books-disabled" #GSettings key is then written only
+ * once, by dh_settings_thaw_books_disabled_changed().
  *
  * Since: 3.30
  */
@@ -749,6 +829,8 @@ dh_settings_freeze_books_disabled_changed (DhSettings *settings)
         g_signal_handlers_block_by_func (priv->gsettings_contents,
                                          books_disabled_changed_cb,
                                          settings);
+
+        priv->books_disabled_frozen = TRUE;
 }
 
 /**
@@ -768,6 +850,11 @@ dh_settings_thaw_books_disabled_changed (DhSettings *settings)
         DhSettingsPrivate *priv = dh_settings_get_instance_private (settings);
         g_return_if_fail (DH_IS_SETTINGS (settings));
 
+        /* Before unblocking, the signal is emitted below anyway. */
+        priv->books_disabled_frozen = FALSE;
+        if (priv->store_books_disabled_pending)
+                store_books_disabled (settings);
+
         g_signal_handlers_unblock_by_func (priv->gsettings_contents,
                                            books_disabled_changed_cb,
                                            settings);
@@ -57,6 +57,9 @@ gboolean     dh_settings_is_book_enabled               (DhSettings   *settings,
 void         dh_settings_set_book_enabled              (DhSettings   *settings,
                                                         DhBook       *book,
                                                         gboolean      enabled);
+void         dh_settings_set_books_enabled             (DhSettings   *settings,
+                                                        GList        *books,
+                                                        gboolean      enabled);
 void         dh_settings_freeze_books_disabled_changed (DhSettings   *settings);
 void         dh_settings_thaw_books_disabled_changed   (DhSettings   *settings);
 void         dh_settings_get_selected_fonts            (DhSettings   *settings,
@@ -27,6 +27,7 @@
 #include "dh-util-lib.h"
 #include "dh-sidebar.h"
 #include "dh-book-tree.h"
+#include "dh-completion-index.h"
 #include <devhelp/devhelp-vala.h>
 #include <src/dh-app.h>
 #include "dh-keyword-model.h"
@@ -141,14 +142,6 @@ dh_sidebar_set_property (GObject      *object,
 
 /******************************************************************************/
 
-static void set_model_cb(DhKeywordModel *model, gpointer user_data)
-{
-        DhSidebar *sidebar = DH_SIDEBAR (user_data);
-        DhSidebarPrivate *priv = dh_sidebar_get_instance_private (sidebar);
-        gtk_tree_view_set_model (priv->hitlist_view,
-                                 GTK_TREE_MODEL (model));
-}
-
 static gboolean
 search_idle_cb (gpointer user_data)
 {
@@ -157,7 +150,6 @@ search_idle_cb (gpointer user_data)
         const gchar *search_text;
         const gchar *book_id;
         DhLink *selected_link;
-        DhLink *exact_link;
 
         priv->idle_search_id = 0;
 
@@ -166,25 +158,29 @@ search_idle_cb (gpointer user_data)
         selected_link = dh_book_tree_get_selected_link (priv->book_tree);
         book_id = selected_link != NULL ? dh_link_get_book_id (selected_link) : NULL;
 
-        /* Disconnect the model, see the doc of dh_keyword_model_filter(). */
-        gtk_tree_view_set_model (priv->hitlist_view, NULL);
+        /* The exact match is selected in hitlist_filter_complete_cb(), the
+         * results may come later.
+         */
+        dh_keyword_model_filter (priv->hitlist_model,
+                                 search_text,
+                                 book_id,
+                                 priv->profile);
 
-        exact_link = dh_keyword_model_filter (priv->hitlist_model,
-                                              search_text,
-                                              book_id,
-                                              priv->profile);
+        if (selected_link != NULL)
+                dh_link_unref (selected_link);
 
-        g_signal_connect(priv->hitlist_model,
-                         "filter-complete", (GCallback)set_model_cb, sidebar);
+        return G_SOURCE_REMOVE;
+}
 
+static void
+hitlist_filter_complete_cb (DhKeywordModel *model,
+                            DhSidebar      *sidebar)
+{
+        DhLink *exact_link;
 
+        exact_link = _dh_keyword_model_get_exact_link (model);
         if (exact_link != NULL)
                 g_signal_emit (sidebar, signals[SIGNAL_LINK_SELECTED], 0, exact_link);
-
-        if (selected_link != NULL)
-                dh_link_unref (selected_link);
-
-        return G_SOURCE_REMOVE;
 }
 
 static void
@@ -198,43 +194,26 @@ setup_search_idle (DhSidebar *sidebar)
 
 /******************************************************************************/
 
-/* Create DhCompletion objects, because if all the DhCompletion objects need to
- * be created (synchronously) at the time of the first completion, it can make
- * the GUI not responsive (measured time was for example 40ms to create the
- * DhCompletion's for 17 books, which is not a lot of books). On application
- * startup it is less a problem.
+/* Start merging the completion strings of the books in the background as soon
+ * as the books change, so that they are ready for the next completion. Building
+ * them synchronously on the main thread made the GUI not responsive (measured
+ * time was for example 40ms for 17 books, which is not a lot of books).
  */
 static void
-create_completion_objects (DhBookList *book_list)
+update_completion_index (DhSidebar *sidebar)
 {
-        GList *books;
-        GList *l;
-
-        books = dh_book_list_get_books (book_list);
+        DhSidebarPrivate *priv = dh_sidebar_get_instance_private (sidebar);
 
-        for (l = books; l != NULL; l = l->next) {
-                DhBook *cur_book = DH_BOOK (l->data);
-                dh_book_get_completion (cur_book);
-        }
+        _dh_completion_index_update (_dh_profile_get_completion_index (priv->profile));
 }
 
 static void
-add_book_cb (DhBookList *book_list,
-             DhBook     *book,
-             DhSidebar  *sidebar)
+books_changed_cb (DhBookList *book_list,
+                  DhSidebar  *sidebar)
 {
-        /* See comment of create_completion_objects(). */
-        dh_book_get_completion (book);
-
-        /* Update current search if any. */
-        setup_search_idle (sidebar);
-}
+        /* See comment of update_completion_index(). */
+        update_completion_index (sidebar);
 
-static void
-remove_book_cb (DhBookList *book_list,
-                DhBook     *book,
-                DhSidebar  *sidebar)
-{
         /* Update current search if any. */
         setup_search_idle (sidebar);
 }
@@ -337,23 +316,12 @@ complete_idle_cb (gpointer user_data)
 {
         DhSidebar *sidebar = DH_SIDEBAR (user_data);
         DhSidebarPrivate *priv = dh_sidebar_get_instance_private (sidebar);
-        GList *books;
-        GList *l;
-        GList *completion_objects = NULL;
         const gchar *search_text;
         gchar *completed;
 
-        books = dh_book_list_get_books (dh_profile_get_book_list (priv->profile));
-        for (l = books; l != NULL; l = l->next) {
-                DhBook *cur_book = DH_BOOK (l->data);
-                DhCompletion *completion;
-
-                completion = dh_book_get_completion (cur_book);
-                completion_objects = g_list_prepend (completion_objects, completion);
-        }
-
         search_text = gtk_entry_get_text (priv->entry);
-        completed = dh_completion_aggregate_complete (completion_objects, search_text);
+        completed = _dh_completion_index_complete (_dh_profile_get_completion_index (priv->profile),
+                                                   search_text);
 
         if (completed != NULL) {
                 guint16 n_chars_before;
@@ -366,7 +334,6 @@ complete_idle_cb (gpointer user_data)
                                             n_chars_before, -1);
         }
 
-        g_list_free (completion_objects);
         g_free (completed);
 
         priv->idle_complete_id = 0;
@@ -449,41 +416,6 @@ hitlist_cell_data_func (GtkTreeViewColumn *tree_column,
         g_free (name);
 }
 
-static void
-hitlist_cell_icon_func (GtkTreeViewColumn *tree_column,
-                        GtkCellRenderer   *cell,
-                        GtkTreeModel      *hitlist_model,
-                        GtkTreeIter       *iter,
-                        gpointer           data)
-{
-        DhLink *link;
-        DhLinkType link_type;
-        PangoStyle style;
-        PangoWeight weight;
-        gboolean current_book_flag;
-        DhSidebarPrivate *priv = dh_sidebar_get_instance_private (DH_SIDEBAR (data));
-
-        GList *books = dh_book_list_get_books (dh_profile_get_book_list (priv->profile));
-
-        DhBook *book;
-
-        gtk_tree_model_get (hitlist_model, iter,
-                            DH_KEYWORD_MODEL_COL_LINK, &link,
-                            -1);
-
-        while (books) {
-                book = books->data;
-                if (g_str_equal(dh_link_get_book_title (link), dh_book_get_title (book))) {
-                        break;
-                }
-                books = books->next;
-        }
-
-        g_object_set (cell, "surface", dh_book_get_icon_surface(book), NULL);
-
-        dh_link_unref (link);
-}
-
 static void
 book_tree_link_selected_cb (DhBookTree *book_tree,
                             DhLink     *link,
@@ -499,6 +431,7 @@ static void group_selected_cb (DhProfileChooser* chooser,
 {
         DhSidebarPrivate *priv = dh_sidebar_get_instance_private (sidebar);
         dh_keyword_model_set_group_id(priv->hitlist_model, id);
+        _dh_keyword_model_set_group_docsets (priv->hitlist_model, comma_separated_docs);
         dh_book_tree_set_filter(priv->book_tree, comma_separated_docs);
         setup_search_idle (sidebar);
 }
@@ -555,6 +488,11 @@ dh_sidebar_constructed (GObject *object)
 
         /* Setup hitlist */
         priv->hitlist_model = dh_keyword_model_new ();
+        g_signal_connect_object (priv->hitlist_model,
+                                 "filter-complete",
+                                 G_CALLBACK (hitlist_filter_complete_cb),
+                                 sidebar,
+                                 0);
         priv->hitlist_view = GTK_TREE_VIEW (gtk_tree_view_new ());
         gtk_tree_view_set_model (priv->hitlist_view, GTK_TREE_MODEL (priv->hitlist_model));
         gtk_tree_view_set_headers_visible (priv->hitlist_view, FALSE);
@@ -579,13 +517,12 @@ dh_sidebar_constructed (GObject *object)
                       "ellipsize", PANGO_ELLIPSIZE_END,
                       NULL);
         cell2 = gtk_cell_renderer_pixbuf_new ();
-        gtk_tree_view_insert_column_with_data_func (priv->hitlist_view,
-                                                    -1,
-                                                    NULL,
-                                                    cell2,
-                                                    hitlist_cell_icon_func,
-                                                    sidebar,
-                                                    NULL);
+        gtk_tree_view_insert_column_with_attributes (priv->hitlist_view,
+                                                     -1,
+                                                     NULL,
+                                                     cell2,
+                                                     "surface", DH_KEYWORD_MODEL_COL_BOOK_ICON,
+                                                     NULL);
         gtk_tree_view_insert_column_with_data_func (priv->hitlist_view,
                                                     -1,
                                                     NULL,
@@ -608,19 +545,13 @@ dh_sidebar_constructed (GObject *object)
 
         /* DhBookList */
         book_list = dh_profile_get_book_list (priv->profile);
-        create_completion_objects (book_list);
-
-        g_signal_connect_object (book_list,
-                                 "add-book",
-                                 G_CALLBACK (add_book_cb),
-                                 sidebar,
-                                 G_CONNECT_AFTER);
+        update_completion_index (sidebar);
 
         g_signal_connect_object (book_list,
-                                 "remove-book",
-                                 G_CALLBACK (remove_book_cb),
+                                 "books-changed",
+                                 G_CALLBACK (books_changed_cb),
                                  sidebar,
-                                 G_CONNECT_AFTER);
+                                 0);
 
         /* Setup the book tree */
         priv->sw_book_tree = GTK_SCROLLED_WINDOW (gtk_scrolled_window_new (NULL, NULL));
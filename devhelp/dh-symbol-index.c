@@ -0,0 +1,829 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dh-symbol-index.h"
+#include <string.h>
+#include <json-glib/json-glib.h>
+#include <libsoup/soup.h>
+#include "dh-core-client.h"
+#include "dh-json-array-reader.h"
+
+/* The symbols of all the docsets, fetched from zealcore in a worker thread
+ * with the same requests as the "Symbols" nodes of the #DhBookTreeModel, then
+ * kept in a compact form:
+ *
+ * - the names, sorted case-insensitively, in one block of NUL-terminated
+ *   strings, and their ASCII lowercase copy at the same offsets;
+ * - the paths in another block;
+ * - the docset and the type of each symbol as 16-bit indexes in small tables;
+ * - the symbols grouped by docset, to get the names of one docset.
+ *
+ * The prefix matches are found with a binary search in the sorted names, and
+ * the substring matches with a single scan of the lowercase block, so a query
+ * doesn't allocate anything per symbol.
+ */
+
+typedef struct {
+        /* Offsets in DhSymbolIndexBuilder::strings. */
+        guint32 name;
+        guint32 path;
+
+        guint16 docset;
+        guint16 type;
+} Entry;
+
+struct _DhSymbolIndexBuilder {
+        /* The names and the paths, NUL-terminated. */
+        GString *strings;
+
+        /* Element-type: Entry. */
+        GArray *entries;
+
+        /* Owned gchar*. */
+        GPtrArray *docset_ids;
+        GPtrArray *docset_names;
+        GPtrArray *types;
+
+        /* Type name (borrowed from types) -> index in types + 1. */
+        GHashTable *type_indices;
+};
+
+struct _DhSymbolIndex {
+        volatile gint ref_count;
+
+        guint n_symbols;
+
+        /* n_symbols + 1 offsets, the last one is names_length. */
+        guint32 *name_offsets;
+        gchar *names;
+        gchar *folded_names;
+        gsize names_length;
+
+        guint32 *path_offsets;
+        gchar *paths;
+
+        guint16 *docsets;
+        guint16 *types;
+
+        /* The symbols of docset i are docset_symbols[docset_symbol_offsets[i]]
+         * to docset_symbols[docset_symbol_offsets[i + 1] - 1], in sorted order.
+         */
+        guint32 *docset_symbol_offsets;
+        guint32 *docset_symbols;
+
+        /* Owned gchar*. */
+        GPtrArray *docset_ids;
+        GPtrArray *docset_names;
+        GPtrArray *type_names;
+
+        /* Docset ID (borrowed from docset_ids) -> index in docset_ids + 1. */
+        GHashTable *docset_indices;
+};
+
+/**
+ * _dh_symbol_index_is_enabled:
+ *
+ * Returns: %TRUE if the symbol index is enabled with %DH_SYMBOL_INDEX_ENV.
+ */
+gboolean
+_dh_symbol_index_is_enabled (void)
+{
+        return g_strcmp0 (g_getenv (DH_SYMBOL_INDEX_ENV), "1") == 0;
+}
+
+DhSymbolIndexBuilder *
+_dh_symbol_index_builder_new (void)
+{
+        DhSymbolIndexBuilder *builder;
+
+        builder = g_new0 (DhSymbolIndexBuilder, 1);
+        builder->strings = g_string_new (NULL);
+        builder->entries = g_array_new (FALSE, FALSE, sizeof (Entry));
+        builder->docset_ids = g_ptr_array_new_with_free_func (g_free);
+        builder->docset_names = g_ptr_array_new_with_free_func (g_free);
+        builder->types = g_ptr_array_new_with_free_func (g_free);
+        builder->type_indices = g_hash_table_new (g_str_hash, g_str_equal);
+
+        return builder;
+}
+
+void
+_dh_symbol_index_builder_free (DhSymbolIndexBuilder *builder)
+{
+        if (builder == NULL)
+                return;
+
+        g_string_free (builder->strings, TRUE);
+        g_array_unref (builder->entries);
+        g_clear_pointer (&builder->docset_ids, g_ptr_array_unref);
+        g_clear_pointer (&builder->docset_names, g_ptr_array_unref);
+        g_clear_pointer (&builder->types, g_ptr_array_unref);
+        g_hash_table_unref (builder->type_indices);
+        g_free (builder);
+}
+
+/**
+ * _dh_symbol_index_builder_add_docset:
+ * @builder: a #DhSymbolIndexBuilder.
+ * @docset_id: the ID of the docset.
+ * @docset_name: the title of the docset.
+ *
+ * Starts a new docset, the next symbols added belong to it.
+ *
+ * Returns: %FALSE if there are too many docsets.
+ */
+gboolean
+_dh_symbol_index_builder_add_docset (DhSymbolIndexBuilder *builder,
+                                     const gchar          *docset_id,
+                                     const gchar          *docset_name)
+{
+        g_return_val_if_fail (builder != NULL, FALSE);
+        g_return_val_if_fail (docset_id != NULL, FALSE);
+
+        if (builder->docset_ids->len > G_MAXUINT16)
+                return FALSE;
+
+        g_ptr_array_add (builder->docset_ids, g_strdup (docset_id));
+        g_ptr_array_add (builder->docset_names, g_strdup (docset_name != NULL ? docset_name : docset_id));
+
+        return TRUE;
+}
+
+static gboolean
+append_string (DhSymbolIndexBuilder *builder,
+               const gchar          *str,
+               guint32              *offset)
+{
+        gsize length = strlen (str);
+
+        if (builder->strings->len + length + 1 > G_MAXUINT32)
+                return FALSE;
+
+        *offset = builder->strings->len;
+        g_string_append_len (builder->strings, str, length + 1);
+
+        return TRUE;
+}
+
+static guint16
+get_type_index (DhSymbolIndexBuilder *builder,
+                const gchar          *type)
+{
+        gpointer value;
+        gchar *type_copy;
+
+        value = g_hash_table_lookup (builder->type_indices, type);
+        if (value != NULL)
+                return GPOINTER_TO_UINT (value) - 1;
+
+        /* Unlikely, the last type is used for the extra ones. */
+        if (builder->types->len > G_MAXUINT16)
+                return G_MAXUINT16;
+
+        type_copy = g_strdup (type);
+        g_ptr_array_add (builder->types, type_copy);
+        g_hash_table_insert (builder->type_indices, type_copy, GUINT_TO_POINTER (builder->types->len));
+
+        return builder->types->len - 1;
+}
+
+/**
+ * _dh_symbol_index_builder_add_symbol:
+ * @builder: a #DhSymbolIndexBuilder.
+ * @name: the name of the symbol.
+ * @type: the type of the symbol, e.g. "Function".
+ * @path: the path of the symbol on zealcore.
+ *
+ * Adds a symbol to the last docset added.
+ */
+void
+_dh_symbol_index_builder_add_symbol (DhSymbolIndexBuilder *builder,
+                                     const gchar          *name,
+                                     const gchar          *type,
+                                     const gchar          *path)
+{
+        Entry entry;
+
+        g_return_if_fail (builder != NULL);
+        g_return_if_fail (builder->docset_ids->len > 0);
+        g_return_if_fail (name != NULL);
+        g_return_if_fail (type != NULL);
+        g_return_if_fail (path != NULL);
+
+        if (!append_string (builder, name, &entry.name) ||
+            !append_string (builder, path, &entry.path)) {
+                return;
+        }
+
+        entry.docset = builder->docset_ids->len - 1;
+        entry.type = get_type_index (builder, type);
+
+        g_array_append_val (builder->entries, entry);
+}
+
+static gint
+compare_entries (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+        const Entry *entry_a = a;
+        const Entry *entry_b = b;
+        const gchar *strings = user_data;
+        gint ret;
+
+        ret = g_ascii_strcasecmp (strings + entry_a->name, strings + entry_b->name);
+        if (ret != 0)
+                return ret;
+
+        ret = strcmp (strings + entry_a->name, strings + entry_b->name);
+        if (ret != 0)
+                return ret;
+
+        return (gint) entry_a->docset - (gint) entry_b->docset;
+}
+
+/**
+ * _dh_symbol_index_builder_end:
+ * @builder: (transfer full): a #DhSymbolIndexBuilder.
+ *
+ * Sorts the symbols added to @builder, and frees @builder.
+ *
+ * Returns: (transfer full): the new #DhSymbolIndex.
+ */
+DhSymbolIndex *
+_dh_symbol_index_builder_end (DhSymbolIndexBuilder *builder)
+{
+        DhSymbolIndex *index;
+        const gchar *strings;
+        gsize names_length = 0;
+        gsize paths_length = 0;
+        guint32 *next_docset_symbols;
+        guint i;
+
+        g_return_val_if_fail (builder != NULL, NULL);
+
+        strings = builder->strings->str;
+        g_array_sort_with_data (builder->entries, compare_entries, (gpointer) strings);
+
+        index = g_new0 (DhSymbolIndex, 1);
+        index->ref_count = 1;
+        index->n_symbols = builder->entries->len;
+
+        for (i = 0; i < index->n_symbols; i++) {
+                const Entry *entry = &g_array_index (builder->entries, Entry, i);
+
+                names_length += strlen (strings + entry->name) + 1;
+                paths_length += strlen (strings + entry->path) + 1;
+        }
+
+        index->names_length = names_length;
+        index->name_offsets = g_new (guint32, index->n_symbols + 1);
+        index->names = g_malloc (names_length + 1);
+        index->folded_names = g_malloc (names_length + 1);
+        index->path_offsets = g_new (guint32, index->n_symbols);
+        index->paths = g_malloc (paths_length + 1);
+        index->docsets = g_new (guint16, index->n_symbols);
+        index->types = g_new (guint16, index->n_symbols);
+
+        names_length = 0;
+        paths_length = 0;
+
+        for (i = 0; i < index->n_symbols; i++) {
+                const Entry *entry = &g_array_index (builder->entries, Entry, i);
+                const gchar *name = strings + entry->name;
+                const gchar *path = strings + entry->path;
+                gsize length;
+                gsize j;
+
+                length = strlen (name) + 1;
+                index->name_offsets[i] = names_length;
+                memcpy (index->names + names_length, name, length);
+                for (j = 0; j < length; j++)
+                        index->folded_names[names_length + j] = g_ascii_tolower (name[j]);
+                names_length += length;
+
+                length = strlen (path) + 1;
+                index->path_offsets[i] = paths_length;
+                memcpy (index->paths + paths_length, path, length);
+                paths_length += length;
+
+                index->docsets[i] = entry->docset;
+                index->types[i] = entry->type;
+        }
+
+        index->name_offsets[index->n_symbols] = names_length;
+
+        /* So that the blocks are valid even if there is no symbol. */
+        index->names[names_length] = '\0';
+        index->folded_names[names_length] = '\0';
+        index->paths[paths_length] = '\0';
+
+        index->docset_ids = g_steal_pointer (&builder->docset_ids);
+        index->docset_names = g_steal_pointer (&builder->docset_names);
+        index->type_names = g_steal_pointer (&builder->types);
+
+        /* Counting sort of the symbols by docset. */
+        index->docset_symbol_offsets = g_new0 (guint32, index->docset_ids->len + 1);
+        index->docset_symbols = g_new (guint32, index->n_symbols);
+
+        for (i = 0; i < index->n_symbols; i++)
+                index->docset_symbol_offsets[index->docsets[i] + 1]++;
+        for (i = 0; i < index->docset_ids->len; i++)
+                index->docset_symbol_offsets[i + 1] += index->docset_symbol_offsets[i];
+
+        next_docset_symbols = g_new (guint32, index->docset_ids->len + 1);
+        memcpy (next_docset_symbols,
+                index->docset_symbol_offsets,
+                sizeof (guint32) * (index->docset_ids->len + 1));
+
+        for (i = 0; i < index->n_symbols; i++)
+                index->docset_symbols[next_docset_symbols[index->docsets[i]]++] = i;
+
+        g_free (next_docset_symbols);
+
+        index->docset_indices = g_hash_table_new (g_str_hash, g_str_equal);
+        for (i = 0; i < index->docset_ids->len; i++) {
+                g_hash_table_insert (index->docset_indices,
+                                     g_ptr_array_index (index->docset_ids, i),
+                                     GUINT_TO_POINTER (i + 1));
+        }
+
+        _dh_symbol_index_builder_free (builder);
+
+        return index;
+}
+
+DhSymbolIndex *
+_dh_symbol_index_ref (DhSymbolIndex *index)
+{
+        g_return_val_if_fail (index != NULL, NULL);
+
+        g_atomic_int_inc (&index->ref_count);
+
+        return index;
+}
+
+void
+_dh_symbol_index_unref (DhSymbolIndex *index)
+{
+        if (index == NULL)
+                return;
+
+        if (!g_atomic_int_dec_and_test (&index->ref_count))
+                return;
+
+        g_free (index->name_offsets);
+        g_free (index->names);
+        g_free (index->folded_names);
+        g_free (index->path_offsets);
+        g_free (index->paths);
+        g_free (index->docsets);
+        g_free (index->types);
+        g_free (index->docset_symbol_offsets);
+        g_free (index->docset_symbols);
+        g_hash_table_unref (index->docset_indices);
+        g_ptr_array_unref (index->docset_ids);
+        g_ptr_array_unref (index->docset_names);
+        g_ptr_array_unref (index->type_names);
+        g_free (index);
+}
+
+guint
+_dh_symbol_index_get_n_symbols (DhSymbolIndex *index)
+{
+        g_return_val_if_fail (index != NULL, 0);
+
+        return index->n_symbols;
+}
+
+/* Returns the first symbol whose lowercase name is not before @folded. */
+static guint
+lower_bound (DhSymbolIndex *index,
+             const gchar   *folded)
+{
+        guint low = 0;
+        guint high = index->n_symbols;
+
+        while (low < high) {
+                guint middle = low + (high - low) / 2;
+
+                if (strcmp (index->folded_names + index->name_offsets[middle], folded) < 0)
+                        low = middle + 1;
+                else
+                        high = middle;
+        }
+
+        return low;
+}
+
+/* Returns the symbol whose name contains the byte at @offset. */
+static guint
+find_symbol_at (DhSymbolIndex *index,
+                gsize          offset)
+{
+        guint low = 0;
+        guint high = index->n_symbols;
+
+        while (high - low > 1) {
+                guint middle = low + (high - low) / 2;
+
+                if (index->name_offsets[middle] <= offset)
+                        low = middle;
+                else
+                        high = middle;
+        }
+
+        return low;
+}
+
+static const gchar *
+find_substring (const gchar *haystack,
+                gsize        haystack_length,
+                const gchar *needle,
+                gsize        needle_length)
+{
+        const gchar *end = haystack + haystack_length;
+        const gchar *p = haystack;
+
+        while ((gsize) (end - p) >= needle_length) {
+                p = memchr (p, needle[0], end - p - needle_length + 1);
+                if (p == NULL)
+                        return NULL;
+
+                if (memcmp (p + 1, needle + 1, needle_length - 1) == 0)
+                        return p;
+
+                p++;
+        }
+
+        return NULL;
+}
+
+static gboolean *
+new_docset_mask (DhSymbolIndex       *index,
+                 const gchar * const *docset_ids)
+{
+        GHashTable *wanted;
+        gboolean *mask;
+        guint i;
+
+        /* A profile can have hundreds of docsets. */
+        wanted = g_hash_table_new (g_str_hash, g_str_equal);
+        for (i = 0; docset_ids[i] != NULL; i++)
+                g_hash_table_add (wanted, (gpointer) docset_ids[i]);
+
+        mask = g_new0 (gboolean, index->docset_ids->len);
+
+        for (i = 0; i < index->docset_ids->len; i++) {
+                const gchar *docset_id = g_ptr_array_index (index->docset_ids, i);
+
+                mask[i] = g_hash_table_contains (wanted, docset_id);
+        }
+
+        g_hash_table_unref (wanted);
+        return mask;
+}
+
+/**
+ * _dh_symbol_index_search:
+ * @index: a #DhSymbolIndex.
+ * @keyword: the string to search, case-insensitively for the ASCII letters.
+ * @docset_ids: (nullable): the IDs of the docsets to search in, or %NULL for
+ *   all the docsets.
+ * @max_hits: the maximum number of symbols to return.
+ *
+ * Returns: (transfer full) (element-type guint): the symbols whose name starts
+ * with @keyword, in alphabetical order, followed by the symbols whose name
+ * contains @keyword elsewhere.
+ */
+GArray *
+_dh_symbol_index_search (DhSymbolIndex       *index,
+                         const gchar         *keyword,
+                         const gchar * const *docset_ids,
+                         guint                max_hits)
+{
+        GArray *hits;
+        gboolean *docset_mask = NULL;
+        gchar *folded;
+        gsize length;
+        const gchar *names_end;
+        const gchar *p;
+        guint i;
+
+        g_return_val_if_fail (index != NULL, NULL);
+        g_return_val_if_fail (keyword != NULL, NULL);
+
+        hits = g_array_new (FALSE, FALSE, sizeof (guint));
+
+        folded = g_ascii_strdown (keyword, -1);
+        length = strlen (folded);
+
+        if (length == 0 || max_hits == 0)
+                goto out;
+
+        if (docset_ids != NULL)
+                docset_mask = new_docset_mask (index, docset_ids);
+
+        /* The prefix matches are contiguous in the sorted names. */
+        for (i = lower_bound (index, folded); i < index->n_symbols && hits->len < max_hits; i++) {
+                if (strncmp (index->folded_names + index->name_offsets[i], folded, length) != 0)
+                        break;
+
+                if (docset_mask == NULL || docset_mask[index->docsets[i]])
+                        g_array_append_val (hits, i);
+        }
+
+        /* The other matches, skipping to the next name after each one. */
+        names_end = index->folded_names + index->names_length;
+        p = index->folded_names;
+
+        while (hits->len < max_hits &&
+               (p = find_substring (p, names_end - p, folded, length)) != NULL) {
+                gsize offset = p - index->folded_names;
+
+                i = find_symbol_at (index, offset);
+
+                /* Not a prefix match, already found above. */
+                if (offset != index->name_offsets[i] &&
+                    (docset_mask == NULL || docset_mask[index->docsets[i]])) {
+                        g_array_append_val (hits, i);
+                }
+
+                p = index->folded_names + index->name_offsets[i + 1];
+        }
+
+out:
+        g_free (docset_mask);
+        g_free (folded);
+        return hits;
+}
+
+const gchar *
+_dh_symbol_index_get_name (DhSymbolIndex *index,
+                           guint          symbol)
+{
+        g_return_val_if_fail (index != NULL, NULL);
+        g_return_val_if_fail (symbol < index->n_symbols, NULL);
+
+        return index->names + index->name_offsets[symbol];
+}
+
+const gchar *
+_dh_symbol_index_get_type_name (DhSymbolIndex *index,
+                                guint          symbol)
+{
+        g_return_val_if_fail (index != NULL, NULL);
+        g_return_val_if_fail (symbol < index->n_symbols, NULL);
+
+        return g_ptr_array_index (index->type_names, index->types[symbol]);
+}
+
+const gchar *
+_dh_symbol_index_get_path (DhSymbolIndex *index,
+                           guint          symbol)
+{
+        g_return_val_if_fail (index != NULL, NULL);
+        g_return_val_if_fail (symbol < index->n_symbols, NULL);
+
+        return index->paths + index->path_offsets[symbol];
+}
+
+const gchar *
+_dh_symbol_index_get_docset_id (DhSymbolIndex *index,
+                                guint          symbol)
+{
+        g_return_val_if_fail (index != NULL, NULL);
+        g_return_val_if_fail (symbol < index->n_symbols, NULL);
+
+        return g_ptr_array_index (index->docset_ids, index->docsets[symbol]);
+}
+
+const gchar *
+_dh_symbol_index_get_docset_name (DhSymbolIndex *index,
+                                  guint          symbol)
+{
+        g_return_val_if_fail (index != NULL, NULL);
+        g_return_val_if_fail (symbol < index->n_symbols, NULL);
+
+        return g_ptr_array_index (index->docset_names, index->docsets[symbol]);
+}
+
+/**
+ * _dh_symbol_index_get_docset_symbols:
+ * @index: a #DhSymbolIndex.
+ * @docset_id: the ID of a docset.
+ * @n_symbols: (out): the number of symbols returned.
+ *
+ * Returns: (transfer none) (nullable): the symbols of @docset_id, in sorted
+ * order, or %NULL if @docset_id is not in @index.
+ */
+const guint32 *
+_dh_symbol_index_get_docset_symbols (DhSymbolIndex *index,
+                                     const gchar   *docset_id,
+                                     guint         *n_symbols)
+{
+        guint docset;
+
+        g_return_val_if_fail (index != NULL, NULL);
+        g_return_val_if_fail (docset_id != NULL, NULL);
+        g_return_val_if_fail (n_symbols != NULL, NULL);
+
+        *n_symbols = 0;
+
+        docset = GPOINTER_TO_UINT (g_hash_table_lookup (index->docset_indices, docset_id));
+        if (docset == 0)
+                return NULL;
+        docset--;
+
+        *n_symbols = index->docset_symbol_offsets[docset + 1] - index->docset_symbol_offsets[docset];
+
+        return index->docset_symbols + index->docset_symbol_offsets[docset];
+}
+
+/* Adds the symbols of one type of a docset, the response is an array of
+ * [name, path] pairs.
+ */
+static gboolean
+fetch_symbols (DhSymbolIndexBuilder  *builder,
+               const gchar           *docset_id,
+               const gchar           *type,
+               GCancellable          *cancellable,
+               GError               **error)
+{
+        SoupMessage *msg;
+        GInputStream *stream;
+        DhJsonArrayReader *reader;
+        JsonNode *element;
+        gchar *escaped_type;
+        gchar *path;
+        GError *local_error = NULL;
+
+        escaped_type = g_uri_escape_string (type, NULL, FALSE);
+        path = g_strdup_printf ("item/%s/symbols/%s", docset_id, escaped_type);
+        msg = _dh_core_client_new_message ("GET", path);
+        g_free (escaped_type);
+        g_free (path);
+
+        stream = _dh_core_client_send_in_worker (msg, cancellable, error);
+        if (stream == NULL) {
+                g_object_unref (msg);
+                return FALSE;
+        }
+
+        if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
+                g_set_error (error,
+                             G_IO_ERROR,
+                             G_IO_ERROR_FAILED,
+                             "Failed to get the symbols of “%s”: %s",
+                             docset_id,
+                             msg->reason_phrase);
+                g_object_unref (stream);
+                g_object_unref (msg);
+                return FALSE;
+        }
+
+        reader = _dh_json_array_reader_new (stream);
+
+        while ((element = _dh_json_array_reader_next (reader, cancellable, &local_error)) != NULL) {
+                if (JSON_NODE_HOLDS_ARRAY (element)) {
+                        JsonArray *pair = json_node_get_array (element);
+
+                        if (json_array_get_length (pair) >= 2) {
+                                _dh_symbol_index_builder_add_symbol (builder,
+                                                                     json_array_get_string_element (pair, 0),
+                                                                     type,
+                                                                     json_array_get_string_element (pair, 1));
+                        }
+                }
+
+                json_node_free (element);
+        }
+
+        _dh_json_array_reader_free (reader);
+        g_object_unref (stream);
+        g_object_unref (msg);
+
+        if (local_error != NULL) {
+                g_propagate_error (error, local_error);
+                return FALSE;
+        }
+
+        return TRUE;
+}
+
+static void
+build_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+        DhCatalog *catalog = task_data;
+        DhSymbolIndexBuilder *builder;
+        guint i;
+
+        builder = _dh_symbol_index_builder_new ();
+
+        for (i = 0; i < _dh_catalog_get_n_docsets (catalog); i++) {
+                JsonObject *docset = _dh_catalog_get_docset (catalog, i);
+                JsonNode *counts_node;
+                const gchar *docset_id;
+                GList *types;
+                GList *l;
+                GError *error = NULL;
+
+                docset_id = json_object_get_string_member (docset, "Id");
+                counts_node = json_object_get_member (docset, "SymbolCounts");
+                if (docset_id == NULL || counts_node == NULL || !JSON_NODE_HOLDS_OBJECT (counts_node))
+                        continue;
+
+                if (!_dh_symbol_index_builder_add_docset (builder,
+                                                          docset_id,
+                                                          json_object_get_string_member (docset, "Title"))) {
+                        break;
+                }
+
+                types = json_object_get_members (json_node_get_object (counts_node));
+
+                for (l = types; l != NULL; l = l->next) {
+                        if (!fetch_symbols (builder, docset_id, l->data, cancellable, &error))
+                                break;
+                }
+
+                g_list_free (types);
+
+                /* An incomplete index would hide results, zealcore is used
+                 * instead.
+                 */
+                if (error != NULL) {
+                        _dh_symbol_index_builder_free (builder);
+                        g_task_return_error (task, error);
+                        return;
+                }
+        }
+
+        g_task_return_pointer (task,
+                               _dh_symbol_index_builder_end (builder),
+                               (GDestroyNotify) _dh_symbol_index_unref);
+}
+
+/**
+ * _dh_symbol_index_build_async:
+ * @catalog: the #DhCatalog of the docsets to index.
+ * @cancellable: (nullable): a #GCancellable.
+ * @callback: the function to call when the index is built.
+ * @user_data: the data to pass to @callback.
+ *
+ * Fetches the symbols of all the docsets of @catalog from zealcore and builds
+ * the index, in a worker thread. There is one request per type of symbol of
+ * each docset.
+ */
+void
+_dh_symbol_index_build_async (DhCatalog           *catalog,
+                              GCancellable        *cancellable,
+                              GAsyncReadyCallback  callback,
+                              gpointer             user_data)
+{
+        GTask *task;
+
+        g_return_if_fail (catalog != NULL);
+        g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+        task = g_task_new (NULL, cancellable, callback, user_data);
+        g_task_set_source_tag (task, _dh_symbol_index_build_async);
+        g_task_set_task_data (task, _dh_catalog_ref (catalog), (GDestroyNotify) _dh_catalog_unref);
+        g_task_run_in_thread (task, build_thread);
+        g_object_unref (task);
+}
+
+/**
+ * _dh_symbol_index_build_finish:
+ * @result: a #GAsyncResult.
+ * @error: location to a %NULL #GError, or %NULL.
+ *
+ * Returns: (transfer full) (nullable): the new #DhSymbolIndex, or %NULL on
+ * error.
+ */
+DhSymbolIndex *
+_dh_symbol_index_build_finish (GAsyncResult  *result,
+                               GError       **error)
+{
+        g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+        g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+        return g_task_propagate_pointer (G_TASK (result), error);
+}
@@ -0,0 +1,120 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include "dh-book-list-directory.h"
+#include "dh-catalog.h"
+
+G_BEGIN_DECLS
+
+/* The environment variable to enable the in-process symbol index, when set to
+ * "1". Otherwise the searches are all sent to zealcore.
+ *
+ * The index is off by default: it is built at each startup, and its build
+ * fetches the symbols of every type of every docset from zealcore, which is
+ * thousands of requests with hundreds of docsets installed.
+ */
+#define DH_SYMBOL_INDEX_ENV "ZEVDOCS_SYMBOL_INDEX"
+
+/* DhSymbolIndex is an immutable, in-process index of the symbols of all the
+ * docsets, to answer the searches without a round-trip to zealcore.
+ */
+typedef struct _DhSymbolIndex           DhSymbolIndex;
+typedef struct _DhSymbolIndexBuilder    DhSymbolIndexBuilder;
+
+G_GNUC_INTERNAL
+gboolean                _dh_symbol_index_is_enabled             (void);
+
+G_GNUC_INTERNAL
+DhSymbolIndexBuilder *  _dh_symbol_index_builder_new            (void);
+
+G_GNUC_INTERNAL
+void                    _dh_symbol_index_builder_free           (DhSymbolIndexBuilder *builder);
+
+G_GNUC_INTERNAL
+gboolean                _dh_symbol_index_builder_add_docset     (DhSymbolIndexBuilder *builder,
+                                                                 const gchar          *docset_id,
+                                                                 const gchar          *docset_name);
+
+G_GNUC_INTERNAL
+void                    _dh_symbol_index_builder_add_symbol     (DhSymbolIndexBuilder *builder,
+                                                                 const gchar          *name,
+                                                                 const gchar          *type,
+                                                                 const gchar          *path);
+
+G_GNUC_INTERNAL
+DhSymbolIndex *         _dh_symbol_index_builder_end            (DhSymbolIndexBuilder *builder);
+
+G_GNUC_INTERNAL
+void                    _dh_symbol_index_build_async            (DhCatalog            *catalog,
+                                                                 GCancellable         *cancellable,
+                                                                 GAsyncReadyCallback   callback,
+                                                                 gpointer              user_data);
+
+G_GNUC_INTERNAL
+DhSymbolIndex *         _dh_symbol_index_build_finish           (GAsyncResult         *result,
+                                                                 GError              **error);
+
+G_GNUC_INTERNAL
+DhSymbolIndex *         _dh_symbol_index_ref                    (DhSymbolIndex        *index);
+
+G_GNUC_INTERNAL
+void                    _dh_symbol_index_unref                  (DhSymbolIndex        *index);
+
+G_GNUC_INTERNAL
+guint                   _dh_symbol_index_get_n_symbols          (DhSymbolIndex        *index);
+
+G_GNUC_INTERNAL
+GArray *                _dh_symbol_index_search                 (DhSymbolIndex        *index,
+                                                                 const gchar          *keyword,
+                                                                 const gchar * const  *docset_ids,
+                                                                 guint                 max_hits);
+
+G_GNUC_INTERNAL
+const gchar *           _dh_symbol_index_get_name               (DhSymbolIndex        *index,
+                                                                 guint                 symbol);
+
+G_GNUC_INTERNAL
+const gchar *           _dh_symbol_index_get_type_name          (DhSymbolIndex        *index,
+                                                                 guint                 symbol);
+
+G_GNUC_INTERNAL
+const gchar *           _dh_symbol_index_get_path               (DhSymbolIndex        *index,
+                                                                 guint                 symbol);
+
+G_GNUC_INTERNAL
+const gchar *           _dh_symbol_index_get_docset_id          (DhSymbolIndex        *index,
+                                                                 guint                 symbol);
+
+G_GNUC_INTERNAL
+const gchar *           _dh_symbol_index_get_docset_name        (DhSymbolIndex        *index,
+                                                                 guint                 symbol);
+
+G_GNUC_INTERNAL
+const guint32 *         _dh_symbol_index_get_docset_symbols     (DhSymbolIndex        *index,
+                                                                 const gchar          *docset_id,
+                                                                 guint                *n_symbols);
+
+/* Implemented in dh-book-list-directory.c. */
+
+G_GNUC_INTERNAL
+DhSymbolIndex *         _dh_book_list_directory_get_symbol_index (DhBookListDirectory *list_directory);
+
+G_END_DECLS
@@ -237,8 +237,8 @@ find_equivalent_local_uri (DhWebView   *view,
         const gchar *book_id;
         const gchar *relative_url;
         DhBookList *book_list;
-        GList *books;
-        GList *book_node;
+        DhBook *book;
+        GList *l;
         gchar *local_uri = NULL;
         DhWebViewPrivate *priv = dh_web_view_get_instance_private (view);
 
@@ -263,25 +263,19 @@ find_equivalent_local_uri (DhWebView   *view,
         }
 
         book_list = dh_profile_get_book_list (priv->profile);
-        books = dh_book_list_get_books (book_list);
-
-        for (book_node = books; book_node != NULL; book_node = book_node->next) {
-                DhBook *cur_book = DH_BOOK (book_node->data);
-                GList *links;
-                GList *link_node;
-
-                if (g_strcmp0 (dh_book_get_id (cur_book), book_id) != 0)
-                        continue;
-
-                links = dh_book_get_links (cur_book);
+        /* The IDs in the URIs are compared case-sensitively, unlike
+         * dh_book_list_find_by_id().
+         */
+        book = dh_book_list_find_by_id (book_list, book_id);
+        if (book == NULL || g_strcmp0 (dh_book_get_id (book), book_id) != 0)
+                goto out;
 
-                for (link_node = links; link_node != NULL; link_node = link_node->next) {
-                        DhLink *cur_link = link_node->data;
+        for (l = dh_book_get_links (book); l != NULL; l = l->next) {
+                DhLink *cur_link = l->data;
 
-                        if (dh_link_match_relative_url (cur_link, relative_url)) {
-                                local_uri = dh_link_get_uri (cur_link);
-                                goto out;
-                        }
+                if (dh_link_match_relative_url (cur_link, relative_url)) {
+                        local_uri = dh_link_get_uri (cur_link);
+                        goto out;
                 }
         }
 
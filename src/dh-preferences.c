@@ -24,8 +24,6 @@
 #include "dh-preferences.h"
 #include <glib/gi18n.h>
 #include <devhelp/devhelp.h>
-#include <json-glib/json-glib.h>
-#include <libsoup/soup.h>
 #include "devhelp/dh-settings.h"
 #include "dh-settings-app.h"
 
@@ -67,7 +65,7 @@ typedef struct {
         guint      var_id;
         guint      fixed_id;
 
-        SoupWebsocketConnection *dl_ws;
+        gboolean downloading;
 } DhPreferencesPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (DhPreferences, dh_preferences, GTK_TYPE_DIALOG)
@@ -196,23 +194,21 @@ set_language_group_enabled (DhPreferences *prefs,
                             gboolean       enabled)
 {
         DhPreferencesPrivate *priv = dh_preferences_get_instance_private (prefs);
-        DhSettings *settings;
         GList *books;
+        GList *language_books = NULL;
         GList *l;
 
-        settings = dh_settings_get_default ();
         books = dh_book_list_get_books (priv->full_book_list);
 
-        dh_settings_freeze_books_disabled_changed (settings);
-
         for (l = books; l != NULL; l = l->next) {
                 DhBook *cur_book = DH_BOOK (l->data);
 
                 if (g_strcmp0 (language, dh_book_get_language (cur_book)) == 0)
-                        dh_settings_set_book_enabled (settings, cur_book, enabled);
+                        language_books = g_list_prepend (language_books, cur_book);
         }
 
-        dh_settings_thaw_books_disabled_changed (settings);
+        dh_settings_set_books_enabled (dh_settings_get_default (), language_books, enabled);
+        g_list_free (language_books);
 }
 
 static gboolean
@@ -329,65 +325,67 @@ bookshelf_scroll_to_top (DhPreferences *prefs)
 }
 
 
+/* Set on the store, to cancel a populate superseded by a more recent one. */
+#define DOWNLOADS_CANCELLABLE_KEY "dh-preferences-downloads-cancellable"
+
 static void
-preferences_bookshelf_populate_store_downloads (DhPreferences *prefs, GtkListStore *store, char repo)
+populate_store_downloads_docset_cb (const gchar *docset_id,
+                                    const gchar *title,
+                                    gpointer     user_data)
 {
-        DhPreferencesPrivate *priv = dh_preferences_get_instance_private (prefs);
-        GtkTreeIter  iter;
-        SoupSession *session;
-        char uri[] = "http://localhost:12340/repo/_/items";
-        int i;
-        for (i = 0; uri[i] != '_'; ++i);
-        uri[i] = repo;
-        GHashTable *hash;
-        GList *langlist;
-        SoupMessage *request;
-        SoupMessageBody *body;
-        SoupBuffer *buffer;
-        const gchar *data;
-        gsize length;
-        JsonParser *parser;
-        JsonNode *root;
-        JsonArray *array;
-        JsonObject *object;
-
-        parser = json_parser_new();
-        session = soup_session_new_with_options(
-                "use-thread-context", gtk_true(),
-                NULL
-        );
-        hash = g_hash_table_new(g_str_hash, g_str_equal);
-        request = soup_form_request_new_from_hash ("GET", uri, hash);
-
-        soup_session_send_message (session, request);
-        g_object_get(request, "response-body", &body, NULL);
-
-        buffer = soup_message_body_flatten(body);
-        soup_buffer_get_data(buffer, (const guint8**)&data, &length);
-        json_parser_load_from_data(parser, data, length, NULL);
-        root = json_parser_get_root(parser);
-        array = json_node_get_array(root);
-
-        for (guint i = 0; i < json_array_get_length (array); ++i) {
-                object = json_array_get_object_element(array, i);
-                gtk_list_store_append (store,
-                                       &iter);
-
-                gtk_list_store_set (store,
-                                    &iter,
-                                    COLUMN_DL_TITLE, json_object_get_string_member(object, "Title"),
-                                    COLUMN_DL_PROGRESS, 0,
-                                    COLUMN_DL_ID, json_object_get_string_member(object, "Id"),
-                                    -1);
+        GtkListStore *store = GTK_LIST_STORE (user_data);
+        GtkTreeIter iter;
+
+        gtk_list_store_append (store, &iter);
+        gtk_list_store_set (store,
+                            &iter,
+                            COLUMN_DL_TITLE, title,
+                            COLUMN_DL_PROGRESS, 0,
+                            COLUMN_DL_ID, docset_id,
+                            -1);
+}
+
+static void
+populate_store_downloads_cb (GObject      *source_object,
+                             GAsyncResult *result,
+                             gpointer      user_data)
+{
+        GtkListStore *store = GTK_LIST_STORE (user_data);
+        GError *error = NULL;
 
+        if (!dh_core_list_docsets_finish (result, &error)) {
+                if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                        g_warning ("Failed to get the list of docsets: %s", error->message);
+                g_clear_error (&error);
         }
 
-        soup_buffer_free (buffer);
-        soup_message_body_free (body);
-        g_object_unref (parser);
-        g_hash_table_unref (hash);
-        g_object_unref (request);
-        g_object_unref (session);
+        g_object_unref (store);
+}
+
+/* The Kapeli repositories list thousands of docsets: the rows are appended as
+ * the data arrives.
+ */
+static void
+preferences_bookshelf_populate_store_downloads (DhPreferences *prefs, GtkListStore *store, DhCoreRepo repo)
+{
+        GCancellable *cancellable;
+
+        cancellable = g_object_get_data (G_OBJECT (store), DOWNLOADS_CANCELLABLE_KEY);
+        if (cancellable != NULL)
+                g_cancellable_cancel (cancellable);
+
+        cancellable = g_cancellable_new ();
+        g_object_set_data_full (G_OBJECT (store),
+                                DOWNLOADS_CANCELLABLE_KEY,
+                                cancellable,
+                                g_object_unref);
+
+        dh_core_list_docsets_async (repo,
+                                    cancellable,
+                                    populate_store_downloads_docset_cb,
+                                    store,
+                                    populate_store_downloads_cb,
+                                    g_object_ref (store));
 }
 
 static void
@@ -439,17 +437,8 @@ bookshelf_books_disabled_changed_cb (DhSettings    *settings,
 }
 
 static void
-bookshelf_add_book_cb (DhBookList    *full_book_list,
-                       DhBook        *book,
-                       DhPreferences *prefs)
-{
-        bookshelf_populate (prefs);
-}
-
-static void
-bookshelf_remove_book_cb (DhBookList    *full_book_list,
-                          DhBook        *book,
-                          DhPreferences *prefs)
+bookshelf_books_changed_cb (DhBookList    *full_book_list,
+                            DhPreferences *prefs)
 {
         bookshelf_populate (prefs);
 }
@@ -584,32 +573,42 @@ out:
         return ret;
 }
 
+static void
+preferences_bookshelf_remove_book_cb (GObject      *source_object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data)
+{
+        GError *error = NULL;
+
+        if (!dh_core_remove_docset_finish (result, &error)) {
+                g_warning ("%s", error->message);
+                g_clear_error (&error);
+        }
+
+        dh_book_list_refresh (dh_book_list_get_default(
+                -1 // at this point it should be already created outside
+        ));
+}
+
 static void
 preferences_bookshelf_remove_book (GObject* obj, GdkEvent *ev, gpointer user_data)
 {
         DhPreferencesPrivate *priv = user_data;
         GtkTreeSelection *selection = gtk_tree_view_get_selection(priv->bookshelf_view);
-        SoupSession *session;
-        SoupMessage *request;
         GtkTreeModel *model;
         GtkTreeIter iter;
-        gchar *uri, *id;
+        gchar *id;
 
         gtk_tree_selection_get_selected(selection, &model, &iter);
         gtk_tree_model_get(GTK_TREE_MODEL (priv->bookshelf_store),
                            &iter,
                            COLUMN_ID_FOR_REMOVING, &id, -1);
-        session = soup_session_new();
-        uri = g_strjoin("/", "http://localhost:12340/item", id);
-        request = soup_message_new ("DELETE", uri);
-        soup_session_send_message (session, request);
-
-        g_object_unref(request);
-        g_object_unref(session);
+        dh_core_remove_docset_async (id,
+                                     NULL,
+                                     preferences_bookshelf_remove_book_cb,
+                                     NULL);
 
-        dh_book_list_refresh (dh_book_list_get_default(
-                -1 // at this point it should be already created outside
-        ));
+        g_free(id);
 }
 
 static void
@@ -638,38 +637,19 @@ preferences_bookshelf_tree_selection_changed_cb (GtkTreeSelection *selection,
 
 
 static void
-websocket_message_cb (SoupWebsocketConnection *self,
-                      gint                     type,
-                      GBytes                  *message,
-                      gpointer                 user_data) {
-        DhPreferencesPrivate *priv = user_data;
-        JsonParser *parser;
-        JsonNode *root;
-        JsonObject *object;
-        GError *error = NULL;
-        size_t len;
-        gint64 received, total;
+download_progress_cb (DhCoreRepo   repo,
+                      const gchar *docset,
+                      gint64       received,
+                      gint64       total,
+                      gpointer     user_data) {
+        DhPreferences *prefs = DH_PREFERENCES (user_data);
+        DhPreferencesPrivate *priv = dh_preferences_get_instance_private (prefs);
         gboolean next, first = true;
         GtkTreeIter iter;
         GtkListStore *store;
-        const gchar *docset, *iter_docset, *repo_id;
+        const gchar *iter_docset;
 
-        const gchar* msg = g_bytes_get_data(message, &len);
-        if (len < 2) {
-                return;
-        }
-
-        parser = json_parser_new();
-        json_parser_load_from_data(parser, msg, len, &error);
-
-        root = json_parser_get_root(parser);
-        object = json_node_get_object(root);
-        repo_id = json_object_get_string_member(object, "RepoId");
-        docset = json_object_get_string_member(object, "Docset");
-        received = json_object_get_int_member(object, "Received");
-        total = json_object_get_int_member(object, "Total");
-
-        if (g_str_equal(repo_id, "com.kapeli")){
+        if (repo == DH_CORE_REPO_KAPELI){
                 store = priv->bookshelf_store_downloads;
         }  else {
                 store = priv->bookshelf_store_usercontrib_downloads;
@@ -695,7 +675,7 @@ websocket_message_cb (SoupWebsocketConnection *self,
                         next = gtk_tree_model_get_iter_first(store, &iter);
                 }
         }
-        if (g_str_equal(repo_id, "com.kapeli")) {
+        if (repo == DH_CORE_REPO_KAPELI) {
                 gtk_widget_queue_draw(priv->bookshelf_download_treeview);
         } else {
                 gtk_widget_queue_draw(priv->bookshelf_download_treeview_usercontrib);
@@ -706,55 +686,24 @@ websocket_message_cb (SoupWebsocketConnection *self,
                     -1  // at this point it should be already created outside
             ));
         }
-
-        g_object_unref(parser);
-}
-
-static void
-websocket_closed_cb (SoupWebsocketConnection *self,
-                     gpointer                 user_data)
-{
-        DhPreferencesPrivate *priv = user_data;
-        priv->dl_ws = NULL;
 }
 
 static void
-websocket_connected_cb (GObject *source_object,
-                        GAsyncResult *res,
-                        gpointer user_data)
-{
-        DhPreferencesPrivate *priv = user_data;
-        priv->dl_ws = soup_session_websocket_connect_finish(source_object, res, NULL);
-        g_signal_connect(priv->dl_ws, "message", (GCallback*)websocket_message_cb, user_data);
-        g_signal_connect(priv->dl_ws, "closed", (GCallback*)websocket_closed_cb, user_data);
-}
-
-static void
-open_progress_ws(DhPreferences *prefs)
+download_cb (GObject      *source_object,
+             GAsyncResult *result,
+             gpointer      user_data)
 {
+        DhPreferences *prefs = DH_PREFERENCES (user_data);
         DhPreferencesPrivate *priv = dh_preferences_get_instance_private (prefs);
+        GError *error = NULL;
+
+        if (!dh_core_download_docset_finish (result, &error)) {
+                g_warning ("%s", error->message);
+                g_clear_error (&error);
+        }
 
-        SoupSession *session;
-        const char *uri;
-        GHashTable *hash;
-        SoupMessage *request;
-
-        session = soup_session_new();
-        uri = "ws://localhost:12340/download_progress";
-        hash = g_hash_table_new(g_str_hash, g_str_equal);
-        request = soup_form_request_new_from_hash ("GET", uri, hash);
-
-        char **protocols = malloc(sizeof(char*));
-        *protocols = NULL;
-        soup_session_websocket_connect_async(session,
-                                             request,
-                                             "http://localhost/",
-                                             protocols,
-                                             NULL,
-                                             websocket_connected_cb,
-                                             priv);
-        g_hash_table_unref(hash);
-        free(protocols);
+        priv->downloading = FALSE;
+        g_object_unref (prefs);
 }
 
 gboolean download_start(GtkTreeView *tv, GtkTreePath *path, GtkTreeViewColumn *column, DhPreferences *prefs)
@@ -763,43 +712,32 @@ gboolean download_start(GtkTreeView *tv, GtkTreePath *path, GtkTreeViewColumn *c
         GtkTreeSelection *selection = gtk_tree_view_get_selection(tv);
         GtkTreeModel *model;
         GtkTreeIter iter;
-        gchar *id, *json;
-        SoupSession *session;
-        const char *uri;
-        SoupMessage *request;
+        gchar *id;
+        DhCoreRepo repo;
 
-        if (priv->dl_ws != NULL) {
+        if (priv->downloading) {
                return FALSE;
         }
 
         gtk_tree_selection_get_selected (selection, &model, &iter);
         gtk_tree_model_get(model, &iter, COLUMN_DL_ID, &id, -1);
 
-        session = soup_session_new();
-        uri = "http://localhost:12340/item";
-        request = soup_message_new ("POST", uri);
         if (tv == priv->bookshelf_download_treeview) {
-               json = g_strjoin("", "{\"id\":\"", id, "\", \"repo\": \"com.kapeli\"}", NULL);
+               repo = DH_CORE_REPO_KAPELI;
         } else {
-               json = g_strjoin("", "{\"id\":\"", id, "\", \"repo\": \"com.kapeli.contrib\"}", NULL);
+               repo = DH_CORE_REPO_KAPELI_CONTRIB;
         }
 
-        soup_message_set_request(request,
-                                 "application/json",
-                                 SOUP_MEMORY_COPY,
-                                 json,
-                                 strlen(json));
-
-        soup_session_send_message (session, request);
+        priv->downloading = TRUE;
+        dh_core_download_docset_async (repo,
+                                       id,
+                                       NULL,
+                                       download_progress_cb,
+                                       prefs,
+                                       download_cb,
+                                       g_object_ref (prefs));
 
-        char **protocols = malloc(sizeof(char*));
-        *protocols = NULL;
-
-        g_free(json);
-        g_object_unref(request);
-        g_object_unref(session);
-
-        open_progress_ws (prefs);
+        g_free(id);
         return FALSE;
 }
 
@@ -807,15 +745,15 @@ gboolean download_start(GtkTreeView *tv, GtkTreePath *path, GtkTreeViewColumn *c
 preferences_bookshelf_refresh_cb (GObject* object, DhPreferences  *prefs)
 {
         DhPreferencesPrivate *priv = dh_preferences_get_instance_private (prefs);
-        gtk_list_store_clear (priv->bookshelf_store);
+
+        /* The installed books are repopulated on ::books-changed, if needed. */
         gtk_list_store_clear (priv->bookshelf_store_downloads);
         gtk_list_store_clear (priv->bookshelf_store_usercontrib_downloads);
-        bookshelf_populate (prefs);
         preferences_bookshelf_populate_store_downloads (
-                prefs, priv->bookshelf_store_downloads, '1'
+                prefs, priv->bookshelf_store_downloads, DH_CORE_REPO_KAPELI
         );
         preferences_bookshelf_populate_store_downloads (
-                prefs, priv->bookshelf_store_usercontrib_downloads, '2'
+                prefs, priv->bookshelf_store_usercontrib_downloads, DH_CORE_REPO_KAPELI_CONTRIB
         );
 }
 
@@ -979,10 +917,10 @@ init_bookshelf_tab (DhPreferences *prefs)
                           priv);
 
         preferences_bookshelf_populate_store_downloads (
-                prefs, priv->bookshelf_store_downloads, '1'
+                prefs, priv->bookshelf_store_downloads, DH_CORE_REPO_KAPELI
         );
         preferences_bookshelf_populate_store_downloads (
-                prefs, priv->bookshelf_store_usercontrib_downloads, '2'
+                prefs, priv->bookshelf_store_usercontrib_downloads, DH_CORE_REPO_KAPELI_CONTRIB
         );
 
         g_signal_connect (priv->bookshelf_download_treeview,
@@ -1000,16 +938,10 @@ init_bookshelf_tab (DhPreferences *prefs)
                           G_CALLBACK (preferences_bookshelf_remove_book),
                           priv);
         g_signal_connect_object (priv->full_book_list,
-                                 "add-book",
-                                 G_CALLBACK (bookshelf_add_book_cb),
+                                 "books-changed",
+                                 G_CALLBACK (bookshelf_books_changed_cb),
                                  prefs,
-                                 G_CONNECT_AFTER);
-
-        g_signal_connect_object (priv->full_book_list,
-                                 "remove-book",
-                                 G_CALLBACK (bookshelf_remove_book_cb),
-                                 prefs,
-                                 G_CONNECT_AFTER);
+                                 0);
 
         bookshelf_populate (prefs);
 }
@@ -1050,7 +982,7 @@ dh_preferences_init (DhPreferences *prefs)
 {
         DhPreferencesPrivate *priv;
 	priv = dh_preferences_get_instance_private (prefs);
-        priv->dl_ws = NULL;
+        priv->downloading = FALSE;
 
         gtk_widget_init_template (GTK_WIDGET (prefs));
 
@@ -0,0 +1,60 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "devhelp/dh-book-list.h"
+#include "test-helpers.h"
+
+static void
+test_find_by_id (void)
+{
+        DhBookList *book_list;
+        DhBook *glib_book;
+        DhBook *gtk_book;
+
+        book_list = dh_book_list_new ();
+        glib_book = test_helpers_create_book ("glib", "GLib");
+        gtk_book = test_helpers_create_book ("gtk3", "GTK");
+
+        dh_book_list_add_book (book_list, glib_book);
+        dh_book_list_add_book (book_list, gtk_book);
+
+        g_assert_true (dh_book_list_find_by_id (book_list, "glib") == glib_book);
+        g_assert_true (dh_book_list_find_by_id (book_list, "GTK3") == gtk_book);
+        g_assert_null (dh_book_list_find_by_id (book_list, "gio"));
+        g_assert_null (dh_book_list_find_by_id (book_list, NULL));
+
+        dh_book_list_remove_book (book_list, glib_book);
+        g_assert_null (dh_book_list_find_by_id (book_list, "glib"));
+        g_assert_true (dh_book_list_find_by_id (book_list, "gtk3") == gtk_book);
+        g_assert_cmpuint (g_list_length (dh_book_list_get_books (book_list)), ==, 1);
+
+        g_object_unref (book_list);
+        g_object_unref (glib_book);
+        g_object_unref (gtk_book);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/book_list/find_by_id", test_find_by_id);
+
+        return g_test_run ();
+}
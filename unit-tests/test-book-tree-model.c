@@ -0,0 +1,261 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+#include "devhelp/dh-book-tree-model.h"
+#include "devhelp/dh-core-endpoint.h"
+
+#define N_SYNTHETIC_SYMBOLS 100000
+
+static JsonArray *
+create_symbols (guint n_symbols)
+{
+        JsonArray *symbols;
+        guint i;
+
+        symbols = json_array_sized_new (n_symbols);
+
+        for (i = 0; i < n_symbols; i++) {
+                JsonArray *pair = json_array_sized_new (2);
+                gchar *name = g_strdup_printf ("symbol_%u", i);
+                gchar *url = g_strdup_printf ("item/bench/symbols/%u", i);
+
+                json_array_add_string_element (pair, name);
+                json_array_add_string_element (pair, url);
+                json_array_add_array_element (symbols, pair);
+
+                g_free (name);
+                g_free (url);
+        }
+
+        return symbols;
+}
+
+static gchar *
+get_title (GtkTreeModel *model,
+           GtkTreeIter  *iter)
+{
+        gchar *title = NULL;
+
+        gtk_tree_model_get (model, iter,
+                            DH_BOOK_TREE_MODEL_COL_TITLE, &title,
+                            -1);
+
+        return title;
+}
+
+static void
+test_paths (void)
+{
+        JsonArray *symbols;
+        DhBookTreeModel *book_tree_model;
+        GtkTreeModel *model;
+        GtkTreeIter root;
+        GtkTreeIter iter;
+        GtkTreeIter parent;
+        GtkTreePath *path;
+        gchar *title;
+        gint i;
+
+        symbols = create_symbols (5);
+        book_tree_model = _dh_book_tree_model_new_from_symbols ("Root", symbols);
+        model = GTK_TREE_MODEL (book_tree_model);
+
+        g_assert_cmpint (gtk_tree_model_iter_n_children (model, NULL), ==, 1);
+        g_assert (gtk_tree_model_get_iter_first (model, &root));
+        g_assert (!gtk_tree_model_iter_parent (model, &parent, &root));
+        g_assert (gtk_tree_model_iter_has_child (model, &root));
+        g_assert_cmpint (gtk_tree_model_iter_n_children (model, &root), ==, 5);
+
+        title = get_title (model, &root);
+        g_assert_cmpstr (title, ==, "Root");
+        g_free (title);
+
+        g_assert (gtk_tree_model_iter_children (model, &iter, &root));
+        for (i = 0; i < 5; i++) {
+                GtkTreeIter nth;
+                gchar *expected;
+
+                path = gtk_tree_model_get_path (model, &iter);
+                g_assert_cmpint (gtk_tree_path_get_depth (path), ==, 2);
+                g_assert_cmpint (gtk_tree_path_get_indices (path)[0], ==, 0);
+                g_assert_cmpint (gtk_tree_path_get_indices (path)[1], ==, i);
+
+                g_assert (gtk_tree_model_get_iter (model, &nth, path));
+                g_assert (nth.user_data == iter.user_data);
+                gtk_tree_path_free (path);
+
+                g_assert (gtk_tree_model_iter_nth_child (model, &nth, &root, i));
+                g_assert (nth.user_data == iter.user_data);
+
+                g_assert (gtk_tree_model_iter_parent (model, &parent, &iter));
+                g_assert (parent.user_data == root.user_data);
+
+                title = get_title (model, &iter);
+                expected = g_strdup_printf ("symbol_%d", i);
+                g_assert_cmpstr (title, ==, expected);
+                g_free (title);
+                g_free (expected);
+
+                g_assert (gtk_tree_model_iter_next (model, &iter) == (i < 4));
+        }
+
+        g_assert (!gtk_tree_model_iter_nth_child (model, &iter, &root, 5));
+        g_assert (!gtk_tree_model_iter_nth_child (model, &iter, NULL, 1));
+
+        path = gtk_tree_path_new_from_indices (0, 5, -1);
+        g_assert (!gtk_tree_model_get_iter (model, &iter, path));
+        gtk_tree_path_free (path);
+
+        path = gtk_tree_path_new_from_indices (0, 0, 0, -1);
+        g_assert (!gtk_tree_model_get_iter (model, &iter, path));
+        gtk_tree_path_free (path);
+
+        g_object_unref (book_tree_model);
+        json_array_unref (symbols);
+}
+
+/* Does what a GtkTreeView does when a node with a lot of children is expanded
+ * and then scrolled through: the children are inserted, every row is visited
+ * once through its path, then rows are accessed randomly. Every step must be
+ * linear in the number of children, not quadratic.
+ */
+static void
+test_expand_and_scroll (void)
+{
+        JsonArray *symbols;
+        DhBookTreeModel *book_tree_model;
+        GtkTreeModel *model;
+        GtkTreeIter root;
+        GtkTreeIter iter;
+        GTimer *timer;
+        gint n_visited;
+        gint i;
+
+        symbols = create_symbols (N_SYNTHETIC_SYMBOLS);
+        timer = g_timer_new ();
+
+        /* Expand. */
+        book_tree_model = _dh_book_tree_model_new_from_symbols ("Root", symbols);
+        model = GTK_TREE_MODEL (book_tree_model);
+        g_assert (gtk_tree_model_get_iter_first (model, &root));
+        g_assert_cmpint (gtk_tree_model_iter_n_children (model, &root), ==, N_SYNTHETIC_SYMBOLS);
+        g_test_minimized_result (g_timer_elapsed (timer, NULL),
+                                 "Expanding a node with %d children: %f s",
+                                 N_SYNTHETIC_SYMBOLS,
+                                 g_timer_elapsed (timer, NULL));
+
+        /* Scroll through all the rows. */
+        g_timer_start (timer);
+        n_visited = 0;
+        g_assert (gtk_tree_model_iter_children (model, &iter, &root));
+        do {
+                GtkTreePath *path;
+                GtkTreeIter path_iter;
+                gchar *title;
+
+                path = gtk_tree_model_get_path (model, &iter);
+                g_assert (gtk_tree_model_get_iter (model, &path_iter, path));
+                g_assert (path_iter.user_data == iter.user_data);
+                gtk_tree_path_free (path);
+
+                title = get_title (model, &iter);
+                g_free (title);
+
+                n_visited++;
+        } while (gtk_tree_model_iter_next (model, &iter));
+        g_assert_cmpint (n_visited, ==, N_SYNTHETIC_SYMBOLS);
+        g_test_minimized_result (g_timer_elapsed (timer, NULL),
+                                 "Scrolling through %d rows: %f s",
+                                 N_SYNTHETIC_SYMBOLS,
+                                 g_timer_elapsed (timer, NULL));
+
+        /* Jump around, like when dragging the scrollbar. */
+        g_timer_start (timer);
+        for (i = 0; i < N_SYNTHETIC_SYMBOLS; i++) {
+                gint n = g_test_rand_int_range (0, N_SYNTHETIC_SYMBOLS);
+                GtkTreePath *path;
+
+                g_assert (gtk_tree_model_iter_nth_child (model, &iter, &root, n));
+                path = gtk_tree_model_get_path (model, &iter);
+                g_assert_cmpint (gtk_tree_path_get_indices (path)[1], ==, n);
+                gtk_tree_path_free (path);
+        }
+        g_test_minimized_result (g_timer_elapsed (timer, NULL),
+                                 "Accessing %d random rows: %f s",
+                                 N_SYNTHETIC_SYMBOLS,
+                                 g_timer_elapsed (timer, NULL));
+
+        g_timer_destroy (timer);
+        g_object_unref (book_tree_model);
+        json_array_unref (symbols);
+}
+
+static void
+test_find_uri (void)
+{
+        JsonArray *symbols;
+        DhBookTreeModel *book_tree_model;
+        GtkTreeModel *model;
+        GtkTreeIter iter;
+        gchar *uri;
+        gchar *anchor_uri;
+        gchar *title;
+
+        symbols = create_symbols (5);
+        book_tree_model = _dh_book_tree_model_new_from_symbols ("Root", symbols);
+        model = GTK_TREE_MODEL (book_tree_model);
+
+        uri = _dh_core_endpoint_get_uri ("item/bench/symbols/3");
+        g_assert (_dh_book_tree_model_find_uri (book_tree_model, uri, &iter));
+        title = get_title (model, &iter);
+        g_assert_cmpstr (title, ==, "symbol_3");
+        g_free (title);
+
+        /* An anchor not in the tree falls back to its page. */
+        anchor_uri = g_strconcat (uri, "#details", NULL);
+        g_assert (_dh_book_tree_model_find_uri (book_tree_model, anchor_uri, &iter));
+        title = get_title (model, &iter);
+        g_assert_cmpstr (title, ==, "symbol_3");
+        g_free (title);
+        g_free (anchor_uri);
+        g_free (uri);
+
+        uri = _dh_core_endpoint_get_uri ("item/bench/symbols/42");
+        g_assert (!_dh_book_tree_model_find_uri (book_tree_model, uri, &iter));
+        g_free (uri);
+
+        g_object_unref (book_tree_model);
+        json_array_unref (symbols);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/book_tree_model/paths", test_paths);
+        g_test_add_func ("/book_tree_model/find_uri", test_find_uri);
+
+        /* Only with -m perf. */
+        if (g_test_perf ())
+                g_test_add_func ("/book_tree_model/expand_and_scroll", test_expand_and_scroll);
+
+        return g_test_run ();
+}
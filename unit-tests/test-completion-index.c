@@ -0,0 +1,160 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "devhelp/dh-completion-index.h"
+#include "test-helpers.h"
+
+static DhCompletion *
+create_completion (const gchar *first_str,
+                   ...)
+{
+        DhCompletion *completion;
+        const gchar *str;
+        va_list args;
+
+        completion = dh_completion_new ();
+
+        va_start (args, first_str);
+        for (str = first_str; str != NULL; str = va_arg (args, const gchar *))
+                dh_completion_add_string (completion, str);
+        va_end (args);
+
+        dh_completion_sort (completion);
+        return completion;
+}
+
+static void
+wait_for_update (DhCompletionIndex *index_)
+{
+        _dh_completion_index_update (index_);
+
+        while (_dh_completion_index_is_updating (index_))
+                g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+check_complete (DhCompletionIndex *index_,
+                const gchar       *prefix,
+                const gchar       *expected)
+{
+        gchar *result;
+
+        wait_for_update (index_);
+        result = _dh_completion_index_complete (index_, prefix);
+        g_assert_cmpstr (result, ==, expected);
+        g_free (result);
+}
+
+static void
+test_add_remove (void)
+{
+        DhCompletionIndex *index_;
+        DhCompletion *completion1;
+        DhCompletion *completion2;
+        DhCompletion *completion3;
+
+        completion1 = create_completion ("a", "baa", NULL);
+        completion2 = create_completion ("ba", "baa", NULL);
+        completion3 = create_completion ("bb", NULL);
+
+        index_ = _dh_completion_index_new ();
+        check_complete (index_, "b", NULL);
+
+        _dh_completion_index_add (index_, G_OBJECT (completion1));
+        check_complete (index_, "b", "baa");
+
+        /* Several changes merged at once. */
+        _dh_completion_index_add (index_, G_OBJECT (completion2));
+        _dh_completion_index_add (index_, G_OBJECT (completion3));
+        check_complete (index_, "b", NULL);
+        check_complete (index_, "ba", NULL);
+        check_complete (index_, "a", NULL);
+
+        _dh_completion_index_remove (index_, G_OBJECT (completion3));
+        check_complete (index_, "b", "ba");
+
+        /* "baa" is still in completion2. */
+        _dh_completion_index_remove (index_, G_OBJECT (completion1));
+        check_complete (index_, "b", "ba");
+        check_complete (index_, "a", NULL);
+        check_complete (index_, "baa", NULL);
+
+        /* Changes that cancel each other out. */
+        _dh_completion_index_add (index_, G_OBJECT (completion3));
+        _dh_completion_index_remove (index_, G_OBJECT (completion3));
+        _dh_completion_index_remove (index_, G_OBJECT (completion2));
+        _dh_completion_index_add (index_, G_OBJECT (completion2));
+        check_complete (index_, "b", "ba");
+
+        _dh_completion_index_remove (index_, G_OBJECT (completion2));
+        check_complete (index_, "b", NULL);
+
+        _dh_completion_index_free (index_);
+        g_object_unref (completion1);
+        g_object_unref (completion2);
+        g_object_unref (completion3);
+}
+
+static void
+test_symbol_index (void)
+{
+        DhCompletionIndex *index_;
+        DhSymbolIndexBuilder *builder;
+        DhSymbolIndex *symbol_index;
+        DhBook *glib_book;
+
+        builder = _dh_symbol_index_builder_new ();
+        _dh_symbol_index_builder_add_docset (builder, "glib", "GLib");
+        _dh_symbol_index_builder_add_symbol (builder, "g_malloc", "Function", "glib/g_malloc");
+        _dh_symbol_index_builder_add_symbol (builder, "g_malloc0", "Function", "glib/g_malloc0");
+        _dh_symbol_index_builder_add_docset (builder, "gtk", "GTK");
+        _dh_symbol_index_builder_add_symbol (builder, "gtk_main", "Function", "gtk/gtk_main");
+        symbol_index = _dh_symbol_index_builder_end (builder);
+
+        glib_book = test_helpers_create_book ("glib", "GLib");
+
+        index_ = _dh_completion_index_new ();
+        _dh_completion_index_add (index_, G_OBJECT (glib_book));
+        check_complete (index_, "g_", NULL);
+
+        /* The strings of the book are built again with its symbols. */
+        _dh_completion_index_set_symbol_index (index_, symbol_index);
+        check_complete (index_, "g_", "g_malloc");
+
+        /* Only the symbols of the books of the index. */
+        check_complete (index_, "gt", NULL);
+
+        _dh_completion_index_set_symbol_index (index_, NULL);
+        check_complete (index_, "g_", NULL);
+
+        _dh_completion_index_free (index_);
+        _dh_symbol_index_unref (symbol_index);
+        g_object_unref (glib_book);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/completion_index/add_remove", test_add_remove);
+        g_test_add_func ("/completion_index/symbol_index", test_symbol_index);
+
+        return g_test_run ();
+}
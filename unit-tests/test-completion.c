@@ -19,6 +19,7 @@
  */
 
 #include <devhelp/devhelp.h>
+#include <string.h>
 
 static void
 test_empty (void)
@@ -230,6 +231,154 @@ test_aggregate_complete (void)
         g_list_free (list);
 }
 
+#define N_BENCHMARK_STRINGS 200000
+#define N_BENCHMARK_QUERIES 100000
+
+static gint
+sequence_compare_func (gconstpointer a,
+                       gconstpointer b,
+                       gpointer      user_data)
+{
+        return g_strcmp0 (a, b);
+}
+
+/* The previous implementation of DhCompletion, a sorted GSequence of strings,
+ * to compare with. The strings are ASCII, so the common prefix is computed
+ * byte per byte.
+ */
+static gchar *
+sequence_complete (GSequence   *sequence,
+                   const gchar *prefix)
+{
+        GSequenceIter *iter;
+        gchar *longest_prefix = NULL;
+        gsize prefix_length = strlen (prefix);
+
+        iter = g_sequence_search (sequence, (gpointer) prefix, sequence_compare_func, NULL);
+
+        if (!g_sequence_iter_is_begin (iter) &&
+            g_str_equal (g_sequence_get (g_sequence_iter_prev (iter)), prefix))
+                return NULL;
+
+        for (; !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter)) {
+                const gchar *cur_str = g_sequence_get (iter);
+                gsize i;
+
+                if (!g_str_has_prefix (cur_str, prefix))
+                        break;
+
+                if (longest_prefix == NULL) {
+                        longest_prefix = g_strdup (cur_str);
+                        continue;
+                }
+
+                for (i = prefix_length; longest_prefix[i] == cur_str[i] && cur_str[i] != '\0'; i++)
+                        ;
+                longest_prefix[i] = '\0';
+
+                if (i == prefix_length) {
+                        g_clear_pointer (&longest_prefix, g_free);
+                        break;
+                }
+        }
+
+        return longest_prefix;
+}
+
+/* Symbol-like names, with many common prefixes. */
+static gchar *
+create_benchmark_string (guint i)
+{
+        static const gchar *modules[] = { "gtk", "gdk", "g", "pango", "cairo", "soup", "json", "dh" };
+        static const gchar *types[] = { "widget", "window", "tree_view", "list_store", "text_buffer", "settings" };
+        static const gchar *verbs[] = { "get", "set", "new", "add", "remove", "is" };
+
+        return g_strdup_printf ("%s_%s_%s_%u",
+                                modules[i % G_N_ELEMENTS (modules)],
+                                types[(i / G_N_ELEMENTS (modules)) % G_N_ELEMENTS (types)],
+                                verbs[(i / 7) % G_N_ELEMENTS (verbs)],
+                                i);
+}
+
+/* Compares the results and the speed of DhCompletion with the previous
+ * GSequence-based implementation.
+ */
+static void
+test_benchmark (void)
+{
+        gchar **strings;
+        gchar **queries;
+        DhCompletion *completion;
+        GSequence *sequence;
+        GTimer *timer;
+        guint i;
+
+        strings = g_new0 (gchar *, N_BENCHMARK_STRINGS + 1);
+        for (i = 0; i < N_BENCHMARK_STRINGS; i++)
+                strings[i] = create_benchmark_string (g_test_rand_int_range (0, G_MAXINT32));
+
+        /* Prefixes of existing strings, cut at various lengths. */
+        queries = g_new0 (gchar *, N_BENCHMARK_QUERIES + 1);
+        for (i = 0; i < N_BENCHMARK_QUERIES; i++) {
+                const gchar *str = strings[g_test_rand_int_range (0, N_BENCHMARK_STRINGS)];
+
+                queries[i] = g_strndup (str, g_test_rand_int_range (1, strlen (str) + 1));
+        }
+
+        timer = g_timer_new ();
+
+        sequence = g_sequence_new (g_free);
+        for (i = 0; i < N_BENCHMARK_STRINGS; i++)
+                g_sequence_append (sequence, g_strdup (strings[i]));
+        g_sequence_sort (sequence, sequence_compare_func, NULL);
+        g_test_minimized_result (g_timer_elapsed (timer, NULL),
+                                 "GSequence: building with %d strings: %f s",
+                                 N_BENCHMARK_STRINGS,
+                                 g_timer_elapsed (timer, NULL));
+
+        g_timer_start (timer);
+        completion = dh_completion_new ();
+        for (i = 0; i < N_BENCHMARK_STRINGS; i++)
+                dh_completion_add_string (completion, strings[i]);
+        dh_completion_sort (completion);
+        g_test_minimized_result (g_timer_elapsed (timer, NULL),
+                                 "DhCompletion: building with %d strings: %f s",
+                                 N_BENCHMARK_STRINGS,
+                                 g_timer_elapsed (timer, NULL));
+
+        g_timer_start (timer);
+        for (i = 0; i < N_BENCHMARK_QUERIES; i++)
+                g_free (sequence_complete (sequence, queries[i]));
+        g_test_minimized_result (g_timer_elapsed (timer, NULL),
+                                 "GSequence: %d completions: %f s",
+                                 N_BENCHMARK_QUERIES,
+                                 g_timer_elapsed (timer, NULL));
+
+        g_timer_start (timer);
+        for (i = 0; i < N_BENCHMARK_QUERIES; i++)
+                g_free (dh_completion_complete (completion, queries[i]));
+        g_test_minimized_result (g_timer_elapsed (timer, NULL),
+                                 "DhCompletion: %d completions: %f s",
+                                 N_BENCHMARK_QUERIES,
+                                 g_timer_elapsed (timer, NULL));
+
+        for (i = 0; i < N_BENCHMARK_QUERIES; i++) {
+                gchar *expected = sequence_complete (sequence, queries[i]);
+                gchar *result = dh_completion_complete (completion, queries[i]);
+
+                g_assert_cmpstr (result, ==, expected);
+
+                g_free (expected);
+                g_free (result);
+        }
+
+        g_timer_destroy (timer);
+        g_object_unref (completion);
+        g_sequence_free (sequence);
+        g_strfreev (strings);
+        g_strfreev (queries);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -242,5 +391,9 @@ main (int    argc,
         g_test_add_func ("/completion/utf-8", test_utf8);
         g_test_add_func ("/completion/aggregate_complete", test_aggregate_complete);
 
+        /* Only with -m perf. */
+        if (g_test_perf ())
+                g_test_add_func ("/completion/benchmark", test_benchmark);
+
         return g_test_run ();
 }
@@ -0,0 +1,85 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "devhelp/dh-docset-registry.h"
+#include "test-helpers.h"
+
+static void
+test_book_links (void)
+{
+        DhBookList *book_list;
+        DhDocsetRegistry *registry;
+        DhLink *book_link;
+
+        book_list = dh_book_list_new ();
+        registry = _dh_docset_registry_new (book_list);
+
+        book_link = _dh_docset_registry_get_book_link (registry, "glib", "GLib");
+        g_assert_nonnull (book_link);
+        g_assert_cmpstr (dh_link_get_book_id (book_link), ==, "glib");
+        g_assert_cmpstr (dh_link_get_name (book_link), ==, "GLib");
+
+        /* The same link for all the hits of the docset. */
+        g_assert_true (_dh_docset_registry_get_book_link (registry, "glib", "GLib") == book_link);
+        g_assert_true (_dh_docset_registry_get_book_link (registry, "gtk", "GTK") != book_link);
+
+        _dh_docset_registry_free (registry);
+        g_object_unref (book_list);
+}
+
+static void
+test_books (void)
+{
+        DhBookList *book_list;
+        DhDocsetRegistry *registry;
+        DhBook *glib_book;
+        DhBook *gtk_book;
+
+        book_list = dh_book_list_new ();
+        glib_book = test_helpers_create_book ("glib", "GLib");
+        gtk_book = test_helpers_create_book ("gtk", "GTK");
+
+        dh_book_list_add_book (book_list, glib_book);
+        registry = _dh_docset_registry_new (book_list);
+        g_assert_true (_dh_docset_registry_lookup_book (registry, "glib") == glib_book);
+        g_assert_null (_dh_docset_registry_lookup_book (registry, "gtk"));
+
+        dh_book_list_add_book (book_list, gtk_book);
+        g_assert_true (_dh_docset_registry_lookup_book (registry, "gtk") == gtk_book);
+
+        dh_book_list_remove_book (book_list, glib_book);
+        g_assert_null (_dh_docset_registry_lookup_book (registry, "glib"));
+        g_assert_true (_dh_docset_registry_lookup_book (registry, "gtk") == gtk_book);
+
+        _dh_docset_registry_free (registry);
+        g_object_unref (book_list);
+        g_object_unref (glib_book);
+        g_object_unref (gtk_book);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/docset_registry/book_links", test_book_links);
+        g_test_add_func ("/docset_registry/books", test_books);
+
+        return g_test_run ();
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test-helpers.h"
+#include <json-glib/json-glib.h>
+
+/* The fixtures shared by the unit tests. */
+
+/* Returns: (transfer full): a new #DhBook, as created from the zealcore
+ * catalog, without language nor icon.
+ */
+DhBook *
+test_helpers_create_book (const gchar *id,
+                          const gchar *title)
+{
+        JsonObject *object;
+        DhBook *book;
+
+        object = json_object_new ();
+        json_object_set_string_member (object, "Title", title);
+        json_object_set_string_member (object, "Id", id);
+        json_object_set_string_member (object, "SourceId", "com.kapeli");
+        json_object_set_string_member (object, "Language", "");
+        json_object_set_string_member (object, "Icon", "");
+
+        book = dh_book_new_from_json (object, 1);
+        json_object_unref (object);
+
+        return book;
+}
@@ -0,0 +1,140 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "devhelp/dh-json-array-reader.h"
+
+static DhJsonArrayReader *
+create_reader (const gchar *json)
+{
+        GInputStream *stream;
+        DhJsonArrayReader *reader;
+
+        stream = g_memory_input_stream_new_from_data (json, -1, NULL);
+        reader = _dh_json_array_reader_new (stream);
+        g_object_unref (stream);
+
+        return reader;
+}
+
+static void
+test_elements (void)
+{
+        DhJsonArrayReader *reader;
+        JsonNode *element;
+        JsonArray *pair;
+        GError *error = NULL;
+
+        reader = create_reader (" [ [\"a]\\\"\", \"item/1\"], {\"Title\": \"}{\"},\n 42 , \"x,y\", null ] ");
+
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert_no_error (error);
+        g_assert (JSON_NODE_HOLDS_ARRAY (element));
+        pair = json_node_get_array (element);
+        g_assert_cmpstr (json_array_get_string_element (pair, 0), ==, "a]\"");
+        g_assert_cmpstr (json_array_get_string_element (pair, 1), ==, "item/1");
+        json_node_free (element);
+
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert_no_error (error);
+        g_assert (JSON_NODE_HOLDS_OBJECT (element));
+        g_assert_cmpstr (json_object_get_string_member (json_node_get_object (element), "Title"), ==, "}{");
+        json_node_free (element);
+
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert_no_error (error);
+        g_assert_cmpint (json_node_get_int (element), ==, 42);
+        json_node_free (element);
+
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert_no_error (error);
+        g_assert_cmpstr (json_node_get_string (element), ==, "x,y");
+        json_node_free (element);
+
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert_no_error (error);
+        g_assert (JSON_NODE_HOLDS_NULL (element));
+        json_node_free (element);
+
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert_no_error (error);
+        g_assert (element == NULL);
+
+        _dh_json_array_reader_free (reader);
+
+        reader = create_reader ("[]");
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert_no_error (error);
+        g_assert (element == NULL);
+        _dh_json_array_reader_free (reader);
+}
+
+static void
+test_errors (void)
+{
+        DhJsonArrayReader *reader;
+        JsonNode *element;
+        GError *error = NULL;
+
+        /* Not an array. */
+        reader = create_reader ("{\"Title\": \"a\"}");
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert (element == NULL);
+        g_assert_error (error, JSON_PARSER_ERROR, JSON_PARSER_ERROR_INVALID_DATA);
+        g_clear_error (&error);
+        _dh_json_array_reader_free (reader);
+
+        /* Truncated: the complete elements are still returned. */
+        reader = create_reader ("[[\"a\", \"b\"], [\"c\"");
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert_no_error (error);
+        g_assert (JSON_NODE_HOLDS_ARRAY (element));
+        json_node_free (element);
+
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert (element == NULL);
+        g_assert_error (error, JSON_PARSER_ERROR, JSON_PARSER_ERROR_INVALID_DATA);
+        g_clear_error (&error);
+        _dh_json_array_reader_free (reader);
+
+        /* Trailing comma, after a scalar and after a container. */
+        reader = create_reader ("[1,]");
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert (element == NULL);
+        g_assert_error (error, JSON_PARSER_ERROR, JSON_PARSER_ERROR_INVALID_DATA);
+        g_clear_error (&error);
+        _dh_json_array_reader_free (reader);
+
+        reader = create_reader ("[[\"a\"], ]");
+        element = _dh_json_array_reader_next (reader, NULL, &error);
+        g_assert (element == NULL);
+        g_assert_error (error, JSON_PARSER_ERROR, JSON_PARSER_ERROR_INVALID_DATA);
+        g_clear_error (&error);
+        _dh_json_array_reader_free (reader);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/json_array_reader/elements", test_elements);
+        g_test_add_func ("/json_array_reader/errors", test_errors);
+
+        return g_test_run ();
+}
@@ -0,0 +1,183 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "devhelp/dh-keyword-matcher.h"
+#include <string.h>
+
+#define N_BENCHMARK_NAMES 1000000
+
+static void
+check_find (const gchar *str,
+            const gchar *keyword)
+{
+        DhKeywordMatcher *matcher;
+        const gchar *expected;
+
+        matcher = _dh_keyword_matcher_new (keyword);
+        expected = strstr (str, keyword);
+
+        g_assert_true (_dh_keyword_matcher_find (matcher, str, strlen (str)) == expected);
+        g_assert_cmpint (_dh_keyword_matcher_match_prefix (matcher, str, strlen (str)), ==, expected == str);
+
+        _dh_keyword_matcher_free (matcher);
+}
+
+static void
+test_simple (void)
+{
+        check_find ("gtk_widget_show", "widget");
+        check_find ("gtk_widget_show", "WIDGET");
+        check_find ("gtk_widget_show", "gtk");
+        check_find ("GtkWidget", "Widget");
+        check_find ("GtkWidget", "widget");
+        check_find ("GtkWidget", "GtkWidgets");
+        check_find ("GtkWidget", "");
+        check_find ("", "gtk");
+        check_find ("", "");
+        check_find ("caf\303\251_\303\211t\303\251", "\303\251t");
+}
+
+/* The keyword at every position, around the 16-byte blocks. */
+static void
+test_positions (void)
+{
+        static const gchar *keywords[] = { "a", "ab", "abc", "abcdefghijklmnopq" };
+        guint i;
+
+        for (i = 0; i < G_N_ELEMENTS (keywords); i++) {
+                gsize keyword_length = strlen (keywords[i]);
+                guint length;
+
+                for (length = keyword_length; length < 50; length++) {
+                        guint pos;
+
+                        for (pos = 0; pos + keyword_length <= length; pos++) {
+                                gchar *str;
+
+                                /* Also with a partial match just before. */
+                                str = g_strnfill (length, 'A');
+                                if (pos > 0 && keyword_length > 1)
+                                        str[pos - 1] = 'a';
+                                memcpy (str + pos, keywords[i], keyword_length);
+
+                                check_find (str, keywords[i]);
+                                g_free (str);
+                        }
+                }
+        }
+}
+
+static gchar *
+create_benchmark_name (guint i)
+{
+        static const gchar *modules[] = { "gtk", "gdk", "g", "Pango", "cairo", "soup", "json", "dh" };
+        static const gchar *types[] = { "widget", "Window", "tree_view", "list_store", "text_buffer", "settings" };
+        static const gchar *verbs[] = { "get", "set", "new", "add", "remove", "is" };
+
+        return g_strdup_printf ("%s_%s_%s_%u",
+                                modules[i % G_N_ELEMENTS (modules)],
+                                types[(i / G_N_ELEMENTS (modules)) % G_N_ELEMENTS (types)],
+                                verbs[(i / 7) % G_N_ELEMENTS (verbs)],
+                                i);
+}
+
+/* Compares with what _dh_search_context_match_link() did for a lowercase
+ * keyword: fold every name, then g_str_has_prefix() and strstr(). The matcher
+ * is given the folded names, like the ones stored in the DhLink's.
+ */
+static void
+test_benchmark (void)
+{
+        static const gchar *keywords[] = { "gtk", "view", "store_get", "zzz" };
+        gchar **names;
+        gchar **folded_names;
+        gsize *lengths;
+        GTimer *timer;
+        guint i;
+        guint k;
+
+        names = g_new0 (gchar *, N_BENCHMARK_NAMES + 1);
+        folded_names = g_new0 (gchar *, N_BENCHMARK_NAMES + 1);
+        lengths = g_new (gsize, N_BENCHMARK_NAMES);
+        for (i = 0; i < N_BENCHMARK_NAMES; i++) {
+                names[i] = create_benchmark_name (i);
+                folded_names[i] = g_ascii_strdown (names[i], -1);
+                lengths[i] = strlen (names[i]);
+        }
+
+        timer = g_timer_new ();
+
+        for (k = 0; k < G_N_ELEMENTS (keywords); k++) {
+                DhKeywordMatcher *matcher;
+                guint n_reference_matches = 0;
+                guint n_matches = 0;
+
+                g_timer_start (timer);
+                for (i = 0; i < N_BENCHMARK_NAMES; i++) {
+                        gchar *folded = g_ascii_strdown (names[i], -1);
+
+                        if (g_str_has_prefix (folded, keywords[k]) ||
+                            strstr (folded, keywords[k]) != NULL)
+                                n_reference_matches++;
+
+                        g_free (folded);
+                }
+                g_test_minimized_result (g_timer_elapsed (timer, NULL),
+                                         "Folding and strstr(), \"%s\" in %d names: %f s",
+                                         keywords[k],
+                                         N_BENCHMARK_NAMES,
+                                         g_timer_elapsed (timer, NULL));
+
+                g_timer_start (timer);
+                matcher = _dh_keyword_matcher_new (keywords[k]);
+                for (i = 0; i < N_BENCHMARK_NAMES; i++) {
+                        if (_dh_keyword_matcher_match_prefix (matcher, folded_names[i], lengths[i]) ||
+                            _dh_keyword_matcher_find (matcher, folded_names[i], lengths[i]) != NULL)
+                                n_matches++;
+                }
+                _dh_keyword_matcher_free (matcher);
+                g_test_minimized_result (g_timer_elapsed (timer, NULL),
+                                         "DhKeywordMatcher, \"%s\" in %d names: %f s",
+                                         keywords[k],
+                                         N_BENCHMARK_NAMES,
+                                         g_timer_elapsed (timer, NULL));
+
+                g_assert_cmpuint (n_matches, ==, n_reference_matches);
+        }
+
+        g_timer_destroy (timer);
+        g_strfreev (names);
+        g_strfreev (folded_names);
+        g_free (lengths);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/keyword_matcher/simple", test_simple);
+        g_test_add_func ("/keyword_matcher/positions", test_positions);
+
+        /* Only with -m perf. */
+        if (g_test_perf ())
+                g_test_add_func ("/keyword_matcher/benchmark", test_benchmark);
+
+        return g_test_run ();
+}
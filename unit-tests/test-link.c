@@ -19,6 +19,7 @@
  */
 
 #include <devhelp/devhelp.h>
+#include <string.h>
 
 #define DEVHELP_BOOK_BASE_PATH "/usr/share/gtk-doc/html/devhelp"
 
@@ -67,6 +68,77 @@ test_belongs_to_page (void)
         dh_link_unref (link);
 }
 
+static void
+test_folded_name (void)
+{
+        DhLink *book_link;
+        DhLink *link;
+
+        book_link = dh_link_new_book (DEVHELP_BOOK_BASE_PATH,
+                                      "devhelp",
+                                      "Devhelp Reference Manual",
+                                      "index.html");
+        g_assert_cmpstr (_dh_link_get_folded_name (book_link), ==, "devhelp reference manual");
+        g_assert_cmpstr (dh_link_get_name (book_link), ==, "Devhelp Reference Manual");
+
+        /* Without uppercase letters, the name itself. */
+        link = dh_link_new (DH_LINK_TYPE_FUNCTION,
+                            book_link,
+                            "dh_link_ref",
+                            "DhLink.html#dh-link-ref");
+        g_assert (_dh_link_get_folded_name (link) == dh_link_get_name (link));
+        dh_link_unref (link);
+
+        /* Only the ASCII letters are folded. */
+        link = dh_link_new (DH_LINK_TYPE_KEYWORD,
+                            book_link,
+                            "GtkÉtat",
+                            "GtkEtat.html");
+        g_assert_cmpstr (_dh_link_get_folded_name (link), ==, "gtkÉtat");
+        g_assert_cmpstr (dh_link_get_name (link), ==, "GtkÉtat");
+        dh_link_unref (link);
+
+        dh_link_unref (book_link);
+}
+
+static void
+test_compare (void)
+{
+        DhLink *book_link;
+        DhLink *links[4];
+        gchar *keys[2];
+        gint i;
+
+        book_link = dh_link_new_book (DEVHELP_BOOK_BASE_PATH,
+                                      "devhelp",
+                                      "Devhelp Reference Manual",
+                                      "index.html");
+
+        links[0] = dh_link_new (DH_LINK_TYPE_FUNCTION, book_link, "dh_book_new", "DhBook.html");
+        links[1] = dh_link_new (DH_LINK_TYPE_STRUCT, book_link, "DhLink", "DhLink.html");
+        links[2] = dh_link_new (DH_LINK_TYPE_FUNCTION, book_link, "dh_link_ref", "DhLink.html");
+        links[3] = dh_link_new (DH_LINK_TYPE_FUNCTION, book_link, "dh_link_ref", "DhLink.html");
+
+        /* The same order as the collation keys. */
+        keys[0] = g_utf8_collate_key (dh_link_get_name (links[0]), -1);
+        keys[1] = g_utf8_collate_key (dh_link_get_name (links[1]), -1);
+        g_assert_cmpint (dh_link_compare (links[0], links[1]) < 0, ==, strcmp (keys[0], keys[1]) < 0);
+        g_assert_cmpint (dh_link_compare (links[1], links[0]) < 0, ==, strcmp (keys[1], keys[0]) < 0);
+        g_free (keys[0]);
+        g_free (keys[1]);
+
+        g_assert_cmpint (dh_link_compare (links[2], links[3]), ==, 0);
+
+        /* Deprecated links last. */
+        dh_link_set_flags (links[0], DH_LINK_FLAGS_DEPRECATED);
+        g_assert_cmpint (dh_link_compare (links[0], links[2]), >, 0);
+        g_assert_cmpint (dh_link_compare (links[2], links[0]), <, 0);
+
+        for (i = 0; i < 4; i++)
+                dh_link_unref (links[i]);
+        dh_link_unref (book_link);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -74,6 +146,8 @@ main (int    argc,
         g_test_init (&argc, &argv, NULL);
 
         g_test_add_func ("/link/belongs_to_page", test_belongs_to_page);
+        g_test_add_func ("/link/folded_name", test_folded_name);
+        g_test_add_func ("/link/compare", test_compare);
 
         return g_test_run ();
 }
@@ -0,0 +1,183 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "devhelp/dh-search-frame.h"
+#include <string.h>
+
+static void
+append_u16 (GByteArray *frame,
+            guint       value)
+{
+        guint8 bytes[2] = { value & 0xff, value >> 8 };
+
+        g_byte_array_append (frame, bytes, 2);
+}
+
+static void
+append_string (GByteArray  *frame,
+               const gchar *str)
+{
+        append_u16 (frame, strlen (str));
+        g_byte_array_append (frame, (const guint8 *) str, strlen (str) + 1);
+}
+
+static void
+collect_hit_cb (guint        docset_id,
+                guint        docset_name,
+                const gchar *name,
+                const gchar *path,
+                gpointer     user_data)
+{
+        GString *hits = user_data;
+
+        g_string_append_printf (hits, "%u,%u,%s,%s;", docset_id, docset_name, name, path);
+}
+
+static gboolean
+decode (DhSearchFrameDecoder  *decoder,
+        GByteArray            *frame,
+        gboolean              *end_of_results,
+        GString               *hits,
+        GError               **error)
+{
+        GBytes *bytes;
+        gboolean ret;
+
+        bytes = g_bytes_new (frame->data, frame->len);
+        ret = _dh_search_frame_decoder_decode (decoder, bytes, end_of_results, collect_hit_cb, hits, error);
+        g_bytes_unref (bytes);
+
+        return ret;
+}
+
+static void
+test_hits (void)
+{
+        DhSearchFrameDecoder *decoder;
+        GByteArray *frame;
+        GString *hits;
+        gboolean end_of_results;
+        GError *error = NULL;
+
+        decoder = _dh_search_frame_decoder_new ();
+        hits = g_string_new (NULL);
+
+        frame = g_byte_array_new ();
+        g_byte_array_append (frame, (const guint8 *) "\1", 1);
+        append_u16 (frame, 2);
+        append_string (frame, "glib");
+        append_string (frame, "GLib");
+        append_u16 (frame, 2);
+        append_u16 (frame, 0);
+        append_u16 (frame, 1);
+        append_string (frame, "g_list_append");
+        append_string (frame, "/item/glib/a");
+        append_u16 (frame, 0);
+        append_u16 (frame, 1);
+        append_string (frame, "GList");
+        append_string (frame, "/item/glib/b");
+
+        g_assert_true (decode (decoder, frame, &end_of_results, hits, &error));
+        g_assert_no_error (error);
+        g_assert_false (end_of_results);
+        g_assert_cmpstr (hits->str, ==, "0,1,g_list_append,/item/glib/a;0,1,GList,/item/glib/b;");
+        g_assert_cmpstr (_dh_search_frame_decoder_get_string (decoder, 0), ==, "glib");
+        g_assert_cmpstr (_dh_search_frame_decoder_get_string (decoder, 1), ==, "GLib");
+
+        /* The string table is kept between the frames. */
+        g_string_truncate (hits, 0);
+        g_byte_array_set_size (frame, 0);
+        g_byte_array_append (frame, (const guint8 *) "\1", 1);
+        append_u16 (frame, 0);
+        append_u16 (frame, 1);
+        append_u16 (frame, 0);
+        append_u16 (frame, 1);
+        append_string (frame, "GSList");
+        append_string (frame, "item/glib/c");
+
+        g_assert_true (decode (decoder, frame, &end_of_results, hits, &error));
+        g_assert_no_error (error);
+        g_assert_cmpstr (hits->str, ==, "0,1,GSList,item/glib/c;");
+
+        g_byte_array_set_size (frame, 0);
+        g_byte_array_append (frame, (const guint8 *) "\2", 1);
+
+        g_assert_true (decode (decoder, frame, &end_of_results, hits, &error));
+        g_assert_no_error (error);
+        g_assert_true (end_of_results);
+
+        g_byte_array_unref (frame);
+        g_string_free (hits, TRUE);
+        _dh_search_frame_decoder_free (decoder);
+}
+
+static void
+test_malformed (void)
+{
+        DhSearchFrameDecoder *decoder;
+        GByteArray *frame;
+        GString *hits;
+        gboolean end_of_results;
+        GError *error = NULL;
+
+        decoder = _dh_search_frame_decoder_new ();
+        hits = g_string_new (NULL);
+
+        /* Unknown string index. */
+        frame = g_byte_array_new ();
+        g_byte_array_append (frame, (const guint8 *) "\1", 1);
+        append_u16 (frame, 0);
+        append_u16 (frame, 1);
+        append_u16 (frame, 0);
+        append_u16 (frame, 0);
+        append_string (frame, "GList");
+        append_string (frame, "item/glib/b");
+
+        g_assert_false (decode (decoder, frame, &end_of_results, hits, &error));
+        g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+        g_clear_error (&error);
+
+        /* Truncated string. */
+        g_byte_array_set_size (frame, 0);
+        g_byte_array_append (frame, (const guint8 *) "\1", 1);
+        append_u16 (frame, 1);
+        append_u16 (frame, 10);
+        g_byte_array_append (frame, (const guint8 *) "glib", 4);
+
+        g_assert_false (decode (decoder, frame, &end_of_results, hits, &error));
+        g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+        g_clear_error (&error);
+
+        g_assert_cmpstr (hits->str, ==, "");
+
+        g_byte_array_unref (frame);
+        g_string_free (hits, TRUE);
+        _dh_search_frame_decoder_free (decoder);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/search_frame/hits", test_hits);
+        g_test_add_func ("/search_frame/malformed", test_malformed);
+
+        return g_test_run ();
+}
@@ -0,0 +1,125 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2018 Jerzy Kozera <jerzy.kozera@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "devhelp/dh-symbol-index.h"
+
+static DhSymbolIndex *
+create_index (void)
+{
+        DhSymbolIndexBuilder *builder;
+
+        builder = _dh_symbol_index_builder_new ();
+
+        _dh_symbol_index_builder_add_docset (builder, "glib", "GLib");
+        _dh_symbol_index_builder_add_symbol (builder, "g_list_append", "Function", "item/glib/a");
+        _dh_symbol_index_builder_add_symbol (builder, "GList", "Struct", "item/glib/b");
+        _dh_symbol_index_builder_add_symbol (builder, "g_slist_append", "Function", "item/glib/c");
+
+        _dh_symbol_index_builder_add_docset (builder, "gtk", "GTK+");
+        _dh_symbol_index_builder_add_symbol (builder, "GtkListBox", "Class", "item/gtk/a");
+        _dh_symbol_index_builder_add_symbol (builder, "gtk_list_box_new", "Function", "item/gtk/b");
+
+        return _dh_symbol_index_builder_end (builder);
+}
+
+static void
+check_hits (DhSymbolIndex       *index,
+            const gchar         *keyword,
+            const gchar * const *docset_ids,
+            guint                max_hits,
+            const gchar * const *expected_names)
+{
+        GArray *hits;
+        guint i;
+
+        hits = _dh_symbol_index_search (index, keyword, docset_ids, max_hits);
+
+        g_assert_cmpuint (hits->len, ==, g_strv_length ((gchar **) expected_names));
+
+        for (i = 0; i < hits->len; i++) {
+                guint symbol = g_array_index (hits, guint, i);
+
+                g_assert_cmpstr (_dh_symbol_index_get_name (index, symbol), ==, expected_names[i]);
+        }
+
+        g_array_unref (hits);
+}
+
+static void
+test_search (void)
+{
+        DhSymbolIndex *index;
+        const gchar *gtk_only[] = { "gtk", NULL };
+
+        index = create_index ();
+        g_assert_cmpuint (_dh_symbol_index_get_n_symbols (index), ==, 5);
+
+        /* Prefix matches first, in case-insensitive order, then the other
+         * matches.
+         */
+        check_hits (index, "glist", NULL, 10,
+                    (const gchar *[]) { "GList", NULL });
+        check_hits (index, "list", NULL, 10,
+                    (const gchar *[]) { "g_list_append", "g_slist_append", "GList", "gtk_list_box_new", "GtkListBox", NULL });
+        check_hits (index, "G", NULL, 10,
+                    (const gchar *[]) { "g_list_append", "g_slist_append", "GList", "gtk_list_box_new", "GtkListBox", NULL });
+        check_hits (index, "_APPEND", NULL, 10,
+                    (const gchar *[]) { "g_list_append", "g_slist_append", NULL });
+        check_hits (index, "list", NULL, 2,
+                    (const gchar *[]) { "g_list_append", "g_slist_append", NULL });
+        check_hits (index, "list", gtk_only, 10,
+                    (const gchar *[]) { "gtk_list_box_new", "GtkListBox", NULL });
+        check_hits (index, "nothing", NULL, 10,
+                    (const gchar *[]) { NULL });
+
+        _dh_symbol_index_unref (index);
+}
+
+static void
+test_columns (void)
+{
+        DhSymbolIndex *index;
+        GArray *hits;
+        guint symbol;
+
+        index = create_index ();
+
+        hits = _dh_symbol_index_search (index, "gtklistbox", NULL, 10);
+        g_assert_cmpuint (hits->len, ==, 1);
+        symbol = g_array_index (hits, guint, 0);
+
+        g_assert_cmpstr (_dh_symbol_index_get_type_name (index, symbol), ==, "Class");
+        g_assert_cmpstr (_dh_symbol_index_get_path (index, symbol), ==, "item/gtk/a");
+        g_assert_cmpstr (_dh_symbol_index_get_docset_id (index, symbol), ==, "gtk");
+        g_assert_cmpstr (_dh_symbol_index_get_docset_name (index, symbol), ==, "GTK+");
+
+        g_array_unref (hits);
+        _dh_symbol_index_unref (index);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+        g_test_init (&argc, &argv, NULL);
+
+        g_test_add_func ("/symbol_index/search", test_search);
+        g_test_add_func ("/symbol_index/columns", test_columns);
+
+        return g_test_run ();
+}